@@ -45,10 +45,12 @@ sysroot_skel() {
     mkdir -p base/usr/bin/
     mkdir -p base/boot/
     mkdir -p base/usr/include/sys/
+    mkdir -p base/usr/include/crypto/
     mkdir -p base/usr/rc
 
     cp -r rc/* base/usr/rc
     cp -f sys/include/sys/*.h base/usr/include/sys
+    cp -f sys/include/crypto/chacha20.h base/usr/include/crypto
     cp -r etc base/etc/
 
     # Populate ESP
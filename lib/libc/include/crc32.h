@@ -27,11 +27,23 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef CRC32_H_
-#define CRC32_H_
+#ifndef _CRC32_H_
+#define _CRC32_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+/* Implementations, see crc32_impl_set() */
+#define CRC32_IMPL_BYTE     0   /* One table lookup per byte */
+#define CRC32_IMPL_SLICE8   1   /* Slice-by-8 */
+#define CRC32_IMPL_HW       2   /* PCLMULQDQ for CRC-32, SSE4.2 for CRC-32C */
+#define CRC32_NIMPL         3
+
 uint32_t crc32(const void *data, size_t len);
+uint32_t crc32c(const void *data, size_t len);
+
+int crc32_impl_set(int impl);
+int crc32_impl_get(void);
+const char *crc32_impl_name(int impl);
 
-#endif
+#endif  /* !_CRC32_H_ */
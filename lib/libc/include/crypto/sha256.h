@@ -36,6 +36,11 @@
 #define SHA256_HEX_SIZE (64 + 1)
 #define SHA256_BYTES_SIZE 32
 
+/* Implementations of the block function */
+#define SHA256_IMPL_SCALAR  0
+#define SHA256_IMPL_SHANI   1   /* Intel SHA extensions */
+#define SHA256_NIMPL        2
+
 /*
  * Compute the SHA-256 checksum of a memory region given a pointer and
  * the size of that memory region.
@@ -59,4 +64,17 @@ void sha256_append(struct sha256 *sha, const void *data, size_t n_bytes);
 void sha256_finalize_hex(struct sha256 *sha, char *dst_hex65);
 void sha256_finalize_bytes(struct sha256 *sha, void *dst_bytes32);
 
+/*
+ * Streaming interface, hash data in pieces with
+ * sha256_update() then get the digest with
+ * sha256_final(). The context can be reused after
+ * another sha256_init().
+ */
+void sha256_update(struct sha256 *sha, const void *data, size_t n_bytes);
+void sha256_final(struct sha256 *sha, uint8_t digest[SHA256_BYTES_SIZE]);
+
+int sha256_impl_set(int impl);
+int sha256_impl_get(void);
+const char *sha256_impl_name(int impl);
+
 #endif  /* !_CRYPTO_SHA256_H */
@@ -48,7 +48,7 @@
 #define _IONBF 2 /* Unbuffered */
 
 /* Default buffer size */
-#define BUFSIZ 256
+#define BUFSIZ 4096
 
 /* End-Of-File indicator */
 #define EOF (-1)
@@ -58,10 +58,30 @@
 #define stdout stdout
 #define stderr stderr
 
-/* File structure */
+/* Stream state flags */
+#define _IO_READ    0x01    /* Buffer holds data read ahead */
+#define _IO_WRITE   0x02    /* Buffer holds data to be written */
+#define _IO_EOF     0x04    /* End-of-file reached */
+#define _IO_ERR     0x08    /* I/O error occurred */
+#define _IO_MYBUF   0x10    /* Buffer allocated by stdio */
+
+/*
+ * File structure
+ *
+ * @buf_pos: Next byte to read, or bytes waiting to
+ *           be written.
+ * @buf_len: Bytes of read ahead data in the buffer.
+ * @next: Next open stream (see fflush(NULL))
+ */
 typedef struct _IO_FILE {
     int fd;
     int buf_mode;
+    int flags;
+    unsigned char *buf;
+    size_t buf_size;
+    size_t buf_pos;
+    size_t buf_len;
+    struct _IO_FILE *next;
 } FILE;
 
 extern FILE *stdin;
@@ -82,6 +102,11 @@ char *fgets(char *__restrict s, int size, FILE *__restrict stream);
 FILE *fopen(const char *__restrict path, const char *__restrict mode);
 int fseek(FILE *stream, long offset, int whence);
 int fclose(FILE *stream);
+int fflush(FILE *stream);
+
+int setvbuf(FILE *__restrict stream, char *__restrict buf, int mode, size_t size);
+void setbuf(FILE *__restrict stream, char *__restrict buf);
+ssize_t getline(char **__restrict lineptr, size_t *__restrict n, FILE *__restrict stream);
 
 int vsnprintf(char *s, size_t size, const char *fmt, va_list ap);
 int snprintf(char *s, size_t size, const char *fmt, ...);
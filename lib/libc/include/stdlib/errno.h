@@ -36,4 +36,7 @@
 #include <sys/errno.h>
 #endif
 
+/* Set by library functions that fail */
+extern int errno;
+
 #endif  /* _ERRNO_BRIDGE_H_ */
@@ -39,9 +39,11 @@ char *strdup(const char *s);
 
 void *memset(void *dst, int c, size_t n);
 int memcmp(const void *s1, const void *s2, size_t n);
+void *memchr(const void *s, int c, size_t n);
 
 char *itoa(int64_t value, char *buf, int base);
 void *memcpy(void *dest, const void *src, size_t n);
+void *memmove(void *dest, const void *src, size_t n);
 int strcmp(const char *s1, const char *s2);
 int atoi(const char *s);
 
@@ -27,9 +27,33 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * SHA-256
+ *
+ * Whole blocks are hashed straight from the caller's
+ * buffer, only partial blocks are copied. On x86 the
+ * Intel SHA extensions are used when the CPU has them.
+ */
+
+#include <sys/errno.h>
 #include <crypto/sha256.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+void __sha256_ni_blocks(uint32_t state[8], const uint8_t *data,
+    size_t nblocks);
+#endif  /* __x86_64__ */
+
+static const char *impl_names[SHA256_NIMPL] = {
+    [SHA256_IMPL_SCALAR] = "scalar",
+    [SHA256_IMPL_SHANI] = "sha-ni"
+};
+
+static int sha256_impl = -1;
+static uint32_t sha256_caps = 0;
 
 static inline uint32_t
 rotr(uint32_t x, int n)
@@ -72,10 +96,8 @@ update_w(uint32_t *w, int i, const uint8_t *buffer)
 }
 
 static void
-sha256_block(struct sha256 *sha)
+sha256_block(uint32_t state[8], const uint8_t *data)
 {
-    uint32_t *state = sha->state;
-
     static const uint32_t k[8 * 8] = {
         0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
         0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
@@ -108,7 +130,7 @@ sha256_block(struct sha256 *sha)
 
     int i, j;
     for (i = 0; i < 64; i += 16) {
-        update_w(w, i, sha->buffer);
+        update_w(w, i, data);
 
         for (j = 0; j < 16; j += 4) {
             uint32_t temp;
@@ -137,6 +159,121 @@ sha256_block(struct sha256 *sha)
     state[7] += h;
 }
 
+#if defined(__x86_64__)
+static inline void
+sha256_cpuid(uint32_t leaf, uint32_t regs[4])
+{
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "0" (leaf), "2" (0)
+    );
+}
+#endif  /* __x86_64__ */
+
+static uint32_t
+sha256_detect(void)
+{
+    uint32_t caps = 1 << SHA256_IMPL_SCALAR;
+#if defined(__x86_64__)
+    uint32_t regs[4];
+    bool sse;
+
+    /*
+     * SHA-NI is CPUID.(EAX=7H,ECX=0H):EBX[29], the
+     * block function also needs SSSE3 (ECX[9]) and
+     * SSE4.1 (ECX[19]) from CPUID.(EAX=1H).
+     */
+    sha256_cpuid(0, regs);
+    if (regs[0] < 7) {
+        return caps;
+    }
+
+    sha256_cpuid(1, regs);
+    sse = (regs[2] & (1U << 9)) != 0 && (regs[2] & (1U << 19)) != 0;
+    sha256_cpuid(7, regs);
+    if (sse && (regs[1] & (1U << 29)) != 0) {
+        caps |= 1 << SHA256_IMPL_SHANI;
+    }
+#endif  /* __x86_64__ */
+
+    return caps;
+}
+
+/*
+ * Force a specific implementation, mostly useful
+ * to compare them.
+ *
+ * @impl: Implementation to use (SHA256_IMPL_*)
+ *
+ * Returns zero on success, otherwise a less than
+ * zero value is returned.
+ */
+int
+sha256_impl_set(int impl)
+{
+    if (impl < 0 || impl >= SHA256_NIMPL) {
+        return -EINVAL;
+    }
+
+    sha256_impl_get();
+    if ((sha256_caps & (1 << impl)) == 0) {
+        return -ENOTSUP;
+    }
+
+    sha256_impl = impl;
+    return 0;
+}
+
+/*
+ * Returns the implementation in use, picking the
+ * fastest supported one on first use.
+ */
+int
+sha256_impl_get(void)
+{
+    if (sha256_impl >= 0) {
+        return sha256_impl;
+    }
+
+    sha256_caps = sha256_detect();
+    sha256_impl = SHA256_IMPL_SCALAR;
+    if ((sha256_caps & (1 << SHA256_IMPL_SHANI)) != 0) {
+        sha256_impl = SHA256_IMPL_SHANI;
+    }
+
+    return sha256_impl;
+}
+
+const char *
+sha256_impl_name(int impl)
+{
+    if (impl < 0 || impl >= SHA256_NIMPL) {
+        return NULL;
+    }
+
+    return impl_names[impl];
+}
+
+/*
+ * Hash whole 64 byte blocks into the state
+ */
+static void
+sha256_blocks(uint32_t state[8], const uint8_t *data, size_t nblocks)
+{
+#if defined(__x86_64__)
+    if (sha256_impl_get() == SHA256_IMPL_SHANI) {
+        __sha256_ni_blocks(state, data, nblocks);
+        return;
+    }
+#endif  /* __x86_64__ */
+
+    while (nblocks-- > 0) {
+        sha256_block(state, data);
+        data += 64;
+    }
+}
+
 void
 sha256_init(struct sha256 *sha)
 {
@@ -153,44 +290,72 @@ sha256_init(struct sha256 *sha)
 }
 
 void
-sha256_append_byte(struct sha256 *sha, uint8_t byte)
+sha256_append(struct sha256 *sha, const void *src, size_t n_bytes)
 {
-    sha->buffer[sha->buffer_counter++] = byte;
-    sha->n_bits += 8;
+    const uint8_t *bytes = (const uint8_t*)src;
+    size_t n;
+
+    sha->n_bits += (uint64_t)n_bytes * 8;
+
+    /* Top up a partial block first */
+    if (sha->buffer_counter > 0) {
+        n = 64 - sha->buffer_counter;
+        if (n > n_bytes) {
+            n = n_bytes;
+        }
+
+        memcpy(&sha->buffer[sha->buffer_counter], bytes, n);
+        sha->buffer_counter += n;
+        bytes += n;
+        n_bytes -= n;
 
-    if (sha->buffer_counter == 64) {
+        if (sha->buffer_counter < 64) {
+            return;
+        }
+
+        sha256_blocks(sha->state, sha->buffer, 1);
         sha->buffer_counter = 0;
-        sha256_block(sha);
     }
+
+    /* Whole blocks need no copy */
+    if (n_bytes >= 64) {
+        n = n_bytes / 64;
+        sha256_blocks(sha->state, bytes, n);
+        bytes += n * 64;
+        n_bytes -= n * 64;
+    }
+
+    memcpy(sha->buffer, bytes, n_bytes);
+    sha->buffer_counter = n_bytes;
 }
 
 void
-sha256_append(struct sha256 *sha, const void *src, size_t n_bytes)
+sha256_update(struct sha256 *sha, const void *data, size_t n_bytes)
 {
-    const uint8_t *bytes = (const uint8_t*)src;
-    size_t i;
-
-    for (i = 0; i < n_bytes; i++) {
-        sha256_append_byte(sha, bytes[i]);
-    }
+    sha256_append(sha, data, n_bytes);
 }
 
 void
 sha256_finalize(struct sha256 *sha)
 {
-    int i;
     uint64_t n_bits = sha->n_bits;
+    size_t pos = sha->buffer_counter;
+    int i;
 
-    sha256_append_byte(sha, 0x80);
-
-    while (sha->buffer_counter != 56) {
-        sha256_append_byte(sha, 0);
+    sha->buffer[pos++] = 0x80;
+    if (pos > 56) {
+        memset(&sha->buffer[pos], 0, 64 - pos);
+        sha256_blocks(sha->state, sha->buffer, 1);
+        pos = 0;
     }
 
-    for (i = 7; i >= 0; i--) {
-        uint8_t byte = (n_bits >> 8 * i) & 0xff;
-        sha256_append_byte(sha, byte);
+    memset(&sha->buffer[pos], 0, 56 - pos);
+    for (i = 0; i < 8; i++) {
+        sha->buffer[63 - i] = (n_bits >> 8 * i) & 0xff;
     }
+
+    sha256_blocks(sha->state, sha->buffer, 1);
+    sha->buffer_counter = 0;
 }
 
 void
@@ -240,3 +405,9 @@ void sha256_bytes(const void *src, size_t n_bytes, void *dst_bytes32){
     sha256_append(&sha, src, n_bytes);
     sha256_finalize_bytes(&sha, dst_bytes32);
 }
+
+void
+sha256_final(struct sha256 *sha, uint8_t digest[SHA256_BYTES_SIZE])
+{
+    sha256_finalize_bytes(sha, digest);
+}
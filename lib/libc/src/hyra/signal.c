@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/syscall.h>
+#include <sys/signal.h>
+#include <sys/errno.h>
+
+#define sigmask(SIGNO) (1ULL << (SIGNO))
+
+/*
+ * Send a signal to a process
+ *
+ * @pid: PID of process to signal
+ * @signo: Signal to send (0 to check the process)
+ */
+int
+kill(pid_t pid, int signo)
+{
+    return syscall(SYS_kill, pid, signo);
+}
+
+/*
+ * Queue a signal and a value to a process, realtime
+ * signals are queued rather than merged.
+ *
+ * @pid: PID of process to signal
+ * @signo: Signal to send
+ * @value: Value passed to the receiver
+ */
+int
+sigqueue(pid_t pid, int signo, const union sigval value)
+{
+    return syscall(SYS_sigqueue, pid, signo, (uintptr_t)value.sival_ptr);
+}
+
+/*
+ * Wait for a signal in `set' and consume it.
+ *
+ * @set: Signals to wait for
+ * @info: Filled with signal information (may be NULL)
+ *
+ * Returns the signal number on success.
+ */
+int
+sigwaitinfo(const sigset_t *set, siginfo_t *info)
+{
+    return syscall(SYS_sigwaitinfo, (uintptr_t)set, (uintptr_t)info);
+}
+
+int
+sigemptyset(sigset_t *set)
+{
+    *set = 0;
+    return 0;
+}
+
+int
+sigfillset(sigset_t *set)
+{
+    *set = ~(sigset_t)0;
+    return 0;
+}
+
+int
+sigaddset(sigset_t *set, int signo)
+{
+    if (signo <= 0 || signo > SIGRTMAX)
+        return -EINVAL;
+
+    *set |= sigmask(signo);
+    return 0;
+}
+
+int
+sigdelset(sigset_t *set, int signo)
+{
+    if (signo <= 0 || signo > SIGRTMAX)
+        return -EINVAL;
+
+    *set &= ~sigmask(signo);
+    return 0;
+}
+
+int
+sigismember(const sigset_t *set, int signo)
+{
+    if (signo <= 0 || signo > SIGRTMAX)
+        return -EINVAL;
+
+    return (*set & sigmask(signo)) != 0;
+}
@@ -30,9 +30,11 @@
 #include <sys/exec.h>
 #include <stdint.h>
 #include <stddef.h>
+#include <stdlib.h>
 #include <unistd.h>
 
 extern int __libc_stdio_init(void);
+extern void __libc_string_init(void);
 extern int __malloc_mem_init(void);
 uint64_t __libc_auxv[_AT_MAX];
 
@@ -74,10 +76,13 @@ __libc_entry(uint64_t *ctx)
         ++auxvp;
     }
 
+    __libc_string_init();
     if ((status = __libc_stdio_init()) != 0) {
         return status;
     }
 
     __malloc_mem_init();
-    return main(argc, argv);
+
+    /* Returning from main() must flush stdio too */
+    exit(main(argc, argv));
 }
@@ -29,20 +29,37 @@
 
 #include <sys/types.h>
 #include <sys/errno.h>
+#include <sys/param.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
 
+extern FILE *__stdio_head;
+
 int
 fclose(FILE *stream)
 {
+    FILE **pp;
     int retval;
 
     if (stream == NULL) {
         return -EBADF;
     }
 
+    /* Unlink from the open stream list */
+    for (pp = &__stdio_head; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == stream) {
+            *pp = stream->next;
+            break;
+        }
+    }
+
+    fflush(stream);
     retval = close(stream->fd);
+    if (ISSET(stream->flags, _IO_MYBUF)) {
+        free(stream->buf);
+    }
+
     free(stream);
     return retval;
 }
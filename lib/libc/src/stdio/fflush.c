@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/param.h>
+#include <stdio.h>
+#include <unistd.h>
+
+extern FILE *__stdio_head;
+
+/*
+ * Write out any data waiting in the buffer of
+ * `stream'.
+ *
+ * Returns zero on success, otherwise EOF.
+ */
+int
+__stdio_flush(FILE *stream)
+{
+    size_t off = 0;
+    ssize_t count;
+
+    if (!ISSET(stream->flags, _IO_WRITE)) {
+        return 0;
+    }
+
+    while (off < stream->buf_pos) {
+        count = write(stream->fd, stream->buf + off, stream->buf_pos - off);
+        if (count <= 0) {
+            stream->flags |= _IO_ERR;
+            return EOF;
+        }
+
+        off += count;
+    }
+
+    stream->buf_pos = 0;
+    stream->flags &= ~_IO_WRITE;
+    return 0;
+}
+
+/*
+ * Drop data that was read ahead into the buffer of
+ * `stream', seeking back so the file offset matches
+ * what the caller has consumed.
+ */
+void
+__stdio_unread(FILE *stream)
+{
+    size_t ahead;
+
+    if (!ISSET(stream->flags, _IO_READ)) {
+        return;
+    }
+
+    ahead = stream->buf_len - stream->buf_pos;
+    if (ahead > 0) {
+        lseek(stream->fd, -(off_t)ahead, SEEK_CUR);
+    }
+
+    stream->buf_pos = 0;
+    stream->buf_len = 0;
+    stream->flags &= ~_IO_READ;
+}
+
+/*
+ * Flush a stream, or every open stream if `stream'
+ * is NULL.
+ */
+int
+fflush(FILE *stream)
+{
+    int retval = 0;
+
+    if (stream != NULL) {
+        __stdio_unread(stream);
+        return __stdio_flush(stream);
+    }
+
+    for (stream = __stdio_head; stream != NULL; stream = stream->next) {
+        if (__stdio_flush(stream) != 0)
+            retval = EOF;
+    }
+
+    return retval;
+}
@@ -27,11 +27,36 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/param.h>
 #include <stdio.h>
 #include <stdint.h>
 
 extern size_t __stdio_read(void *__restrict ptr, size_t size, FILE *__restrict stream);
 
+/*
+ * Get the next byte from a buffered stream, usually
+ * without leaving the buffer.
+ */
+int
+__stdio_getc(FILE *stream)
+{
+    uint8_t c;
+
+    if (stream->buf_pos < stream->buf_len) {
+        return stream->buf[stream->buf_pos++];
+    }
+    if (__stdio_read(&c, sizeof(c), stream) != sizeof(c)) {
+        return EOF;
+    }
+
+    return c;
+}
+
+/*
+ * Unbuffered streams are read a key at a time, the
+ * console hands out a character and a scancode for
+ * each key pressed.
+ */
 int
 fgetc(FILE *stream)
 {
@@ -40,6 +65,9 @@ fgetc(FILE *stream)
     if (stream == NULL) {
         return EOF;
     }
+    if (stream->buf_mode != _IONBF) {
+        return __stdio_getc(stream);
+    }
 
     if (__stdio_read(&val, sizeof(val), stream) != sizeof(val)) {
         return EOF;
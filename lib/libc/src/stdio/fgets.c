@@ -27,10 +27,48 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/param.h>
 #include <stdio.h>
 #include <stdint.h>
 
 extern size_t __stdio_read(void *__restrict ptr, size_t size, FILE *__restrict stream);
+extern int __stdio_fill(FILE *stream);
+
+/*
+ * Copy a line out of the stream buffer, refilling
+ * it as needed.
+ */
+static char *
+fgets_buffered(char *__restrict s, int size, FILE *__restrict stream)
+{
+    const unsigned char *p;
+    size_t avail, n;
+    int idx = 0;
+
+    while (idx < size - 1) {
+        if (stream->buf_pos >= stream->buf_len) {
+            if (__stdio_fill(stream) != 0)
+                break;
+        }
+
+        p = stream->buf + stream->buf_pos;
+        avail = stream->buf_len - stream->buf_pos;
+        avail = MIN(avail, (size_t)(size - 1 - idx));
+        for (n = 0; n < avail;) {
+            s[idx++] = p[n++];
+            if (p[n - 1] == '\n')
+                break;
+        }
+
+        stream->buf_pos += n;
+        if (s[idx - 1] == '\n') {
+            break;
+        }
+    }
+
+    s[idx] = '\0';
+    return (idx > 0) ? s : NULL;
+}
 
 char *
 fgets(char *__restrict s, int size, FILE *__restrict stream)
@@ -40,9 +78,12 @@ fgets(char *__restrict s, int size, FILE *__restrict stream)
     int idx = 0;
     char c;
 
-    if (stream == NULL) {
+    if (stream == NULL || size <= 0) {
         return NULL;
     }
+    if (stream->buf_mode != _IONBF) {
+        return fgets_buffered(s, size, stream);
+    }
 
     for (;;)  {
         count = __stdio_read(&tmp, sizeof(tmp), stream);
@@ -65,6 +106,7 @@ fgets(char *__restrict s, int size, FILE *__restrict stream)
 
         /* Did we read the entire line? */
         if (idx >= size - 1) {
+            s[idx] = '\0';
             return s;
         }
     }
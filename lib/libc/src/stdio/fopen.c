@@ -33,6 +33,8 @@
 #include <stdlib.h>
 #include <fcntl.h>
 
+extern FILE *__stdio_head;
+
 FILE *
 fopen(const char *__restrict path, const char *__restrict mode)
 {
@@ -65,10 +67,15 @@ fopen(const char *__restrict path, const char *__restrict mode)
 
     fhand = malloc(sizeof(*fhand));
     if (fhand == NULL) {
+        close(fd);
         return NULL;
     }
 
+    /* Files are fully buffered, the buffer comes on first use */
+    memset(fhand, 0, sizeof(*fhand));
     fhand->fd = fd;
-    fhand->buf_mode = _IONBF;
+    fhand->buf_mode = _IOFBF;
+    fhand->next = __stdio_head;
+    __stdio_head = fhand;
     return fhand;
 }
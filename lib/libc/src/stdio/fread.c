@@ -27,27 +27,108 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/param.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
-size_t
-__stdio_read(void *__restrict ptr, size_t size, FILE *__restrict stream)
+extern unsigned char *__stdio_getbuf(FILE *stream);
+extern int __stdio_flush(FILE *stream);
+
+/*
+ * Read straight from the file into `ptr', bypassing
+ * the buffer.
+ */
+static size_t
+stdio_read_direct(void *ptr, size_t size, FILE *stream)
 {
     ssize_t count;
 
-    if (stream->buf_mode == _IONBF) {
-        if ((count = read(stream->fd, ptr, size)) < 0) {
-            return 0;
-        }
+    count = read(stream->fd, ptr, size);
+    if (count <= 0) {
+        stream->flags |= (count == 0) ? _IO_EOF : _IO_ERR;
+        return 0;
+    }
+
+    return count;
+}
 
-        return count;
+/*
+ * Refill the buffer of `stream' from its file, any
+ * pending output is written first.
+ *
+ * Returns zero on success, otherwise EOF.
+ */
+int
+__stdio_fill(FILE *stream)
+{
+    size_t count;
+
+    if (__stdio_flush(stream) != 0) {
+        return EOF;
+    }
+    if (__stdio_getbuf(stream) == NULL) {
+        return EOF;
+    }
+
+    count = stdio_read_direct(stream->buf, stream->buf_size, stream);
+    stream->buf_pos = 0;
+    stream->buf_len = count;
+    if (count == 0) {
+        stream->flags &= ~_IO_READ;
+        return EOF;
     }
 
+    stream->flags |= _IO_READ;
+    return 0;
+}
+
+size_t
+__stdio_read(void *__restrict ptr, size_t size, FILE *__restrict stream)
+{
+    unsigned char *p = ptr;
+    size_t n, done = 0;
+
     /*
-     * TODO: Implement more buffering modes.
+     * Make sure prompts without a newline are seen
+     * before waiting on input.
      */
+    if (stream != stdout && stdout->buf_mode == _IOLBF) {
+        __stdio_flush(stdout);
+    }
 
-    return 0;
+    if (stream->buf_mode == _IONBF || __stdio_getbuf(stream) == NULL) {
+        return stdio_read_direct(ptr, size, stream);
+    }
+
+    while (done < size) {
+        if (stream->buf_pos < stream->buf_len) {
+            n = MIN(stream->buf_len - stream->buf_pos, size - done);
+            memcpy(p + done, stream->buf + stream->buf_pos, n);
+            stream->buf_pos += n;
+            done += n;
+            continue;
+        }
+
+        /* Large reads go straight to the caller */
+        if (size - done >= stream->buf_size) {
+            if (__stdio_flush(stream) != 0) {
+                break;
+            }
+            if ((n = stdio_read_direct(p + done, size - done, stream)) == 0) {
+                break;
+            }
+
+            done += n;
+            continue;
+        }
+
+        if (__stdio_fill(stream) != 0) {
+            break;
+        }
+    }
+
+    return done;
 }
 
 size_t
@@ -57,5 +138,5 @@ fread(void *__restrict ptr, size_t size, size_t n, FILE *__restrict stream)
         return 0;
     }
 
-    return __stdio_read(ptr, size * n, stream);
+    return __stdio_read(ptr, size * n, stream) / size;
 }
@@ -38,5 +38,11 @@ fseek(FILE *stream, long offset, int whence)
         return -EINVAL;
     }
 
+    /* Buffered data is relative to the old offset */
+    if (fflush(stream) != 0) {
+        return EOF;
+    }
+
+    stream->flags &= ~_IO_EOF;
     return lseek(stream->fd, offset, whence);
 }
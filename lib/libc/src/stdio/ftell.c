@@ -27,11 +27,28 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/param.h>
 #include <stdio.h>
 #include <unistd.h>
 
+/*
+ * The file offset is ahead of the caller by any data
+ * read ahead, and behind by any data not yet written.
+ */
 long
 ftell(FILE *stream)
 {
-    return lseek(stream->fd, 0, SEEK_CUR);
+    long off;
+
+    if ((off = lseek(stream->fd, 0, SEEK_CUR)) < 0) {
+        return off;
+    }
+
+    if (ISSET(stream->flags, _IO_READ)) {
+        off -= stream->buf_len - stream->buf_pos;
+    } else if (ISSET(stream->flags, _IO_WRITE)) {
+        off += stream->buf_pos;
+    }
+
+    return off;
 }
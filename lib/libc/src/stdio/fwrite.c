@@ -27,27 +27,77 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/param.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 
+extern unsigned char *__stdio_getbuf(FILE *stream);
+extern int __stdio_flush(FILE *stream);
+extern void __stdio_unread(FILE *stream);
+
+/*
+ * Write straight to the file, bypassing the
+ * buffer.
+ */
+static size_t
+stdio_write_direct(const void *ptr, size_t size, FILE *stream)
+{
+    ssize_t count;
+
+    if ((count = write(stream->fd, ptr, size)) < 0) {
+        stream->flags |= _IO_ERR;
+        return 0;
+    }
+
+    return count;
+}
+
+/*
+ * Check if a line buffered write ends a line, only
+ * the data being written needs to be looked at.
+ */
+static inline bool
+stdio_has_newline(const char *p, size_t size)
+{
+    for (size_t i = 0; i < size; ++i) {
+        if (p[i] == '\n')
+            return true;
+    }
+
+    return false;
+}
+
 size_t
 __stdio_write(const void *__restrict ptr, size_t size, FILE *__restrict stream)
 {
-    ssize_t count;
+    if (stream->buf_mode == _IONBF || __stdio_getbuf(stream) == NULL) {
+        return stdio_write_direct(ptr, size, stream);
+    }
 
-    if (stream->buf_mode == _IONBF) {
-        if ((count = write(stream->fd, ptr, size)) < 0) {
+    __stdio_unread(stream);
+
+    /* Make room, or skip the copy if it would not fit anyways */
+    if (stream->buf_pos + size > stream->buf_size) {
+        if (__stdio_flush(stream) != 0) {
             return 0;
         }
-
-        return count;
+        if (size >= stream->buf_size) {
+            return stdio_write_direct(ptr, size, stream);
+        }
     }
 
-    /*
-     * TODO: Implement more buffering modes.
-     */
+    memcpy(stream->buf + stream->buf_pos, ptr, size);
+    stream->buf_pos += size;
+    stream->flags |= _IO_WRITE;
+
+    if (stream->buf_mode == _IOLBF && stdio_has_newline(ptr, size)) {
+        if (__stdio_flush(stream) != 0)
+            return 0;
+    }
 
-    return 0;
+    return size;
 }
 
 size_t
@@ -57,5 +107,5 @@ fwrite(const void *__restrict ptr, size_t size, size_t n, FILE *__restrict strea
         return 0;
     }
 
-    return __stdio_write(ptr, size * n, stream);
+    return __stdio_write(ptr, size * n, stream) / size;
 }
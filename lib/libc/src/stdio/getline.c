@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/param.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GETLINE_MIN 128
+
+extern int __stdio_getc(FILE *stream);
+
+/*
+ * Read a whole line, growing `*lineptr' as needed.
+ *
+ * @lineptr: Line buffer (may point to NULL)
+ * @n: Size of `*lineptr'
+ * @stream: Stream to read from
+ *
+ * Returns the line length including the newline,
+ * or -1 on end-of-file or error.
+ *
+ * XXX: Unbuffered streams are read a key at a time
+ *      like fgetc() does, the console hands out a
+ *      character and a scancode for each key and only
+ *      the character ends up in the line.
+ */
+ssize_t
+getline(char **__restrict lineptr, size_t *__restrict n, FILE *__restrict stream)
+{
+    size_t len = 0, newsize;
+    char *tmp;
+    int c;
+
+    if (lineptr == NULL || n == NULL || stream == NULL) {
+        return -1;
+    }
+    if (*lineptr == NULL) {
+        *n = 0;
+    }
+
+    for (;;) {
+        if (stream->buf_mode == _IONBF) {
+            c = fgetc(stream);
+        } else {
+            c = __stdio_getc(stream);
+        }
+        if (c == EOF) {
+            break;
+        }
+
+        /* Drop the scancode */
+        c &= 0xFF;
+
+        /* Leave room for the terminator */
+        if (len + 2 > *n) {
+            newsize = MAX(*n * 2, GETLINE_MIN);
+            if ((tmp = realloc(*lineptr, newsize)) == NULL) {
+                return -1;
+            }
+
+            *lineptr = tmp;
+            *n = newsize;
+        }
+
+        (*lineptr)[len++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+
+    if (len == 0) {
+        return -1;
+    }
+
+    (*lineptr)[len] = '\0';
+    return len;
+}
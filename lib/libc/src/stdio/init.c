@@ -34,7 +34,11 @@ FILE *stdin;
 FILE *stdout;
 FILE *stderr;
 
+/* Open streams, flushed by fflush(NULL) and exit() */
+FILE *__stdio_head;
+
 static FILE cin, cout, cerr;
+static unsigned char cout_buf[BUFSIZ];
 
 int
 __libc_stdio_init(void)
@@ -45,15 +49,26 @@ __libc_stdio_init(void)
         return cfd;
     }
 
+    /* The console is read a key at a time */
     cin.buf_mode = _IONBF;
     cin.fd = cfd;
 
-    cout.buf_mode = _IONBF;
+    /*
+     * The standard streams are always the console so
+     * stdout is line buffered, stderr stays unbuffered.
+     */
+    cout.buf_mode = _IOLBF;
+    cout.buf = cout_buf;
+    cout.buf_size = sizeof(cout_buf);
     cout.fd = cfd;
 
     cerr.buf_mode = _IONBF;
     cerr.fd = cfd;
 
+    cin.next = &cout;
+    cout.next = &cerr;
+    __stdio_head = &cin;
+
     stdout = &cout;
     stdin = &cin;
     stderr = &cerr;
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/param.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Get the buffer of a stream, allocating it on first
+ * use. A stream falls back to being unbuffered if no
+ * memory is left for it.
+ *
+ * Returns NULL if the stream is unbuffered.
+ */
+unsigned char *
+__stdio_getbuf(FILE *stream)
+{
+    if (stream->buf != NULL || stream->buf_mode == _IONBF) {
+        return stream->buf;
+    }
+
+    if (stream->buf_size == 0) {
+        stream->buf_size = BUFSIZ;
+    }
+
+    stream->buf = malloc(stream->buf_size);
+    if (stream->buf == NULL) {
+        stream->buf_mode = _IONBF;
+        stream->buf_size = 0;
+        return NULL;
+    }
+
+    stream->flags |= _IO_MYBUF;
+    return stream->buf;
+}
+
+int
+setvbuf(FILE *__restrict stream, char *__restrict buf, int mode, size_t size)
+{
+    if (stream == NULL) {
+        return EOF;
+    }
+    if (mode != _IOFBF && mode != _IOLBF && mode != _IONBF) {
+        return EOF;
+    }
+
+    /* Drop anything buffered in the old mode */
+    if (fflush(stream) != 0) {
+        return EOF;
+    }
+    if (ISSET(stream->flags, _IO_MYBUF)) {
+        free(stream->buf);
+        stream->flags &= ~_IO_MYBUF;
+    }
+
+    stream->buf_mode = mode;
+    stream->buf = NULL;
+    stream->buf_size = 0;
+    if (mode == _IONBF) {
+        return 0;
+    }
+
+    /* No buffer given, allocate one of `size' on use */
+    stream->buf = (unsigned char *)buf;
+    stream->buf_size = size;
+    if (size == 0) {
+        stream->buf = NULL;
+    }
+
+    return 0;
+}
+
+void
+setbuf(FILE *__restrict stream, char *__restrict buf)
+{
+    setvbuf(stream, buf, (buf != NULL) ? _IOFBF : _IONBF, BUFSIZ);
+}
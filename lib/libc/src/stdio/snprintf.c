@@ -32,6 +32,8 @@
 #include <stddef.h>
 #include <unistd.h>
 
+extern size_t __stdio_write(const void *__restrict ptr, size_t size, FILE *__restrict stream);
+
 /* TODO FIXME: Use stdarg.h */
 #define __va_start(ap, fmt)  __builtin_va_start(ap, fmt)
 #define __va_end(ap)  __builtin_va_end(ap)
@@ -57,7 +59,7 @@ printf(const char *__restrict fmt, ...)
 
     __va_start(ap, fmt);
     ret = vsnprintf(buf, sizeof(buf), fmt, ap);
-    write(stdout->fd, buf, ret);
+    __stdio_write(buf, ret, stdout);
     __va_end(ap);
     return ret;
 }
@@ -27,6 +27,7 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <stdio.h>
 #include <stdlib.h>
 
 __dead void
@@ -36,5 +37,6 @@ exit(int status)
      * TODO: Call atexit() handlers and do cleanup here.
      */
 
+    fflush(NULL);
     _Exit(status);
 }
@@ -27,55 +27,117 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * Size-class memory allocator
+ *
+ * Requests up to SMALL_MAX bytes are rounded up to one
+ * of NCLASS size classes and carved out of slabs, each
+ * slab is a SLAB_SIZE chunk of memory from mmap() that
+ * only holds objects of a single class. Slabs with free
+ * objects sit on a list per class, a slab that becomes
+ * completely free is kept around once per class to avoid
+ * thrashing and returned with munmap() otherwise.
+ *
+ * Anything larger than SMALL_MAX is given its own
+ * mapping and unmapped on free.
+ */
+
 #include <sys/types.h>
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/cdefs.h>
+#include <sys/queue.h>
 #include <stdlib.h>
 #include <stddef.h>
-#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <string.h>
 
-#define HEAP_SIZE   0x1001A8
 #define HEAP_MAGIC  0x05306A    /* "OSMORA" :~) */
-#define HEAP_ALIGN  4
-#define HEAP_PROT PROT_READ | PROT_WRITE
-#define BYTE_PTR(PTR) ((char *)(PTR))
-#define HEAP_NEXT(BLOCKP, SIZE) \
-    PTR_OFFSET((BLOCKP), sizeof(struct mem_block) + (SIZE))
+#define HEAP_ALIGN  16
+#define HEAP_PROT   (PROT_READ | PROT_WRITE)
+#define HEAP_PGSIZE 4096
+
+#define SLAB_SIZE   (64 * 1024)
+#define SMALL_MAX   8192
+#define NCLASS      32
+#define CLASS_LARGE 0xFFFF
 
+/*
+ * Header in front of every object handed out.
+ *
+ * @magic: HEAP_MAGIC to catch bad pointers.
+ * @class: Size class, CLASS_LARGE if mapped by itself.
+ * @allocated: Set while the object is in use.
+ * @slab: Owning slab (small objects).
+ * @len: Length of the mapping (large objects).
+ */
 struct __aligned(HEAP_ALIGN) mem_block {
     uint32_t magic;
-    uint32_t size;
-    uint8_t allocated : 1;
-    struct mem_block *next;
+    uint16_t class;
+    uint16_t allocated;
+    union {
+        struct slab *slab;
+        size_t len;
+    };
 };
 
-static struct mem_block *mem_head;
-static struct mem_block *mem_tail;
+/*
+ * A slab of objects of one size class.
+ *
+ * @free: Freed objects, linked through their data.
+ * @nfree: Objects not in use (including unused ones).
+ * @nused: Objects handed out at least once, the rest
+ *         are past the end of the bump region.
+ * @nobj: Total objects that fit in the slab.
+ * @link: Partial list link for the class.
+ */
+struct __aligned(HEAP_ALIGN) slab {
+    uint32_t magic;
+    uint16_t class;
+    uint16_t nobj;
+    uint16_t nfree;
+    uint16_t nused;
+    struct mem_block *free;
+    TAILQ_ENTRY(slab) link;
+};
 
 /*
- * The size of the heap including data on the heap
- * as well as the sizes of their respective block
- * headers.
+ * Per size class state.
+ *
+ * @partial: Slabs with at least one free object.
+ * @empty: A completely free slab kept for reuse.
  */
-static ssize_t heap_len = 0;
-static off_t heap_pos = 0;
+struct malloc_class {
+    TAILQ_HEAD(, slab) partial;
+    struct slab *empty;
+};
 
 /*
- * During the initial state of malloc() when the C library
- * first starts up. We can assume that there is zero fragmentation
- * in our heap pool. This allows us to initially allocate memory
- * by bumping a pointer which is O(1). During this state, even after
- * any calls to free(), we can assume that there is more memory ahead
- * of us that is free (due to the initial zero-fragmentation). However,
- * once we've reached the end of the pool, if any memory has been previously
- * freed (indicated by heap_len > 0), we can wrap the tail and start allocating
- * in a best-fit fashion as we can assume that the heap is now fragmented.
+ * Size class lists. There are no threads in userland
+ * yet so there is one cache, malloc_cache() is where
+ * a per-thread cache would be looked up.
  */
-static bool wrap = false;
+struct malloc_cache {
+    struct malloc_class classes[NCLASS];
+};
+
+/*
+ * Object sizes for each class, classes step by 16 bytes
+ * up to 128 and by a quarter of the power of two above.
+ */
+static const uint16_t class_size[NCLASS] = {
+    16, 32, 48, 64, 80, 96, 112, 128,
+    160, 192, 224, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+    1280, 1536, 1792, 2048,
+    2560, 3072, 3584, 4096,
+    5120, 6144, 7168, 8192
+};
+
+static struct malloc_cache cache;
 
 void __malloc_mem_init(void);
 
@@ -93,75 +155,236 @@ __heap_abort(const char *str)
     __builtin_unreachable();
 }
 
+static inline struct malloc_cache *
+malloc_cache(void)
+{
+    return &cache;
+}
+
+/*
+ * Get the size class for a request of `size' bytes,
+ * `size' must not be larger than SMALL_MAX.
+ */
+static inline size_t
+size_to_class(size_t size)
+{
+    size_t lg;
+
+    if (size <= 128) {
+        return (size == 0) ? 0 : (size - 1) >> 4;
+    }
+
+    --size;
+    lg = (sizeof(long) * 8 - 1) - __builtin_clzl(size);
+    return 8 + ((lg - 7) * 4) + ((size >> (lg - 2)) & 3);
+}
+
+/* Bytes taken by one object of a class in a slab */
+static inline size_t
+slot_size(size_t class)
+{
+    return sizeof(struct mem_block) + class_size[class];
+}
+
+static inline struct mem_block *
+slab_slot(struct slab *slab, size_t i)
+{
+    return PTR_OFFSET(slab, sizeof(*slab) + (i * slot_size(slab->class)));
+}
+
 /*
- * Find a free block
+ * Map a new slab for a size class.
  *
- * TODO: This is currently a first-fit style
- *       routine. This should be best-fit instead
- *       as it doesn't waste memory.
+ * Returns NULL if out of memory.
+ */
+static struct slab *
+slab_new(size_t class)
+{
+    struct slab *slab;
+
+    slab = mmap(NULL, SLAB_SIZE, HEAP_PROT, MAP_ANON, 0, 0);
+    if (slab == NULL) {
+        return NULL;
+    }
+
+    slab->magic = HEAP_MAGIC;
+    slab->class = class;
+    slab->nobj = (SLAB_SIZE - sizeof(*slab)) / slot_size(class);
+    slab->nfree = slab->nobj;
+    slab->nused = 0;
+    slab->free = NULL;
+    return slab;
+}
+
+/*
+ * Take an object from a slab that has at least one
+ * free object. Freed objects are reused first, then
+ * untouched ones so a new slab is never walked.
  */
 static struct mem_block *
-malloc_find_free(size_t size)
+slab_get(struct slab *slab)
+{
+    struct mem_block *blk;
+
+    if ((blk = slab->free) != NULL) {
+        slab->free = *(struct mem_block **)(blk + 1);
+    } else {
+        blk = slab_slot(slab, slab->nused++);
+        blk->magic = HEAP_MAGIC;
+        blk->class = slab->class;
+        blk->slab = slab;
+    }
+
+    --slab->nfree;
+    return blk;
+}
+
+static void *
+malloc_small(size_t size)
 {
-    struct mem_block *cur = mem_head;
+    struct malloc_class *mc;
+    struct mem_block *blk;
+    struct slab *slab;
+    size_t class;
+
+    class = size_to_class(size);
+    mc = &malloc_cache()->classes[class];
 
-    while (cur != NULL) {
-        if (cur->size >= size) {
-            return cur;
+    if ((slab = TAILQ_FIRST(&mc->partial)) == NULL) {
+        if ((slab = mc->empty) != NULL) {
+            mc->empty = NULL;
+        } else if ((slab = slab_new(class)) == NULL) {
+            return NULL;
         }
 
-        cur = cur->next;
+        TAILQ_INSERT_HEAD(&mc->partial, slab, link);
+    }
+
+    blk = slab_get(slab);
+    if (slab->nfree == 0) {
+        TAILQ_REMOVE(&mc->partial, slab, link);
     }
 
-    return NULL;
+    blk->allocated = 1;
+    return blk + 1;
 }
 
-void *
-malloc(size_t size)
+static void
+free_small(struct mem_block *blk)
 {
-    struct mem_block *next_block;
-    struct mem_block *tail;
-    size_t inc_len = 0;
+    struct malloc_class *mc;
+    struct slab *slab = blk->slab;
+
+    if (slab->magic != HEAP_MAGIC || slab->class != blk->class) {
+        __heap_abort("free: bad slab detected\n");
+    }
+
+    mc = &malloc_cache()->classes[slab->class];
+    *(struct mem_block **)(blk + 1) = slab->free;
+    slab->free = blk;
 
-    size = ALIGN_UP(size, HEAP_ALIGN);
-    inc_len = sizeof(*next_block) + size;
+    /* Full slabs are not on the partial list */
+    if (slab->nfree++ == 0) {
+        TAILQ_INSERT_HEAD(&mc->partial, slab, link);
+    }
+    if (slab->nfree < slab->nobj) {
+        return;
+    }
 
-    if (heap_len < 0) {
-        heap_len = 0;
+    /* Keep one empty slab, give the rest back */
+    TAILQ_REMOVE(&mc->partial, slab, link);
+    if (mc->empty == NULL) {
+        mc->empty = slab;
+        return;
     }
 
-    if (heap_len < 0) {
-        heap_len = 0;
+    munmap(slab, SLAB_SIZE);
+}
+
+static void *
+malloc_large(size_t size)
+{
+    struct mem_block *blk;
+    size_t len;
+
+    if (size > (size_t)-1 - HEAP_PGSIZE - sizeof(*blk)) {
         return NULL;
     }
 
-    /* Any memory left to allocate? */
-    if ((heap_len + inc_len) >= HEAP_SIZE) {
+    len = ALIGN_UP(size + sizeof(*blk), HEAP_PGSIZE);
+    blk = mmap(NULL, len, HEAP_PROT, MAP_ANON, 0, 0);
+    if (blk == NULL) {
         return NULL;
     }
 
-    if (heap_pos >= HEAP_SIZE - inc_len) {
-        wrap = true;
-        mem_tail = mem_head;
+    blk->magic = HEAP_MAGIC;
+    blk->class = CLASS_LARGE;
+    blk->allocated = 1;
+    blk->len = len;
+    return blk + 1;
+}
+
+/*
+ * Get the header of an allocated object, aborting
+ * on anything that did not come from malloc().
+ */
+static struct mem_block *
+ptr_to_block(void *ptr, const char *func)
+{
+    struct mem_block *blk = (struct mem_block *)ptr - 1;
+
+    if (blk->magic != HEAP_MAGIC) {
+        printf("%s: ", func);
+        __heap_abort("bad block detected\n");
+    }
+    if (!blk->allocated) {
+        printf("%s: ", func);
+        __heap_abort("double free detected\n");
     }
 
-    tail = wrap ? malloc_find_free(size) : mem_tail;
-    if (tail == NULL) {
-        return NULL;
+    return blk;
+}
+
+/* Usable bytes of an allocated object */
+static inline size_t
+block_size(const struct mem_block *blk)
+{
+    if (blk->class == CLASS_LARGE) {
+        return blk->len - sizeof(*blk);
+    }
+
+    return class_size[blk->class];
+}
+
+void *
+malloc(size_t size)
+{
+    if (size <= SMALL_MAX) {
+        return malloc_small(size);
     }
 
-    next_block = mem_tail;
-    mem_tail = HEAP_NEXT(mem_tail, size);
-    mem_tail->next = NULL;
+    return malloc_large(size);
+}
 
-    next_block->next = mem_tail;
-    next_block->size = size;
-    next_block->allocated = 1;
-    next_block->magic = HEAP_MAGIC;
+void *
+calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+    size_t len;
+
+    if (__builtin_mul_overflow(nmemb, size, &len)) {
+        return NULL;
+    }
+    if ((ptr = malloc(len)) == NULL) {
+        return NULL;
+    }
+
+    /* Fresh mappings are already zeroed */
+    if (len <= SMALL_MAX) {
+        memset(ptr, 0, len);
+    }
 
-    heap_len += inc_len;
-    heap_pos += inc_len;
-    return PTR_OFFSET(next_block, sizeof(*next_block));
+    return ptr;
 }
 
 void *
@@ -169,17 +392,25 @@ realloc(void *ptr, size_t size)
 {
     struct mem_block *blk;
     void *new_buf;
+    size_t old_size;
 
-    blk = PTR_NOFFSET(ptr, sizeof(*blk));
-    if (blk->magic != HEAP_MAGIC) {
-        __heap_abort("realloc: bad realloc block detected\n");
+    if (ptr == NULL) {
+        return malloc(size);
     }
-    if (!blk->allocated) {
-        __heap_abort("realloc: bad realloc\n");
+
+    blk = ptr_to_block(ptr, "realloc");
+    old_size = block_size(blk);
+
+    /* Still fits and not worth shrinking */
+    if (size <= old_size && size > old_size / 2) {
+        return ptr;
+    }
+
+    if ((new_buf = malloc(size)) == NULL) {
+        return NULL;
     }
 
-    new_buf = malloc(size);
-    memcpy(new_buf, ptr, blk->size);
+    memcpy(new_buf, ptr, MIN(size, old_size));
     free(ptr);
     return new_buf;
 }
@@ -189,31 +420,28 @@ free(void *ptr)
 {
     struct mem_block *blk;
 
-    blk = PTR_NOFFSET(ptr, sizeof(*blk));
-    if (blk->magic != HEAP_MAGIC) {
-        __heap_abort("free: bad free block detected\n");
-    }
-    if (!blk->allocated) {
-        __heap_abort("free: double free detected\n");
+    if (ptr == NULL) {
+        return;
     }
 
+    blk = ptr_to_block(ptr, "free");
     blk->allocated = 0;
-    heap_len -= (blk->size + sizeof(*blk));
-    if (heap_len < 0) {
-        heap_len = 0;
+
+    if (blk->class == CLASS_LARGE) {
+        munmap(blk, blk->len);
+        return;
     }
+
+    free_small(blk);
 }
 
 void
 __malloc_mem_init(void)
 {
-    mem_head = mmap(NULL, HEAP_SIZE, HEAP_PROT, MAP_ANON, 0, 0);
-    if (mem_head == NULL) {
-        __heap_abort("__malloc_mem_init: mem_head is NULL, out of memory\n");
-    }
+    struct malloc_cache *mcp = malloc_cache();
 
-    mem_head->size = 0;
-    mem_head->next = NULL;
-    mem_head->allocated = 0;
-    mem_tail = mem_head;
+    for (size_t i = 0; i < NCLASS; ++i) {
+        TAILQ_INIT(&mcp->classes[i].partial);
+        mcp->classes[i].empty = NULL;
+    }
 }
@@ -28,18 +28,27 @@
  */
 
 #include <string.h>
+#include "word.h"
 
 int
 memcmp(const void *s1, const void *s2, size_t n)
 {
-	if (n != 0) {
-        const unsigned char *p1 = s1, *p2 = s2;
+    const unsigned char *p1 = s1, *p2 = s2;
 
-		do {
-			if (*p1++ != *p2++) {
-				return (*--p1 - *--p2);
-            }
-		} while (--n != 0);
+    /* Skip over equal words, the bytes tell the order */
+    while (n >= WSIZE) {
+        if (*(const uword_t *)p1 != *(const uword_t *)p2)
+            break;
+
+        p1 += WSIZE;
+        p2 += WSIZE;
+        n -= WSIZE;
+    }
+
+    for (; n != 0; --n, ++p1, ++p2) {
+        if (*p1 != *p2)
+            return *p1 - *p2;
     }
-	return 0;
+
+    return 0;
 }
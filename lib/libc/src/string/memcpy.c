@@ -28,13 +28,89 @@
  */
 
 #include <string.h>
+#include "word.h"
 
+#if defined(__x86_64__)
+/*
+ * Copies and fills from these sizes on are done with
+ * rep movs/stos (see arch/amd64/string.S), using the
+ * byte forms if `__string_erms' is set.
+ */
+size_t __string_rep_min = 1024;
+uint8_t __string_erms = 0;
+
+static inline void
+string_cpuid(uint32_t leaf, uint32_t regs[4])
+{
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "0" (leaf), "2" (0)
+    );
+}
+#endif  /* __x86_64__ */
+
+/*
+ * Tune the string routines for the CPU, called once
+ * at startup.
+ */
+void
+__libc_string_init(void)
+{
+#if defined(__x86_64__)
+    uint32_t regs[4];
+
+    string_cpuid(0, regs);
+    if (regs[0] < 7) {
+        return;
+    }
+
+    /*
+     * Enhanced rep movsb/stosb (ERMS) is CPUID.(EAX=7H):
+     * EBX[9], fast short rep movsb (FSRM) is EDX[4] and
+     * makes rep worth it for much smaller sizes.
+     */
+    string_cpuid(7, regs);
+    if ((regs[3] & (1U << 4)) != 0) {
+        __string_erms = 1;
+        __string_rep_min = 128;
+    } else if ((regs[1] & (1U << 9)) != 0) {
+        __string_erms = 1;
+        __string_rep_min = 512;
+    }
+#endif  /* __x86_64__ */
+}
+
+#if !defined(__x86_64__)
+/* See arch/amd64/string.S for amd64 */
 void *
 memcpy(void *dest, const void *src, size_t n)
 {
-    for (size_t i = 0; i < n; ++i) {
-        ((char *)dest)[i] = ((char *)src)[i];
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+    word_t *wd;
+    const word_t *ws;
+
+    /* Copy by words if both can be aligned together */
+    if ((((uintptr_t)d ^ (uintptr_t)s) & WMASK) == 0) {
+        for (; n != 0 && !WALIGNED(d); --n) {
+            *d++ = *s++;
+        }
+
+        wd = (word_t *)d;
+        ws = (const word_t *)s;
+        for (; n >= WSIZE; n -= WSIZE) {
+            *wd++ = *ws++;
+        }
+
+        d = (unsigned char *)wd;
+        s = (const unsigned char *)ws;
+    }
+
+    for (; n != 0; --n) {
+        *d++ = *s++;
     }
 
     return dest;
 }
+#endif  /* !__x86_64__ */
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+#include "word.h"
+
+/*
+ * Copy that allows `dest' and `src' to overlap, only
+ * a destination above the source needs copying from
+ * the end.
+ */
+void *
+memmove(void *dest, const void *src, size_t n)
+{
+    unsigned char *d = dest;
+    const unsigned char *s = src;
+    word_t *wd;
+    const word_t *ws;
+
+    if (d <= s || d >= s + n) {
+        /* memcpy() copies forwards, which is safe here */
+        return memcpy(dest, src, n);
+    }
+
+    d += n;
+    s += n;
+
+    /* Copy back by words if both can be aligned together */
+    if ((((uintptr_t)d ^ (uintptr_t)s) & WMASK) == 0) {
+        for (; n != 0 && !WALIGNED(d); --n) {
+            *--d = *--s;
+        }
+
+        wd = (word_t *)d;
+        ws = (const word_t *)s;
+        for (; n >= WSIZE; n -= WSIZE) {
+            *--wd = *--ws;
+        }
+
+        d = (unsigned char *)wd;
+        s = (const unsigned char *)ws;
+    }
+
+    for (; n != 0; --n) {
+        *--d = *--s;
+    }
+
+    return dest;
+}
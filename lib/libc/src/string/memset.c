@@ -1,4 +1,3 @@
-
 /*
  * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
  * All rights reserved.
@@ -29,17 +28,30 @@
  */
 
 #include <string.h>
+#include "word.h"
 
+#if !defined(__x86_64__)
+/* See arch/amd64/string.S for amd64 */
 void *
 memset(void *dst, int c, size_t n)
 {
-    char *p = dst;
+    unsigned char *p = dst;
+    word_t *wp;
+    word_t w;
+
+    for (; n != 0 && !WALIGNED(p); --n) {
+        *p++ = (unsigned char)c;
+    }
+
+    w = WONES * (unsigned char)c;
+    for (wp = (word_t *)p; n >= WSIZE; n -= WSIZE) {
+        *wp++ = w;
+    }
 
-    if (n != 0) {
-        do {
-            *p++ = (unsigned char)c;
-        } while (--n != 0);
+    for (p = (unsigned char *)wp; n != 0; --n) {
+        *p++ = (unsigned char)c;
     }
 
     return dst;
 }
+#endif  /* !__x86_64__ */
@@ -28,15 +28,39 @@
  */
 
 #include <string.h>
+#include "word.h"
 
 int
 strcmp(const char *s1, const char *s2)
 {
-    while (*s1 == *s2++) {
-        if (*s1++ == 0) {
-            return (0);
+    const word_t *w1, *w2;
+
+    /*
+     * Compare a word at a time if both strings can be
+     * word aligned together, otherwise loads on the
+     * second string could cross into the next page.
+     */
+    if ((((uintptr_t)s1 ^ (uintptr_t)s2) & WMASK) == 0) {
+        for (; !WALIGNED(s1); ++s1, ++s2) {
+            if (*s1 != *s2 || *s1 == '\0')
+                goto done;
+        }
+
+        w1 = (const word_t *)s1;
+        w2 = (const word_t *)s2;
+        while (*w1 == *w2 && !WHASZERO(*w1)) {
+            ++w1;
+            ++w2;
         }
+
+        s1 = (const char *)w1;
+        s2 = (const char *)w2;
     }
 
-    return (*(unsigned char *)s1 - *(unsigned char *)--s2);
+    while (*s1 == *s2 && *s1 != '\0') {
+        ++s1;
+        ++s2;
+    }
+done:
+    return *(unsigned char *)s1 - *(unsigned char *)s2;
 }
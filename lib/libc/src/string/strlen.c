@@ -28,13 +28,21 @@
  */
 
 #include <string.h>
+#include "word.h"
 
 size_t
 strlen(const char *s)
 {
-    size_t len;
+    const char *p = s;
+    const word_t *wp;
 
-    len = 0;
-    while (s[len++]);
-    return len - 1;
+    for (; !WALIGNED(p); ++p) {
+        if (*p == '\0')
+            return p - s;
+    }
+
+    /* Skip whole words until one has a NUL in it */
+    for (wp = (const word_t *)p; !WHASZERO(*wp); ++wp);
+    for (p = (const char *)wp; *p != '\0'; ++p);
+    return p - s;
 }
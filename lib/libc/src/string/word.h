@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _LIBC_STRING_WORD_H_
+#define _LIBC_STRING_WORD_H_
+
+#include <sys/cdefs.h>
+#include <stdint.h>
+
+/*
+ * Helpers for the word-at-a-time string routines.
+ *
+ * Word loads are only done on aligned addresses so a
+ * load never crosses into a page the string does not
+ * touch. `uword_t' may also be used for unaligned loads
+ * that are known to stay within the buffer.
+ */
+typedef uintptr_t __attribute__((__may_alias__)) word_t;
+typedef uintptr_t __attribute__((__may_alias__)) __aligned(1) uword_t;
+
+#define WSIZE       sizeof(word_t)
+#define WMASK       (WSIZE - 1)
+#define WONES       ((word_t)-1 / 0xFF)
+#define WHIGHS      (WONES * 0x80)
+
+/* Nonzero if any byte of `w' is zero */
+#define WHASZERO(w) (((w) - WONES) & ~(w) & WHIGHS)
+
+/* True if `p' is word aligned */
+#define WALIGNED(p) (((uintptr_t)(p) & WMASK) == 0)
+
+#endif  /* !_LIBC_STRING_WORD_H_ */
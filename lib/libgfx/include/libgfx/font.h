@@ -27,14 +27,14 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#ifndef _KFGWM_FONT_H_
-#define _KFGWM_FONT_H_
+#ifndef _LIBGFX_FONT_H_
+#define _LIBGFX_FONT_H_
 
-#include <sys/types.h>
+#include <stdint.h>
 
-#define FONT_WIDTH 8
-#define FONT_HEIGHT 16
+#define GFX_FONT_WIDTH  8
+#define GFX_FONT_HEIGHT 16
 
-extern const uint8_t g_KFG_FONT[];
+extern const uint8_t g_GFX_FONT[];
 
-#endif  /* !_KFGWM_FONT_H_ */
+#endif  /* !_LIBGFX_FONT_H_ */
@@ -31,6 +31,7 @@
 #define _LIBGFX_H_
 
 #include <sys/fbdev.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 
@@ -54,21 +55,51 @@ typedef uint32_t cartpos_t;
 typedef cartpos_t scrpos_t;
 typedef cartpos_t dimm_t;   /* Dimensions */
 
+/* Dirty rectangles tracked before falling back to one */
+#define GFX_MAX_DIRTY 32
+
+/* Context flags */
+#define GFX_BACKBUF 0x00000001  /* Drawing goes to a back buffer */
+
+/*
+ * A rectangle of the back buffer that changed since
+ * the last gfx_present()
+ */
+struct gfx_dirty {
+    scrpos_t x, y;
+    dimm_t width;
+    dimm_t height;
+};
+
 /*
  * Graphics context for libgfx
  *
  * @fbdev: Framebuffer attributes
- * @io: Framebuffer pointer
+ * @io: Where drawing goes, the back buffer if there
+ *      is one, otherwise the framebuffer.
+ * @fb: Framebuffer pointer
  * @fbfd: Framebuffer file descriptor
+ * @flags: Context flags (see GFX_*)
+ * @ndirty: Entries used in `dirty'
+ * @dirty: Areas of the back buffer not yet presented
  */
 struct gfx_ctx {
     struct fbattr fbdev;
     size_t fb_size;
     pixel_t *io;
+    pixel_t *fb;
     int fbfd;
+    uint32_t flags;
+    uint32_t ndirty;
+    struct gfx_dirty dirty[GFX_MAX_DIRTY];
 };
 
 int gfx_init(struct gfx_ctx *res);
 void gfx_cleanup(struct gfx_ctx *ctx);
 
+int gfx_backbuf(struct gfx_ctx *ctx);
+void gfx_mark_dirty(struct gfx_ctx *ctx, scrpos_t x, scrpos_t y, dimm_t w,
+    dimm_t h);
+int gfx_present(struct gfx_ctx *ctx);
+
 #endif  /* !_LIBGFX_H_ */
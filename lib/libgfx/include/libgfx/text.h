@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _LIBGFX_TEXT_H_
+#define _LIBGFX_TEXT_H_
+
+#include <stddef.h>
+#include <libgfx/gfx.h>
+#include <libgfx/font.h>
+
+/*
+ * Glyph cache geometry, GFX_GLYPH_SETS sets of
+ * GFX_GLYPH_WAYS glyphs each.
+ */
+#define GFX_GLYPH_SETS 32
+#define GFX_GLYPH_WAYS 4
+
+/*
+ * A glyph expanded for one color pair, each row is
+ * ready to be copied to the screen as is.
+ *
+ * @fg: Foreground color
+ * @bg: Background color
+ * @ch: Character this glyph is for
+ * @stamp: Last use, for LRU eviction
+ * @px: Expanded pixel rows
+ */
+struct gfx_glyph {
+    color_t fg;
+    color_t bg;
+    uint32_t ch;
+    uint32_t stamp;
+    pixel_t px[GFX_FONT_HEIGHT][GFX_FONT_WIDTH];
+};
+
+/*
+ * A run of text to draw on one line
+ *
+ * @text: Characters to draw
+ * @len: Number of characters in `text'
+ * @x,y: Top left of the first character
+ * @fg: Foreground color
+ * @bg: Background color
+ */
+struct gfx_text {
+    const char *text;
+    size_t len;
+    scrpos_t x, y;
+    color_t fg;
+    color_t bg;
+};
+
+int gfx_draw_text(struct gfx_ctx *ctx, const struct gfx_text *tp);
+
+#endif  /* !_LIBGFX_TEXT_H_ */
@@ -28,7 +28,10 @@
  */
 
 #include <sys/errno.h>
+#include <sys/param.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <libgfx/gfx.h>
 #include <libgfx/draw.h>
 
@@ -65,6 +68,83 @@ gfx_pixel_bounds(struct gfx_ctx *ctx, uint32_t x, uint32_t y)
     return 0;
 }
 
+/*
+ * Clip a rectangle to the screen.
+ *
+ * @ctx: Graphics context pointer
+ * @x,y: Position of the rectangle
+ * @w,h: Size, updated to the clipped one
+ *
+ * Returns false if nothing is left on screen.
+ */
+static bool
+gfx_clip(struct gfx_ctx *ctx, scrpos_t x, scrpos_t y, dimm_t *w, dimm_t *h)
+{
+    struct fbattr *fbdev = &ctx->fbdev;
+
+    if (x >= fbdev->width || y >= fbdev->height) {
+        return false;
+    }
+
+    *w = MIN(*w, fbdev->width - x);
+    *h = MIN(*h, fbdev->height - y);
+    return *w != 0 && *h != 0;
+}
+
+/*
+ * Fill a run of pixels on one scanline, two pixels
+ * are stored at a time once `p' is 8 byte aligned.
+ */
+static inline void
+gfx_fill_span(pixel_t *p, color_t color, size_t n)
+{
+    uint64_t pair, *pp;
+
+    if (((uintptr_t)p & 7) != 0 && n > 0) {
+        *p++ = color;
+        --n;
+    }
+
+    pair = ((uint64_t)color << 32) | color;
+    pp = (uint64_t *)p;
+    for (; n >= 8; n -= 8) {
+        pp[0] = pair;
+        pp[1] = pair;
+        pp[2] = pair;
+        pp[3] = pair;
+        pp += 4;
+    }
+
+    for (p = (pixel_t *)pp; n > 0; --n) {
+        *p++ = color;
+    }
+}
+
+/*
+ * Fill a rectangle, clipped to the screen once and
+ * then drawn a scanline at a time.
+ */
+static void
+gfx_fill_rect(struct gfx_ctx *ctx, scrpos_t x, scrpos_t y, dimm_t w, dimm_t h,
+    color_t color)
+{
+    size_t stride;
+    pixel_t *row;
+
+    if (!gfx_clip(ctx, x, y, &w, &h)) {
+        return;
+    }
+
+    stride = ctx->fbdev.pitch / 4;
+    row = &ctx->io[gfx_io_index(ctx, x, y)];
+    for (dimm_t i = 0; i < h; ++i) {
+        gfx_fill_span(row, color, w);
+        row += stride;
+    }
+
+    gfx_mark_dirty(ctx, x, y, w, h);
+}
+
 /*
  * Draw a classic square onto the screen.
  *
@@ -74,23 +154,12 @@ gfx_pixel_bounds(struct gfx_ctx *ctx, uint32_t x, uint32_t y)
 static int
 gfx_draw_square(struct gfx_ctx *ctx, const struct gfx_shape *shape)
 {
-    struct fbattr fbdev;
-    struct gfx_point p;
-    off_t idx;
-    scrpos_t x, y;
-
     if (ctx == NULL || shape == NULL) {
         return -EINVAL;
     }
 
-    for (x = shape->x; x < shape->x + shape->width; ++x) {
-        for (y = shape->y; y < shape->y + shape->height; ++y) {
-            p.x = x;
-            p.y = y;
-            p.rgb = shape->color;
-            gfx_plot_point(ctx, &p);
-        }
-    }
+    gfx_fill_rect(ctx, shape->x, shape->y, shape->width, shape->height,
+        shape->color);
     return 0;
 }
 
@@ -103,47 +172,39 @@ gfx_draw_square(struct gfx_ctx *ctx, const struct gfx_shape *shape)
 static int
 gfx_draw_bsquare(struct gfx_ctx *ctx, const struct gfx_shape *shape)
 {
-    struct gfx_point p;
     scrpos_t x_i, y_i;
     scrpos_t x_f, y_f;
-    scrpos_t x, y;
+    dimm_t w, h;
 
     if (ctx == NULL || shape == NULL) {
         return -EINVAL;
     }
 
+    w = shape->width;
+    h = shape->height;
+    if (w == 0 || h == 0) {
+        return 0;
+    }
+
     x_i = shape->x;
     y_i = shape->y;
-    x_f = shape->x + shape->width;
-    y_f = shape->y + shape->height;
+    x_f = shape->x + w - 1;
+    y_f = shape->y + h - 1;
 
     /*
      * Draw an unfilled square.
      *
-     * If we are at the `y_i' or `y_f' position, draw
-     * pixels from 'x_i' to 'x_f'. If we are away
-     * from the `y_i' position, draw two pixels,
-     * one at `x_i' and the other at `x_f' for that
-     * current 'y' value.
+     * The top and bottom edges are full spans from
+     * `x_i' to `x_f', the sides are one pixel wide
+     * columns between them.
      */
-    for (y = y_i; y < y_f; ++y) {
-        for (x = x_i; x < x_f; ++x) {
-            p.x = x;
-            p.y = y;
-            p.rgb = shape->color;
-
-            /* Origin y, draw entire width */
-            if (y == y_i || y == y_f - 1) {
-                gfx_plot_point(ctx, &p);
-                continue;
-            }
-
-            p.x = x_i;
-            gfx_plot_point(ctx, &p);
-
-            p.x = x_f - 1;
-            gfx_plot_point(ctx, &p);
-        }
+    gfx_fill_rect(ctx, x_i, y_i, w, 1, shape->color);
+    if (h > 1) {
+        gfx_fill_rect(ctx, x_i, y_f, w, 1, shape->color);
+    }
+    if (h > 2) {
+        gfx_fill_rect(ctx, x_i, y_i + 1, 1, h - 2, shape->color);
+        gfx_fill_rect(ctx, x_f, y_i + 1, 1, h - 2, shape->color);
     }
 
     return 0;
@@ -179,6 +240,7 @@ gfx_plot_point(struct gfx_ctx *ctx, const struct gfx_point *point)
     /* Plot it !! */
     index = gfx_io_index(ctx, point->x, point->y);
     ctx->io[index] = point->rgb;
+    gfx_mark_dirty(ctx, point->x, point->y, 1, 1);
     return 0;
 }
 
@@ -247,13 +309,17 @@ gfx_draw_shape(struct gfx_ctx *ctx, const struct gfx_shape *shape)
  * @r: Region to copy
  * @x: X position for copy dest
  * @y: Y position for copy dest
+ *
+ * Source and destination are clipped to the screen
+ * and may overlap. Scanlines are moved whole and
+ * walked bottom up when copying downwards so rows
+ * are read before they are overwritten.
  */
 int
 gfx_copy_region(struct gfx_ctx *ctx, struct gfx_region *r, scrpos_t x, scrpos_t y)
 {
-    struct gfx_point point;
-    color_t pixel;
-    scrpos_t src_cx, src_cy;
+    pixel_t *src, *dst;
+    ssize_t stride;
     dimm_t w, h;
 
     if (ctx == NULL || r == NULL) {
@@ -262,21 +328,28 @@ gfx_copy_region(struct gfx_ctx *ctx, struct gfx_region *r, scrpos_t x, scrpos_t
 
     w = r->width;
     h = r->height;
+    if (!gfx_clip(ctx, r->x, r->y, &w, &h)) {
+        return 0;
+    }
+    if (!gfx_clip(ctx, x, y, &w, &h)) {
+        return 0;
+    }
+
+    stride = ctx->fbdev.pitch / 4;
+    src = &ctx->io[gfx_io_index(ctx, r->x, r->y)];
+    dst = &ctx->io[gfx_io_index(ctx, x, y)];
+    if (y > r->y) {
+        src += (h - 1) * stride;
+        dst += (h - 1) * stride;
+        stride = -stride;
+    }
 
-    for (int xoff = 0; xoff < w; ++xoff) {
-        for (int yoff = 0; yoff < h; ++yoff) {
-            /* Source position */
-            src_cx = r->x + xoff;
-            src_cy = r->y + yoff;
-
-            /* Plot the new pixel */
-            pixel = gfx_get_pix(ctx, src_cx, src_cy);
-            point.x = x + xoff;
-            point.y = y + yoff;
-            point.rgb = pixel;
-            gfx_plot_point(ctx, &point);
-        }
+    for (dimm_t i = 0; i < h; ++i) {
+        memmove(dst, src, w * sizeof(pixel_t));
+        src += stride;
+        dst += stride;
     }
 
+    gfx_mark_dirty(ctx, x, y, w, h);
     return 0;
 }
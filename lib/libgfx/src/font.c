@@ -27,13 +27,15 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <sys/errno.h>
-#include <kfg/font.h>
-#include <fcntl.h>
-#include <unistd.h>
+#include <libgfx/font.h>
 
-/* TODO: Open a .psf font and get rid of this */
-const uint8_t g_KFG_FONT[] = {
+/*
+ * 8x16 bitmap font, one byte per row with
+ * the leftmost pixel in the high bit.
+ *
+ * TODO: Open a .psf font and get rid of this
+ */
+const uint8_t g_GFX_FONT[] = {
   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x42, 0x81, 0x81, 0xa5, 0xa5, 0x81,
   0x81, 0xa5, 0x99, 0x81, 0x42, 0x3c, 0x00, 0x00, 0x00, 0x3c, 0x7e, 0xff,
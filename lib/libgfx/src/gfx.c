@@ -30,7 +30,10 @@
 #include <sys/errno.h>
 #include <sys/mman.h>
 #include <sys/fbdev.h>
+#include <sys/param.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <libgfx/gfx.h>
@@ -80,6 +83,192 @@ gfx_init(struct gfx_ctx *res)
         return -1;
     }
 
+    res->fb = res->io;
+    res->flags = 0;
+    res->ndirty = 0;
+    return 0;
+}
+
+/*
+ * Draw into a back buffer in system memory from now
+ * on, the framebuffer is only written by gfx_present().
+ * Reading pixels back and redrawing the same area many
+ * times is then cheap and partial frames are never seen.
+ *
+ * @ctx: Graphics context pointer
+ *
+ * Returns 0 on success, otherwise a less than zero
+ * value.
+ */
+int
+gfx_backbuf(struct gfx_ctx *ctx)
+{
+    pixel_t *buf;
+
+    if (ctx == NULL) {
+        return -EINVAL;
+    }
+    if (ISSET(ctx->flags, GFX_BACKBUF)) {
+        return 0;
+    }
+
+    if ((buf = malloc(ctx->fb_size)) == NULL) {
+        return -ENOMEM;
+    }
+
+    /* Start from what is on screen, the only read back */
+    memcpy(buf, ctx->fb, ctx->fb_size);
+    ctx->io = buf;
+    ctx->ndirty = 0;
+    ctx->flags |= GFX_BACKBUF;
+    return 0;
+}
+
+/*
+ * Record that an area of the back buffer changed. The
+ * drawing routines do this themselves, only direct
+ * writes to `io' need it.
+ *
+ * @ctx: Graphics context pointer
+ * @x,y: Position of the area
+ * @w,h: Size of the area
+ */
+void
+gfx_mark_dirty(struct gfx_ctx *ctx, scrpos_t x, scrpos_t y, dimm_t w, dimm_t h)
+{
+    struct gfx_dirty *dp;
+    scrpos_t x_f, y_f;
+
+    if (!ISSET(ctx->flags, GFX_BACKBUF)) {
+        return;
+    }
+    if (x >= ctx->fbdev.width || y >= ctx->fbdev.height) {
+        return;
+    }
+
+    w = MIN(w, ctx->fbdev.width - x);
+    h = MIN(h, ctx->fbdev.height - y);
+    if (w == 0 || h == 0) {
+        return;
+    }
+
+    /* Already covered? */
+    for (uint32_t i = 0; i < ctx->ndirty; ++i) {
+        dp = &ctx->dirty[i];
+        if (x >= dp->x && y >= dp->y &&
+            x + w <= dp->x + dp->width && y + h <= dp->y + dp->height) {
+            return;
+        }
+    }
+
+    if (ctx->ndirty < GFX_MAX_DIRTY) {
+        dp = &ctx->dirty[ctx->ndirty++];
+        dp->x = x;
+        dp->y = y;
+        dp->width = w;
+        dp->height = h;
+        return;
+    }
+
+    /* Out of entries, fold everything into one */
+    x_f = x + w;
+    y_f = y + h;
+    for (uint32_t i = 0; i < ctx->ndirty; ++i) {
+        dp = &ctx->dirty[i];
+        x = MIN(x, dp->x);
+        y = MIN(y, dp->y);
+        x_f = MAX(x_f, dp->x + dp->width);
+        y_f = MAX(y_f, dp->y + dp->height);
+    }
+
+    dp = &ctx->dirty[0];
+    dp->x = x;
+    dp->y = y;
+    dp->width = x_f - x;
+    dp->height = y_f - y;
+    ctx->ndirty = 1;
+}
+
+/*
+ * Merge dirty rectangles whose bounding box is no
+ * larger than the two of them apart, so overlapping
+ * and touching areas are only copied once.
+ */
+static void
+gfx_coalesce(struct gfx_ctx *ctx)
+{
+    struct gfx_dirty *a, *b;
+    scrpos_t x, y, x_f, y_f;
+    size_t area;
+    bool merged;
+
+    do {
+        merged = false;
+        for (uint32_t i = 0; i < ctx->ndirty; ++i) {
+            for (uint32_t j = i + 1; j < ctx->ndirty; ++j) {
+                a = &ctx->dirty[i];
+                b = &ctx->dirty[j];
+                x = MIN(a->x, b->x);
+                y = MIN(a->y, b->y);
+                x_f = MAX(a->x + a->width, b->x + b->width);
+                y_f = MAX(a->y + a->height, b->y + b->height);
+
+                area = (size_t)a->width * a->height;
+                area += (size_t)b->width * b->height;
+                if ((size_t)(x_f - x) * (y_f - y) > area) {
+                    continue;
+                }
+
+                a->x = x;
+                a->y = y;
+                a->width = x_f - x;
+                a->height = y_f - y;
+                *b = ctx->dirty[--ctx->ndirty];
+                merged = true;
+                --j;
+            }
+        }
+    } while (merged);
+}
+
+/*
+ * Copy everything drawn since the last call from the
+ * back buffer to the framebuffer, a scanline of each
+ * dirty rectangle at a time.
+ *
+ * @ctx: Graphics context pointer
+ *
+ * Returns 0 on success, otherwise a less than zero
+ * value.
+ */
+int
+gfx_present(struct gfx_ctx *ctx)
+{
+    struct gfx_dirty *dp;
+    size_t stride, off;
+    dimm_t w, h;
+
+    if (ctx == NULL) {
+        return -EINVAL;
+    }
+    if (!ISSET(ctx->flags, GFX_BACKBUF)) {
+        return 0;
+    }
+
+    gfx_coalesce(ctx);
+    stride = ctx->fbdev.pitch / 4;
+    for (uint32_t i = 0; i < ctx->ndirty; ++i) {
+        dp = &ctx->dirty[i];
+        w = dp->width;
+        h = dp->height;
+        off = dp->x + dp->y * stride;
+        for (dimm_t row = 0; row < h; ++row) {
+            memcpy(&ctx->fb[off], &ctx->io[off], w * sizeof(pixel_t));
+            off += stride;
+        }
+    }
+
+    ctx->ndirty = 0;
     return 0;
 }
 
@@ -90,8 +279,10 @@ gfx_init(struct gfx_ctx *res)
 void
 gfx_cleanup(struct gfx_ctx *ctx)
 {
-    if (ctx->io != NULL)
-        munmap(ctx->io, ctx->fb_size);
+    if (ISSET(ctx->flags, GFX_BACKBUF))
+        free(ctx->io);
+    if (ctx->fb != NULL)
+        munmap(ctx->fb, ctx->fb_size);
     if (ctx->fbfd > 0)
         close(ctx->fbfd);
 }
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/errno.h>
+#include <sys/param.h>
+#include <string.h>
+#include <libgfx/gfx.h>
+#include <libgfx/text.h>
+
+/* Glyphs looked up per batch of rows drawn */
+#define GLYPH_BATCH 64
+
+static struct gfx_glyph glyph_cache[GFX_GLYPH_SETS][GFX_GLYPH_WAYS];
+static uint32_t glyph_clock = 0;
+
+/*
+ * Pick the cache set for a character and color pair,
+ * mostly by the character so a run in one color
+ * spreads over every set.
+ */
+static inline size_t
+glyph_set(uint8_t ch, color_t fg, color_t bg)
+{
+    return (ch ^ (fg >> 3) ^ (bg >> 7)) % GFX_GLYPH_SETS;
+}
+
+/*
+ * Expand a character of the font into ready to
+ * copy pixel rows.
+ */
+static void
+glyph_expand(struct gfx_glyph *gp, uint8_t ch, color_t fg, color_t bg)
+{
+    const uint8_t *bits;
+
+    bits = &g_GFX_FONT[ch * GFX_FONT_HEIGHT];
+    for (int y = 0; y < GFX_FONT_HEIGHT; ++y) {
+        for (int x = 0; x < GFX_FONT_WIDTH; ++x) {
+            gp->px[y][x] = ISSET(bits[y], BIT(7 - x)) ? fg : bg;
+        }
+    }
+
+    gp->ch = ch;
+    gp->fg = fg;
+    gp->bg = bg;
+}
+
+/*
+ * Get a glyph for a character in a color pair,
+ * expanding it over the least recently used one
+ * in its set if it is not cached.
+ *
+ * @pin: Glyphs used after this stamp are still
+ *       needed and are never evicted.
+ *
+ * Returns NULL if the glyph is not cached and every
+ * glyph in its set is pinned.
+ */
+static const struct gfx_glyph *
+glyph_get(uint8_t ch, color_t fg, color_t bg, uint32_t pin)
+{
+    struct gfx_glyph *set, *gp, *victim;
+
+    set = glyph_cache[glyph_set(ch, fg, bg)];
+    victim = &set[0];
+    ++glyph_clock;
+
+    for (int i = 0; i < GFX_GLYPH_WAYS; ++i) {
+        gp = &set[i];
+        if (gp->stamp != 0 && gp->ch == ch && gp->fg == fg && gp->bg == bg) {
+            gp->stamp = glyph_clock;
+            return gp;
+        }
+        if (gp->stamp < victim->stamp) {
+            victim = gp;
+        }
+    }
+
+    if (victim->stamp > pin) {
+        return NULL;
+    }
+
+    glyph_expand(victim, ch, fg, bg);
+    victim->stamp = glyph_clock;
+    return victim;
+}
+
+/*
+ * Draw a run of text on one line, clipped to the
+ * screen. Glyphs are looked up once per batch and
+ * the batch is then drawn a scanline at a time, one
+ * whole glyph row per character, so the framebuffer
+ * is written in order.
+ *
+ * @ctx: Graphics context pointer
+ * @tp: Text to draw
+ *
+ * Returns 0 on success, otherwise a less than zero
+ * value.
+ */
+int
+gfx_draw_text(struct gfx_ctx *ctx, const struct gfx_text *tp)
+{
+    const struct gfx_glyph *batch[GLYPH_BATCH];
+    size_t stride, len, n, tail;
+    uint32_t pin;
+    dimm_t w, h;
+    scrpos_t x;
+    pixel_t *row, *p;
+
+    if (ctx == NULL || tp == NULL || tp->text == NULL) {
+        return -EINVAL;
+    }
+    if (tp->x >= ctx->fbdev.width || tp->y >= ctx->fbdev.height) {
+        return 0;
+    }
+
+    /* Keep to what fits on screen */
+    w = ctx->fbdev.width - tp->x;
+    h = MIN(ctx->fbdev.height - tp->y, GFX_FONT_HEIGHT);
+    len = MIN(tp->len, ALIGN_UP(w, GFX_FONT_WIDTH) / GFX_FONT_WIDTH);
+    if (len == 0) {
+        return 0;
+    }
+
+    /* Pixels of the last glyph that are on screen */
+    tail = MIN(w - (len - 1) * GFX_FONT_WIDTH, GFX_FONT_WIDTH);
+
+    stride = ctx->fbdev.pitch / 4;
+    x = tp->x;
+    for (size_t i = 0; i < len; i += n) {
+        /*
+         * Glyphs of this batch stay pinned until it
+         * is drawn, if a set runs out of glyphs to
+         * evict the batch ends early.
+         */
+        n = MIN(len - i, GLYPH_BATCH);
+        pin = glyph_clock;
+        for (size_t j = 0; j < n; ++j) {
+            batch[j] = glyph_get(tp->text[i + j], tp->fg, tp->bg, pin);
+            if (batch[j] == NULL) {
+                n = j;
+                break;
+            }
+        }
+
+        row = &ctx->io[x + tp->y * stride];
+        for (dimm_t y = 0; y < h; ++y) {
+            p = row;
+            for (size_t j = 0; j < n; ++j) {
+                if (i + j == len - 1) {
+                    memcpy(p, batch[j]->px[y], tail * sizeof(pixel_t));
+                    break;
+                }
+                memcpy(p, batch[j]->px[y], sizeof(batch[j]->px[y]));
+                p += GFX_FONT_WIDTH;
+            }
+            row += stride;
+        }
+
+        x += n * GFX_FONT_WIDTH;
+    }
+
+    w = MIN(w, len * GFX_FONT_WIDTH);
+    gfx_mark_dirty(ctx, tp->x, tp->y, w, h);
+    return 0;
+}
@@ -35,3 +35,9 @@ intr_register(const char *name, const struct intr_hand *ih)
     /* TODO: Stub */
     return NULL;
 }
+
+void
+intr_stat_init(void)
+{
+    /* TODO: Stub */
+}
@@ -68,3 +68,15 @@ md_td_kick(struct proc *td)
     /* TODO: STUB */
     for (;;);
 }
+
+/*
+ * Release MD resources of a dead thread.
+ *
+ * @td: Thread to release.
+ */
+void
+md_td_release(struct proc *td)
+{
+    /* TODO: STUB */
+    return;
+}
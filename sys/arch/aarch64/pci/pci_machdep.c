@@ -28,6 +28,7 @@
  */
 
 #include <sys/types.h>
+#include <sys/errno.h>
 #include <dev/pci/pci.h>
 
 /*
@@ -50,16 +51,16 @@ pci_msix_eoi(void)
     return;
 }
 
-/*
- * Enable MSI-X for a device and allocate an
- * interrupt vector.
- *
- * @dev: Device to enable MSI-X for.
- * @intr: MSI-X interrupt descriptor.
- */
 int
-pci_enable_msix(struct pci_device *dev, const struct msi_intr *intr)
+pci_msi_intr(const struct msi_intr *intr, struct msi_vec *mvp)
 {
     /* TODO: STUB */
-    return 0;
+    return -ENOTSUP;
+}
+
+int
+pci_msi_route(struct msi_vec *mvp, uint8_t vector, uint32_t cpu)
+{
+    /* TODO: STUB */
+    return -ENOTSUP;
 }
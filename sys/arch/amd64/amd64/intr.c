@@ -33,17 +33,38 @@
 #include <sys/panic.h>
 #include <sys/cdefs.h>
 #include <sys/syslog.h>
+#include <sys/spinlock.h>
+#include <sys/percpu.h>
+#include <sys/intrstat.h>
+#include <sys/trace.h>
+#include <sys/proc.h>
+#include <fs/ctlfs.h>
+#include <dev/pci/pci.h>
 #include <machine/intr.h>
 #include <machine/cpu.h>
 #include <machine/asm.h>
 #include <machine/ioapic.h>
+#include <machine/lapic.h>
+#include <machine/frame.h>
 #include <vm/dynalloc.h>
 #include <string.h>
 
 #define pr_trace(fmt, ...) kprintf("intr: " fmt, ##__VA_ARGS__)
 #define pr_error(...) pr_trace(__VA_ARGS__)
 
+/*
+ * Times each vector fired on a processor
+ */
+struct intr_cpu {
+    unsigned long nfire[256];
+};
+
+static struct ctlops intr_stat_ctl;
+static struct ctlops intr_affinity_ctl;
+
 struct intr_hand *g_intrs[256] = {0};
+static struct spinlock intr_lock = {0};
+static DEFINE_PERCPU(struct intr_cpu, intr_cpu);
 
 int
 splraise(uint8_t s)
@@ -102,6 +123,7 @@ intr_register(const char *name, const struct intr_hand *ih)
      *      vectors 0x21 to 0x21 + N_IPIVEC are reserved for
      *      inter-processor interrupts.
      */
+    spinlock_acquire(&intr_lock);
     for (int i = vec; i < vec + 16; ++i) {
         if (g_intrs[i] != NULL || i < 0x24) {
             continue;
@@ -111,6 +133,7 @@ intr_register(const char *name, const struct intr_hand *ih)
         name_len = strlen(name) + 1;
         ih_new->name = dynalloc(name_len);
         if (ih_new->name == NULL) {
+            spinlock_release(&intr_lock);
             dynfree(ih_new);
             pr_trace("could not allocate interrupt name\n");
             return NULL;
@@ -130,14 +153,202 @@ intr_register(const char *name, const struct intr_hand *ih)
         ih_new->irq = ih->irq;
         ih_new->vector = i;
         ih_new->nintr = 0;
+        ih_new->affinity = 0;
+        ih_new->msi = NULL;
         g_intrs[i] = ih_new;
 
         if (ih->irq >= 0) {
             ioapic_set_vec(ih->irq, i);
             ioapic_irq_unmask(ih->irq);
         }
+
+        spinlock_release(&intr_lock);
         return ih_new;
     }
 
+    spinlock_release(&intr_lock);
+    dynfree(ih_new);
     return NULL;
 }
+
+/*
+ * Route an interrupt to another processor, works
+ * for both I/O APIC pins and MSI/MSI-X vectors.
+ *
+ * @ih: Interrupt handler returned by intr_register()
+ * @cpu: Logical ID of the target processor
+ */
+int
+intr_set_affinity(struct intr_hand *ih, uint32_t cpu)
+{
+    struct cpu_info *ci;
+    int error = 0;
+
+    if ((ci = cpu_get(cpu)) == NULL) {
+        return -EINVAL;
+    }
+
+    spinlock_acquire(&intr_lock);
+    if (ih->irq >= 0) {
+        ioapic_set_dest(ih->irq, ci->apicid);
+    } else if (ih->msi != NULL) {
+        error = pci_msi_route(ih->msi, ih->vector, cpu);
+    } else {
+        error = -ENOTSUP;
+    }
+
+    if (error == 0) {
+        ih->affinity = cpu;
+    }
+
+    spinlock_release(&intr_lock);
+    return error;
+}
+
+/*
+ * Account for an interrupt that has been handled,
+ * called from the common interrupt path.
+ *
+ * @ih: Handler that claimed the interrupt
+ */
+void
+intr_account(struct intr_hand *ih)
+{
+    struct intr_cpu *icp;
+
+    ++ih->nintr;
+    icp = PERCPU_PTR(intr_cpu);
+    ++icp->nfire[ih->vector];
+    TRACE(TRACE_IRQ, ih->vector, ih->nintr, 0);
+}
+
+/*
+ * Dispatch a device interrupt to the handler on its
+ * vector, called from the vector stubs with the vector
+ * in `tf->trapno'.
+ *
+ * @tf: Trapframe of the interrupted context
+ */
+void
+intr_dispatch(struct trapframe *tf)
+{
+    struct intr_hand *ih;
+
+    ih = g_intrs[tf->trapno & 0xFF];
+    if (ih != NULL && ih->func(&ih->data) != 0) {
+        intr_account(ih);
+    }
+
+    lapic_eoi();
+}
+
+/*
+ * Read interrupt counts, one record for each
+ * interrupt on each processor.
+ */
+static int
+intr_stat_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct intr_stat *dest = sio->buf;
+    struct intr_hand *ih;
+    struct intr_cpu *icp;
+    struct cpu_info *ci;
+    size_t idx, max, len, rec = 0, n = 0;
+
+    idx = sio->offset / sizeof(struct intr_stat);
+    max = sio->len / sizeof(struct intr_stat);
+
+    spinlock_acquire(&intr_lock);
+    for (size_t vec = 0; vec < NELEM(g_intrs) && n < max; ++vec) {
+        if ((ih = g_intrs[vec]) == NULL) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < CPU_MAX && n < max; ++i, ++rec) {
+            if (rec < idx || (ci = cpu_get(i)) == NULL) {
+                continue;
+            }
+
+            icp = PERCPU_PTR_CPU(intr_cpu, ci);
+            len = MIN(strlen(ih->name), INTR_NAMELEN - 1);
+            memset(&dest[n], 0, sizeof(dest[n]));
+            memcpy(dest[n].name, ih->name, len);
+            dest[n].count = icp->nfire[vec];
+            dest[n].vector = vec;
+            dest[n].cpu = i;
+            dest[n].affinity = ih->affinity;
+            ++n;
+        }
+    }
+
+    spinlock_release(&intr_lock);
+    return n * sizeof(struct intr_stat);
+}
+
+/*
+ * Route an interrupt to a processor, only root may do
+ * this (the node is 0644 but ctlfs does not check modes).
+ */
+static int
+intr_affinity_write(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct intr_affinity aff;
+    struct intr_hand *ih;
+    struct proc *td;
+    int error;
+
+    td = this_td();
+    if (td != NULL && td->cred.euid != 0) {
+        return -EPERM;
+    }
+
+    if (sio->len < sizeof(aff)) {
+        return -EINVAL;
+    }
+
+    memcpy(&aff, sio->buf, sizeof(aff));
+    if (aff.vector >= NELEM(g_intrs)) {
+        return -EINVAL;
+    }
+    if ((ih = g_intrs[aff.vector]) == NULL) {
+        return -ENOENT;
+    }
+
+    if ((error = intr_set_affinity(ih, aff.cpu)) < 0) {
+        return error;
+    }
+
+    return sizeof(aff);
+}
+
+void
+intr_stat_init(void)
+{
+    char devname[] = "intr";
+    struct ctlfs_dev ctl;
+
+    /*
+     * Register '/ctl/intr/stat' for per-processor
+     * interrupt counts and '/ctl/intr/affinity' to
+     * move interrupts between processors.
+     */
+    ctl.mode = 0444;
+    ctlfs_create_node(devname, &ctl);
+    ctl.devname = devname;
+    ctl.ops = &intr_stat_ctl;
+    ctlfs_create_entry("stat", &ctl);
+
+    ctl.mode = 0644;
+    ctl.ops = &intr_affinity_ctl;
+    ctlfs_create_entry("affinity", &ctl);
+}
+
+static struct ctlops intr_stat_ctl = {
+    .read = intr_stat_read,
+    .write = NULL
+};
+
+static struct ctlops intr_affinity_ctl = {
+    .read = NULL,
+    .write = intr_affinity_write
+};
@@ -210,6 +210,24 @@ ioapic_set_vec(uint8_t irq, uint8_t vector)
     ioapic_write_redentry(&redentry, gsi);
 }
 
+/*
+ * Route an IRQ to a specific Local APIC.
+ *
+ * @irq: IRQ number to route.
+ * @apicid: Physical APIC ID of the destination.
+ */
+void
+ioapic_set_dest(uint8_t irq, uint8_t apicid)
+{
+    union ioapic_redentry redentry;
+    uint8_t gsi = irq_to_gsi(irq);
+
+    ioapic_read_redentry(&redentry, gsi);
+    redentry.destmod = 0;
+    redentry.dest_field = apicid;
+    ioapic_write_redentry(&redentry, gsi);
+}
+
 void
 ioapic_init(struct ioapic *p)
 {
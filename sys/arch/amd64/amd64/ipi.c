@@ -116,8 +116,8 @@ __ipi_handle_common(void)
     for (int i = 0; i < ipi_count; ++i) {
         ipip = &ipi_list[i];
         if (ISSET(pending, BIT(i))) {
+            __atomic_fetch_and(&ci->ipi_pending, ~BIT(i), __ATOMIC_SEQ_CST);
             ipip->handler(ipip);
-            ci->ipi_pending &= ~BIT(i);
         }
     }
 
@@ -136,32 +136,68 @@ __ipi_handle_common(void)
 int
 md_ipi_send(struct cpu_info *ci, ipi_pend_t ipi)
 {
-    uint32_t apic_id = 0;
-
-    if (ci != NULL) {
-        /*
-         * We are already dispatching IPIs, we don't
-         * want to find ourselves in interrupt hell.
-         */
-        if (ci->ipi_dispatch) {
-            return -EAGAIN;
-        }
+    if (ci == NULL) {
+        return -EINVAL;
+    }
 
-        apic_id = ci->apicid;
+    /*
+     * We are already dispatching IPIs, we don't
+     * want to find ourselves in interrupt hell.
+     */
+    if (ci->ipi_dispatch) {
+        return -EAGAIN;
     }
 
     ci->ipi_dispatch = 1;
-    ci->ipi_pending |= BIT(ipi);
+    __atomic_fetch_or(&ci->ipi_pending, BIT(ipi), __ATOMIC_SEQ_CST);
 
     /* Send it through on the bus */
-    lapic_send_ipi(
-        apic_id,
-        IPI_SHORTHAND_NONE,
-        IPI_VECTOR
-    );
+    if (ci == this_cpu()) {
+        lapic_send_ipi(0, IPI_SHORTHAND_SELF, IPI_VECTOR);
+    } else {
+        lapic_send_ipi(ci->apicid, IPI_SHORTHAND_NONE, IPI_VECTOR);
+    }
+
     return 0;
 }
 
+/*
+ * Send an IPI to every online processor other than
+ * ourselves, and to ourselves if `self' is true.
+ *
+ * XXX: The ALL/OTHERS shorthands are not used as they
+ *      would also hit processors that are not online
+ *      and skip the per-CPU dispatch state.
+ *
+ * @ipi: IPI to send
+ * @self: True to include the current processor
+ *
+ * Returns zero on success, otherwise the first error
+ * from md_ipi_send() is returned.
+ */
+int
+md_ipi_broadcast(ipi_pend_t ipi, bool self)
+{
+    struct cpu_info *ci, *cur;
+    int error, retval = 0;
+
+    cur = this_cpu();
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
+        if ((ci = cpu_get(i)) == NULL) {
+            continue;
+        }
+        if (ci == cur && !self) {
+            continue;
+        }
+
+        error = md_ipi_send(ci, ipi);
+        if (error < 0 && retval == 0) {
+            retval = error;
+        }
+    }
+
+    return retval;
+}
 
 /*
  * IPI allocation interface with
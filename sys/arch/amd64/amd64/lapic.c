@@ -60,6 +60,7 @@
 
 static struct timer lapic_timer;
 static uint8_t lapic_timer_vec = 0;
+static bool x2apic_mode = false;
 void *g_lapic_base = 0;
 
 void lapic_tmr_isr(void);
@@ -96,14 +97,17 @@ lapic_has_x2apic(void)
  * register space.
  *
  * @reg: Register to read from.
+ *
+ * XXX: Every processor runs its Local APIC in the
+ *      mode picked by the BSP so this does not
+ *      need to look up the current processor.
  */
 static inline uint64_t
 lapic_readl(uint32_t reg)
 {
     void *addr;
-    const struct cpu_info *ci = this_cpu();
 
-    if (!ci->has_x2apic) {
+    if (!x2apic_mode) {
         addr = PTR_OFFSET(g_lapic_base, reg);
         return mmio_read32(addr);
     } else {
@@ -122,9 +126,8 @@ static inline void
 lapic_writel(uint32_t reg, uint64_t val)
 {
     void *addr;
-    const struct cpu_info *ci = this_cpu();
 
-    if (!ci->has_x2apic) {
+    if (!x2apic_mode) {
         addr = PTR_OFFSET(g_lapic_base, reg);
         mmio_write32(addr, val);
     } else {
@@ -231,7 +234,7 @@ static inline uint32_t
 lapic_read_id(const struct cpu_info *ci)
 {
     if (!ci->has_x2apic) {
-        return (lapic_readl(LAPIC_ID) >> 24) & 0xF;
+        return (lapic_readl(LAPIC_ID) >> 24) & 0xFF;
     } else {
         return lapic_readl(LAPIC_ID);
     }
@@ -268,18 +271,25 @@ lapic_timer_init(void)
     return freq;
 }
 
+/*
+ * Send an IPI to one processor or, with a
+ * shorthand, to a group of them at once.
+ *
+ * @id: APIC ID of the target (ignored with a shorthand)
+ * @shorthand: Destination shorthand (see IPI_SHORTHAND_*)
+ * @vector: Vector to raise on the target(s)
+ */
 void
-lapic_send_ipi(uint8_t id, uint8_t shorthand, uint8_t vector)
+lapic_send_ipi(uint32_t id, uint8_t shorthand, uint8_t vector)
 {
     const uint32_t X2APIC_IPI_SELF = 0x3F0;
-    struct cpu_info *ci = this_cpu();
     uint64_t icr_lo = 0;
 
     /*
      * If we are in x2APIC mode and the shorthand is "self", use
      * the x2APIC SELF IPI register as it is more optimized.
      */
-    if (shorthand == IPI_SHORTHAND_SELF && ci->has_x2apic) {
+    if (shorthand == IPI_SHORTHAND_SELF && x2apic_mode) {
         lapic_writel(X2APIC_IPI_SELF, vector);
         return;
     }
@@ -297,10 +307,10 @@ lapic_send_ipi(uint8_t id, uint8_t shorthand, uint8_t vector)
      * write, unlike with xAPICs where you'd need to write to the
      * ICR high dword first.
      */
-    if (ci->has_x2apic) {
+    if (x2apic_mode) {
         lapic_writel(LAPIC_ICRLO, ((uint64_t)id << 32) | icr_lo);
     } else {
-        lapic_writel(LAPIC_ICRHI, ((uint32_t)id << 24));
+        lapic_writel(LAPIC_ICRHI, ((id & 0xFF) << 24));
         lapic_writel(LAPIC_ICRLO, icr_lo);
         while (ISSET(lapic_readl(LAPIC_ICRLO), BIT(12)));
     }
@@ -350,14 +360,34 @@ lapic_init(void)
         panic("invalid LAPIC base\n");
     }
 
-    ci->has_x2apic = lapic_has_x2apic();
+    /*
+     * The BSP picks x2APIC mode if it is supported, which
+     * gives MSR access, 32-bit APIC IDs and single write
+     * IPIs. Every AP then follows so the mode can be kept
+     * in one place.
+     */
+    if (ci == &g_bsp_ci) {
+        x2apic_mode = lapic_has_x2apic();
+    }
+
+    ci->has_x2apic = x2apic_mode;
     lapic_enable(ci);
 
     ci->apicid = lapic_read_id(ci);
-    ci->lapic_tmr_freq = lapic_timer_init();
+
+    /*
+     * Calibration is serialized on the i8254, so APs
+     * reuse the frequency measured by the BSP rather
+     * than queueing up behind each other.
+     */
+    if (ci != &g_bsp_ci && g_bsp_ci.lapic_tmr_freq != 0) {
+        ci->lapic_tmr_freq = g_bsp_ci.lapic_tmr_freq;
+    } else {
+        ci->lapic_tmr_freq = lapic_timer_init();
+    }
     modestr = ci->has_x2apic ? "x2apic" : "xapic";
 
-    bsp_trace("lapic0 at cpu0: apicid %d\n");
+    bsp_trace("lapic0 at cpu0: apicid %d\n", ci->apicid);
     bsp_trace("lapic0 in %s mode\n", modestr);
 
     /* Try to register the timer */
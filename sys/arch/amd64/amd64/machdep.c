@@ -28,9 +28,11 @@
  */
 
 #include <sys/types.h>
+#include <sys/errno.h>
 #include <sys/syslog.h>
 #include <sys/ksyms.h>
 #include <sys/panic.h>
+#include <sys/percpu.h>
 #include <machine/cpu.h>
 #include <machine/gdt.h>
 #include <machine/tss.h>
@@ -55,6 +57,12 @@
  */
 #define MAX_FRAME_DEPTH 16
 
+/*
+ * Page attribute table, entry 0 first:
+ * WB, WT, UC-, UC, WP, WC, UC-, UC
+ */
+#define PAT_VALUE 0x0007010500070406ULL
+
 #define pr_trace(fmt, ...) kprintf("cpu: " fmt, ##__VA_ARGS__)
 #define pr_error(...) pr_trace(__VA_ARGS__)
 #define pr_trace_bsp(...)       \
@@ -86,8 +94,10 @@ void syscall_isr(void);
 void pin_isr_load(void);
 
 struct cpu_info g_bsp_ci = {0};
+volatile bool g_gsbase_ready = false;
 static struct cpu_ipi *tlb_ipi;
 static struct spinlock ipi_lock = {0};
+static struct spinlock tss_lock = {0};
 static bool bsp_init = false;
 
 static int
@@ -121,7 +131,10 @@ setup_vectors(struct cpu_info *ci)
     union tss_stack scstack;
     union tss_stack dfstack;
 
-    /* Try to allocate a syscall stack */
+    /*
+     * Try to allocate a syscall stack, threads switch
+     * to their own one once they are scheduled.
+     */
     if (tss_alloc_stack(&scstack, DEFAULT_PAGESIZE) != 0) {
         panic("failed to allocate syscall stack\n");
     }
@@ -155,9 +168,15 @@ init_tss(struct cpu_info *ci)
 {
     struct tss_desc *desc;
 
+    /*
+     * All processors share the TSS descriptor in the
+     * GDT, so only one may write and load it at a time.
+     */
+    spinlock_acquire(&tss_lock);
     desc = (struct tss_desc *)&g_gdt_data[GDT_TSS_INDEX];
     write_tss(ci, desc);
     tss_load();
+    spinlock_release(&tss_lock);
 }
 
 static void
@@ -170,27 +189,6 @@ try_mitigate_spectre(void)
     ibrs_enable();
 }
 
-static const char *
-backtrace_addr_to_name(uintptr_t addr, off_t *off)
-{
-    uintptr_t prev_addr = 0;
-    const char *name = NULL;
-
-    for (size_t i = 0;;) {
-        if (g_ksym_table[i].addr > addr) {
-            *off = addr - prev_addr;
-            return name;
-        }
-
-        prev_addr = g_ksym_table[i].addr;
-        name = g_ksym_table[i].name;
-        if (g_ksym_table[i++].addr == (uint64_t)-1)
-            break;
-    }
-
-    return NULL;
-}
-
 static void
 enable_simd(void)
 {
@@ -375,21 +373,21 @@ cpu_enable_umip(void)
 void
 cpu_shootdown_tlb(vaddr_t va)
 {
-    uint32_t ncpu = cpu_count();
     struct cpu_info *cip;
 
-    for (uint32_t i = 0; i < ncpu; ++i) {
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
         cip = cpu_get(i);
         if (cip == NULL) {
-            break;
+            continue;
         }
 
         spinlock_acquire(&cip->lock);
         cip->shootdown_va = va;
         cip->tlb_shootdown = 1;
-        md_ipi_send(cip, IPI_TLB);
         spinlock_release(&cip->lock);
     }
+
+    md_ipi_broadcast(IPI_TLB, true);
 }
 
 void
@@ -434,7 +432,7 @@ md_backtrace(void)
             break;
         }
 
-        name = backtrace_addr_to_name(rip, &off);
+        name = ksyms_lookup(rip, &off);
         snprintf(line, sizeof(line), "%p @ <%s+0x%x>\n", rip, name, off);
         cons_putstr(&g_root_scr, line, strlen(line));
         ++n;
@@ -489,7 +487,7 @@ this_cpu(void)
 {
     struct cpu_info *ci;
 
-    if (rdmsr(IA32_GS_BASE) == 0) {
+    if (__unlikely(!g_gsbase_ready)) {
         return NULL;
     }
 
@@ -507,6 +505,21 @@ this_cpu(void)
     return ci;
 }
 
+/*
+ * Called when a processor has no per-CPU data area.
+ * Only the BSP may run without one, and only until
+ * cpu_startup() has allocated it.
+ *
+ * @ci: Processor lacking an area
+ */
+void
+md_percpu_early(struct cpu_info *ci)
+{
+    if (ci != &g_bsp_ci || ci->online) {
+        panic("cpu%d: no per-CPU data area\n", ci->id);
+    }
+}
+
 /*
  * Sync all system operation
  */
@@ -560,15 +573,59 @@ cpu_disable_smep(void)
     amd64_write_cr4(cr4);
 }
 
+/*
+ * Program the page attribute table. Entries 0-3 keep
+ * their power-on types so PWT/PCD alone mean what they
+ * always did, and PAT+PWT (entry 5) selects WC.
+ *
+ * XXX: Every processor must use the same table, APs
+ *      call this from cpu_startup() and the BSP from
+ *      pmap_init() before anything is mapped WC.
+ *
+ * Returns 0 on success, or -ENOTSUP if there is no PAT.
+ */
+int
+cpu_init_pat(void)
+{
+    uint32_t unused, edx;
+
+    CPUID(0x01, unused, unused, unused, edx);
+    if (!ISSET(edx, BIT(16))) {
+        return -ENOTSUP;
+    }
+
+    /* Nothing may be cached under the old types */
+    __ASMV("wbinvd" ::: "memory");
+    wrmsr(IA32_PAT, PAT_VALUE);
+    __ASMV("wbinvd" ::: "memory");
+    amd64_write_cr3(amd64_read_cr3());
+    return 0;
+}
+
+/*
+ * Bring up the current processor.
+ *
+ * XXX: APs must call this before anything else and
+ *      must have their per-CPU data area allocated
+ *      by the BSP beforehand. %gs is set up first
+ *      thing, as `g_gsbase_ready' is shared by all
+ *      processors.
+ */
 void
 cpu_startup(struct cpu_info *ci)
 {
     ci->self = ci;
+    wrmsr(IA32_GS_BASE, (uintptr_t)ci);
+    g_gsbase_ready = true;
+
+    /* APs get theirs from the BSP */
+    if (ci == &g_bsp_ci && ci->percpu == NULL) {
+        ci->percpu = percpu_alloc();
+    }
+
     ci->feat = 0;
     gdt_load();
     idt_load();
-
-    wrmsr(IA32_GS_BASE, (uintptr_t)ci);
     init_tss(ci);
 
     setup_vectors(ci);
@@ -576,8 +633,12 @@ cpu_startup(struct cpu_info *ci)
     init_ipis();
 
     try_mitigate_spectre();
+    if (ci != &g_bsp_ci) {
+        cpu_init_pat();
+    }
+
     ci->online = 1;
-    ci->preempt  = 1;
+    ci->nopreempt = 0;
 
     cpu_get_info(ci);
     cpu_enable_smep();
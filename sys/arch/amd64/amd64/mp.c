@@ -36,8 +36,12 @@
 #include <sys/spinlock.h>
 #include <sys/sched.h>
 #include <sys/atomic.h>
+#include <sys/param.h>
+#include <sys/percpu.h>
 #include <machine/cpu.h>
-#include <vm/dynalloc.h>
+#include <machine/cdefs.h>
+#include <vm/physmem.h>
+#include <vm/vm.h>
 #include <assert.h>
 #include <string.h>
 
@@ -51,28 +55,46 @@ static volatile struct limine_smp_request g_smp_req = {
 
 static volatile uint32_t ncpu_up = 1;
 static struct cpu_info *ci_list[CPU_MAX];
-static struct spinlock ci_list_lock = {0};
 
-static void
-ap_trampoline(struct limine_smp_info *si)
+/*
+ * Allocate a descriptor for an AP along with its
+ * per-CPU data area. The descriptor is page aligned
+ * so it never shares a cache line with another.
+ *
+ * @id: Logical ID to give the processor
+ */
+static struct cpu_info *
+ap_alloc(uint32_t id)
 {
     struct cpu_info *ci;
-    struct proc *idle;
+    size_t npages;
+    uintptr_t pa;
 
-    ci = dynalloc(sizeof(*ci));
-    __assert(ci != NULL);
-    memset(ci, 0, sizeof(*ci));
+    npages = ALIGN_UP(sizeof(*ci), DEFAULT_PAGESIZE) / DEFAULT_PAGESIZE;
+    pa = vm_alloc_frame(npages);
+    __assert(pa != 0);
 
-    cpu_startup(ci);
-    spinlock_acquire(&ci_list_lock);
-    ci_list[ncpu_up] = ci;
+    ci = PHYS_TO_VIRT(pa);
+    memset(ci, 0, sizeof(*ci));
+    ci->id = id;
+    ci->percpu = percpu_alloc();
+    return ci;
+}
 
-    ci->id = ncpu_up;
-    spawn(&g_proc0, sched_enter, NULL, 0, &idle);
-    proc_pin(idle, ci->id);
+/*
+ * Entry point of each AP. The BSP already set up
+ * everything that is shared, so every AP can come
+ * up at the same time without taking a lock.
+ */
+static void
+ap_trampoline(struct limine_smp_info *si)
+{
+    struct cpu_info *ci;
 
-    spinlock_release(&ci_list_lock);
+    ci = (struct cpu_info *)si->extra_argument;
+    cpu_startup(ci);
 
+    ci_list[ci->id] = ci;
     atomic_inc_int(&ncpu_up);
     sched_enter();
     while (1);
@@ -81,7 +103,7 @@ ap_trampoline(struct limine_smp_info *si)
 struct cpu_info *
 cpu_get(uint32_t index)
 {
-    if (index >= ncpu_up) {
+    if (index >= CPU_MAX) {
         return NULL;
     }
 
@@ -117,38 +139,69 @@ mp_bootstrap_aps(struct cpu_info *ci)
 {
     struct limine_smp_response *resp = g_smp_req.response;
     struct limine_smp_info **cpus;
+    struct cpu_info *ap;
     struct proc *idle;
-    size_t cpu_init_counter;
-    uint32_t ncpu;
+    uint32_t ncpu, nap = 0;
 
     /* Should not happen */
     __assert(resp != NULL);
 
     cpus = resp->cpus;
     ncpu = resp->cpu_count;
-    cpu_init_counter = ncpu - 1;
     ci_list[0] = ci;
 
+    /*
+     * Keep interrupts off while idle threads are being
+     * created so none can run here before it is pinned.
+     */
+    md_intoff();
+
     /* Pin an idle thread to the BSP */
     spawn(&g_proc0, sched_enter, NULL, 0, &idle);
     proc_pin(idle, 0);
 
     if (resp->cpu_count == 1) {
+        md_inton();
         pr_trace("CPU has 1 core, no APs to bootstrap...\n");
         return;
     }
 
-    pr_trace("bootstrapping %d cores...\n", cpu_init_counter);
-    for (size_t i = 0; i < resp->cpu_count; ++i) {
+    /*
+     * Give each AP its descriptor and idle thread up
+     * front, this way nothing on the AP side needs to
+     * be serialized.
+     */
+    for (size_t i = 0; i < ncpu; ++i) {
+        cpus[i]->extra_argument = 0;
         if (ci->apicid == cpus[i]->lapic_id) {
             pr_trace("skip %d (BSP)... continue\n", ci->apicid);
             continue;
         }
+        if ((nap + 1) >= CPU_MAX) {
+            pr_trace("CPU_MAX reached, skipping %d\n", cpus[i]->lapic_id);
+            continue;
+        }
 
-        cpus[i]->goto_address = ap_trampoline;
+        ap = ap_alloc(++nap);
+        spawn(&g_proc0, sched_enter, NULL, 0, &idle);
+        proc_pin(idle, ap->id);
+        cpus[i]->extra_argument = (uintptr_t)ap;
+    }
+
+    md_inton();
+
+    /* Release them all at once */
+    pr_trace("bootstrapping %d cores...\n", nap);
+    for (size_t i = 0; i < ncpu; ++i) {
+        if (cpus[i]->extra_argument != 0) {
+            cpus[i]->goto_address = ap_trampoline;
+        }
     }
 
     /* Wait for all cores to be ready */
-    while ((ncpu_up - 1) < cpu_init_counter);
+    while ((ncpu_up - 1) < nap) {
+        md_pause();
+    }
+
     cpu_report_count(ncpu_up);
 }
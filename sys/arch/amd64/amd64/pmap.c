@@ -55,9 +55,13 @@
 #define PTE_ACC         BIT(5)        /* Accessed */
 #define PTE_DIRTY       BIT(6)        /* Dirty (written-to page) */
 #define PTE_PS          BIT(7)        /* Page size */
+#define PTE_PAT         BIT(7)        /* PAT index bit 2 (4K pages only) */
 #define PTE_GLOBAL      BIT(8)
 #define PTE_NX          BIT(63)       /* Execute-disable */
 
+/* PAT usable, see cpu_init_pat() */
+static bool pat_enabled = false;
+
 /*
  * Convert pmap protection flags to PTE flags.
  */
@@ -292,11 +296,13 @@ int
 pmap_set_cache(struct vas vas, vaddr_t va, int type)
 {
     uintptr_t *tbl;
-    uint32_t flags;
+    uint64_t flags;
     paddr_t pa;
     int status;
     size_t idx;
 
+    if (type == VM_CACHE_WC && !pat_enabled)
+        return -ENOTSUP;
     if ((status = pmap_get_tbl(vas, va, false, &tbl)) != 0)
         return status;
 
@@ -305,15 +311,17 @@ pmap_set_cache(struct vas vas, vaddr_t va, int type)
     flags = tbl[idx] & ~PTE_ADDR_MASK;
 
     /* Set the caching policy */
+    flags &= ~(PTE_PAT | PTE_PCD | PTE_PWT);
     switch (type) {
     case VM_CACHE_UC:
         flags |= PTE_PCD;
-        flags &= ~PTE_PWT;
         break;
     case VM_CACHE_WT:
-        flags &= ~PTE_PCD;
         flags |= PTE_PWT;
         break;
+    case VM_CACHE_WC:
+        flags |= PTE_PAT | PTE_PWT;
+        break;
     default:
         return -EINVAL;
     }
@@ -335,6 +343,19 @@ pmap_is_clean(struct vas vas, vaddr_t va)
     return ISSET(tbl[idx], PTE_DIRTY) == 0;
 }
 
+bool
+pmap_is_mapped(struct vas vas, vaddr_t va)
+{
+    uintptr_t *tbl;
+    size_t idx;
+
+    if (pmap_get_tbl(vas, va, false, &tbl) != 0)
+        return false;
+
+    idx = pmap_get_level_index(1, va);
+    return ISSET(tbl[idx], PTE_P) != 0;
+}
+
 void
 pmap_mark_clean(struct vas vas, vaddr_t va)
 {
@@ -358,5 +379,6 @@ pmap_mark_clean(struct vas vas, vaddr_t va)
 int
 pmap_init(void)
 {
+    pat_enabled = cpu_init_pat() == 0;
     return 0;
 }
@@ -34,37 +34,70 @@
 #include <sys/exec.h>
 #include <sys/sched.h>
 #include <sys/schedvar.h>
+#include <sys/trace.h>
+#include <sys/prof.h>
 #include <machine/frame.h>
 #include <machine/gdt.h>
 #include <machine/cpu.h>
+#include <machine/tss.h>
+#include <machine/intr.h>
 #include <vm/physmem.h>
 #include <vm/vm.h>
 #include <vm/map.h>
 #include <string.h>
 
+/*
+ * Point the syscall IST of the current processor at
+ * the system call stack of `td', a thread that sleeps
+ * in a system call keeps its frames there while it is
+ * switched out.
+ */
+static inline void
+td_load_kstack(struct cpu_info *ci, struct proc *td)
+{
+    union tss_stack stack;
+    struct pcb *pcbp = &td->pcb;
+
+    if (pcbp->kstack == 0) {
+        return;
+    }
+
+    stack.top = pcbp->kstack + PCB_KSTACK_SIZE;
+    tss_update_ist(ci, stack, IST_SYSCALL);
+}
+
+/*
+ * Copy a string onto the new stack.
+ *
+ * Returns a pointer just past the copied NUL.
+ */
+static inline char *
+stack_strcpy(char *dest, const char *src)
+{
+    while ((*dest++ = *src++) != '\0');
+    return dest;
+}
+
 uintptr_t
 md_td_stackinit(struct proc *td, void *stack_top, struct exec_prog *prog)
 {
     uintptr_t *sp = stack_top;
-    uintptr_t old_sp;
-    size_t argc, envc, len;
+    uintptr_t *argv_sp, *envp_sp;
+    size_t argc, envc, strsz = 0;
     char **argvp = prog->argp;
     char **envp = prog->envp;
+    char *str;
     struct auxval auxval = prog->auxval;
     struct trapframe *tfp;
 
-    /* Copy strings */
-    old_sp = (uintptr_t)sp;
-    for (argc = 0; argvp[argc] != NULL; ++argc) {
-        len = strlen(argvp[argc]) + 1;
-        sp = (void *)((char *)sp - len);
-        memcpy((char *)sp, argvp[argc], len);
-    }
-    for (envc = 0; envp[envc] != NULL; ++envc) {
-        len = strlen(envp[envc]) + 1;
-        sp = (void *)((char *)sp - len);
-        memcpy((char *)sp, envp[envc], len);
-    }
+    /* Size the string area */
+    for (argc = 0; argvp[argc] != NULL; ++argc)
+        strsz += strlen(argvp[argc]) + 1;
+    for (envc = 0; envp[envc] != NULL; ++envc)
+        strsz += strlen(envp[envc]) + 1;
+
+    str = (char *)sp - strsz;
+    sp = (void *)str;
 
     /* Ensure the stack is aligned */
     sp = (void *)ALIGN_DOWN((uintptr_t)sp, 16);
@@ -79,24 +112,27 @@ md_td_stackinit(struct proc *td, void *stack_top, struct exec_prog *prog)
     AUXVAL(sp, AT_PAGESIZE, DEFAULT_PAGESIZE);
     STACK_PUSH(sp, 0);
 
-    /* Copy envp pointers */
+    /* Reserve the envp and argv pointer arrays */
     sp -= envc;
-    for (int i = 0; i < envc; ++i) {
-        len = strlen(envp[i]) + 1;
-        old_sp -= len;
-        sp[i] = (uintptr_t)old_sp - VM_HIGHER_HALF;
-    }
-
-    /* Copy argvp pointers */
+    envp_sp = sp;
     STACK_PUSH(sp, 0);
     sp -= argc;
-    for (int i = 0; i < argc; ++i) {
-        len = strlen(argvp[i]) + 1;
-        old_sp -= len;
-        sp[i] = (uintptr_t)old_sp - VM_HIGHER_HALF;
+    argv_sp = sp;
+    STACK_PUSH(sp, argc);
+
+    /*
+     * Copy the strings and fill in the pointers to
+     * them in the same pass.
+     */
+    for (size_t i = 0; i < argc; ++i) {
+        argv_sp[i] = (uintptr_t)str - VM_HIGHER_HALF;
+        str = stack_strcpy(str, argvp[i]);
+    }
+    for (size_t i = 0; i < envc; ++i) {
+        envp_sp[i] = (uintptr_t)str - VM_HIGHER_HALF;
+        str = stack_strcpy(str, envp[i]);
     }
 
-    STACK_PUSH(sp, argc);
     tfp = &td->tf;
     tfp->rsp = (uintptr_t)sp - VM_HIGHER_HALF;
     return tfp->rsp;
@@ -132,6 +168,7 @@ md_td_kick(struct proc *td)
     ci = this_cpu();
     ci->curtd = td;
     td->flags &= ~PROC_KTD;
+    td_load_kstack(ci, td);
 
     __ASMV(
         "mov %0, %%rax\n"
@@ -167,7 +204,7 @@ md_td_kick(struct proc *td)
 int
 md_spawn(struct proc *p, struct proc *parent, uintptr_t ip)
 {
-    uintptr_t stack_base;
+    uintptr_t stack_base, kstack;
     struct trapframe *tfp;
     struct pcb *pcbp;
     uint8_t rpl = 0;
@@ -200,10 +237,19 @@ md_spawn(struct proc *p, struct proc *parent, uintptr_t ip)
     tfp->ss = (rpl == 3) ? (USER_DS | 3) : KERNEL_DS;
     tfp->rflags = 0x202;
 
+    /* Each thread makes its system calls on its own stack */
+    kstack = vm_alloc_frame(PCB_KSTACK_PAGES);
+    if (kstack == 0)
+        return -ENOMEM;
+
     /* Try to allocate a new stack */
     stack_base = vm_alloc_frame(PROC_STACK_PAGES);
-    if (stack_base == 0)
+    if (stack_base == 0) {
+        vm_free_frame(kstack, PCB_KSTACK_PAGES);
         return -ENOMEM;
+    }
+
+    pcbp->kstack = kstack + VM_HIGHER_HALF;
 
     /*
      * If RPL is 0 (kernel), adjust the stack base to the
@@ -223,6 +269,24 @@ md_spawn(struct proc *p, struct proc *parent, uintptr_t ip)
     return 0;
 }
 
+/*
+ * Release MD resources of a dead thread.
+ *
+ * @td: Thread to release, must not be running.
+ */
+void
+md_td_release(struct proc *td)
+{
+    struct pcb *pcbp = &td->pcb;
+
+    if (pcbp->kstack == 0) {
+        return;
+    }
+
+    vm_free_frame(pcbp->kstack - VM_HIGHER_HALF, PCB_KSTACK_PAGES);
+    pcbp->kstack = 0;
+}
+
 /*
  * Save thread state and enqueue it back into one
  * of the ready queues.
@@ -257,9 +321,11 @@ sched_switch_to(struct trapframe *tf, struct proc *td)
     /* Update stats */
     cpustat = &ci->stat;
     atomic_inc_64(&cpustat->nswitch);
+    TRACE(TRACE_SCHED_SWITCH, td->pid, td->priority, 0);
 
     ci->curtd = td;
     pcbp = &td->pcb;
+    td_load_kstack(ci, td);
     pmap_switch_vas(pcbp->addrsp);
 }
 
@@ -267,6 +333,10 @@ sched_switch_to(struct trapframe *tf, struct proc *td)
  * Enable or disable preemption on the current
  * processor
  *
+ * Disabling nests (e.g., spinlocks held within each
+ * other) and every sched_preempt_set(false) must be
+ * paired with a sched_preempt_set(true).
+ *
  * @enable: Enable preemption if true
  */
 void
@@ -278,7 +348,11 @@ sched_preempt_set(bool enable)
         return;
     }
 
-    ci->preempt = enable;
+    if (!enable) {
+        ++ci->nopreempt;
+    } else if (ci->nopreempt > 0) {
+        --ci->nopreempt;
+    }
 }
 
 bool
@@ -290,7 +364,7 @@ sched_preemptable(void)
         return false;
     }
 
-    return ci->preempt;
+    return ci->nopreempt == 0;
 }
 
 /*
@@ -303,7 +377,14 @@ md_sched_switch(struct trapframe *tf)
     struct cpu_info *ci;
 
     ci = this_cpu();
-    if (!ci->preempt) {
+
+    /* Sampling-only tick, keep running */
+    if (prof_intr(tf)) {
+        sched_oneshot(false);
+        return;
+    }
+
+    if (ci->nopreempt != 0) {
         sched_oneshot(false);
         return;
     }
@@ -318,7 +399,14 @@ md_sched_switch(struct trapframe *tf)
         sched_save_td(td, tf);
     }
 
+    /*
+     * Nothing else to run, keep going with `td' but
+     * take it back off of the queue it was saved to.
+     */
     if ((next_td = sched_dequeue_td()) == NULL) {
+        if (td != NULL) {
+            sched_detach(td);
+        }
         sched_oneshot(false);
         return;
     }
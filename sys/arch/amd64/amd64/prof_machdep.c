@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/proc.h>
+#include <sys/prof.h>
+#include <machine/frame.h>
+#include <vm/vm.h>
+#include <vm/pmap.h>
+#include <string.h>
+
+extern char __kernel_text_start[];
+extern char __kernel_text_end[];
+
+/*
+ * Returns true if `pc' is within the kernel's
+ * text section.
+ */
+static inline bool
+is_ktext(uintptr_t pc)
+{
+    return pc >= (uintptr_t)__kernel_text_start &&
+        pc < (uintptr_t)__kernel_text_end;
+}
+
+/*
+ * Get the bounds of the kernel stack that `td' was
+ * interrupted on. Kernel threads run on their own
+ * stack, system calls run on the syscall stack of
+ * the thread.
+ *
+ * @td: Interrupted thread
+ * @tf: Trapframe of the interrupted context
+ * @lo: Lowest usable stack address is written here
+ * @hi: Top of the stack is written here
+ *
+ * Returns false if `tf' is not on that stack.
+ */
+static bool
+kstack_bounds(struct proc *td, struct trapframe *tf, uintptr_t *lo,
+    uintptr_t *hi)
+{
+    if (ISSET(td->flags, PROC_KTD)) {
+        *lo = td->stack_base;
+        *hi = td->stack_base + PROC_STACK_SIZE;
+    } else {
+        *lo = td->pcb.kstack;
+        *hi = td->pcb.kstack + PCB_KSTACK_SIZE;
+    }
+
+    /* Nothing below the interrupted stack pointer is live */
+    if (tf->rsp < *lo || tf->rsp >= *hi) {
+        return false;
+    }
+
+    *lo = tf->rsp;
+    return true;
+}
+
+/*
+ * Fill in a profiler sample from an interrupted
+ * context by walking its frame pointer chain.
+ *
+ * @tf: Trapframe of the interrupted context
+ * @sp: Sample to fill in
+ *
+ * XXX: There is no fault recovery in the timer
+ *      interrupt. Kernel frames must lie within the
+ *      interrupted stack and user frames must be on
+ *      present pages, otherwise the walk ends.
+ */
+int
+md_prof_capture(struct trapframe *tf, struct prof_sample *sp)
+{
+    struct proc *td = this_td();
+    uintptr_t frame[2];
+    uintptr_t rbp, lo, hi;
+    struct vas vas;
+    bool user;
+
+    user = ISSET(tf->cs, 3) && td != NULL;
+    sp->pid = (td != NULL) ? td->pid : 0;
+    sp->flags = user ? PROF_USER : 0;
+    sp->pc[0] = tf->rip;
+    sp->depth = 1;
+    rbp = tf->rbp;
+
+    if (user) {
+        vas = pmap_read_vas();
+    } else if (td == NULL || !kstack_bounds(td, tf, &lo, &hi)) {
+        return 0;
+    }
+
+    while (sp->depth < PROF_MAXDEPTH) {
+        if (rbp == 0 || !PTR_ALIGNED(rbp, 8)) {
+            break;
+        }
+
+        /* Frames must not cross privilege levels */
+        if (user) {
+            if (rbp >= VM_HIGHER_HALF - sizeof(frame))
+                break;
+            if (!pmap_is_mapped(vas, rbp))
+                break;
+            if (!pmap_is_mapped(vas, rbp + sizeof(frame) - 1))
+                break;
+            memcpy(frame, (void *)rbp, sizeof(frame));
+        } else {
+            if (rbp < lo || rbp > hi - sizeof(frame))
+                break;
+            memcpy(frame, (void *)rbp, sizeof(frame));
+            if (!is_ktext(frame[1]))
+                break;
+        }
+
+        if (frame[1] == 0) {
+            break;
+        }
+
+        sp->pc[sp->depth++] = frame[1];
+
+        /* The chain must move up the stack */
+        if (frame[0] <= rbp) {
+            break;
+        }
+        rbp = frame[0];
+    }
+
+    return 0;
+}
@@ -35,7 +35,10 @@
 #include <sys/syscall.h>
 #include <sys/sched.h>
 #include <sys/proc.h>
+#include <sys/trace.h>
+#include <sys/ktrace.h>
 #include <machine/cpu.h>
+#include <machine/tsc.h>
 #include <machine/isa/i8042var.h>
 #include <machine/trap.h>
 #include <machine/frame.h>
@@ -174,8 +177,29 @@ trap_syscall(struct trapframe *tf)
         .tf = tf
     };
 
-    if (tf->rax < MAX_SYSCALLS && tf->rax > 0) {
-        tf->rax = g_sctab[tf->rax](&scargs);
+    uint64_t scnum = tf->rax;
+    uint64_t start, cycles;
+    struct proc *td;
+
+    if (scnum < MAX_SYSCALLS && scnum > 0) {
+        TRACE(TRACE_SYSCALL_ENTER, scnum, scargs.arg0, scargs.arg1);
+        td = this_td();
+        if (__unlikely(ISSET(td->flags, PROC_KTRACE))) {
+            ktrace_call(scnum, &scargs);
+        }
+
+        start = rdtsc();
+        tf->rax = g_sctab[scnum](&scargs);
+        cycles = rdtsc() - start;
+
+        syscall_account(scnum, cycles);
+        if (__unlikely(ISSET(td->flags, PROC_KTRACE))) {
+            ktrace_ret(scnum, tf->rax, cycles);
+        }
+        TRACE(TRACE_SYSCALL_EXIT, scnum, tf->rax, 0);
+
+        /* Deliver signals sent while we were away */
+        dispatch_signals(td);
     }
 }
 
@@ -186,6 +210,10 @@ trap_handler(struct trapframe *tf)
         panic("got unknown trap %d\n", tf->trapno);
     }
 
+    if (tf->trapno == TRAP_PAGEFLT) {
+        TRACE(TRACE_PAGEFAULT, pf_faultaddr(), tf->rip, tf->error_code);
+    }
+
     pr_error("got %s\n", trap_type[tf->trapno]);
 
     /* Handle traps from userland */
@@ -31,6 +31,8 @@
 #include <sys/param.h>
 #include <sys/errno.h>
 #include <sys/mmio.h>
+#include <sys/spinlock.h>
+#include <sys/atomic.h>
 #include <dev/pci/pci.h>
 #include <dev/pci/pciregs.h>
 #include <machine/pci/pci.h>
@@ -44,6 +46,13 @@
 /* Base address masks for BARs */
 #define PCI_BAR_MEMMASK ~7
 
+/*
+ * The address and data ports are a pair, keep
+ * drivers probing on other processors from
+ * interleaving accesses.
+ */
+static struct spinlock cam_lock = {0};
+
 static inline uint32_t
 pci_conf_addr(struct pci_device *dev, uint32_t offset)
 {
@@ -77,11 +86,14 @@ pci_get_barreg(struct pci_device *dev, uint8_t bar)
 __weak pcireg_t
 md_pci_readl(struct pci_device *dev, uint32_t offset)
 {
-    uint32_t address;
+    uint32_t address, val;
 
     address = pci_conf_addr(dev, offset);
+    spinlock_acquire(&cam_lock);
     outl(0xCF8, address);
-    return inl(0xCFC) >> ((offset & 3) * 8);
+    val = inl(0xCFC);
+    spinlock_release(&cam_lock);
+    return val >> ((offset & 3) * 8);
 }
 
 __weak void
@@ -90,8 +102,10 @@ md_pci_writel(struct pci_device *dev, uint32_t offset, pcireg_t val)
     uint32_t address;
 
     address = pci_conf_addr(dev, offset);
+    spinlock_acquire(&cam_lock);
     outl(0xCF8, address);
     outl(0xCFC, val);
+    spinlock_release(&cam_lock);
 }
 
 /*
@@ -153,68 +167,68 @@ pci_msix_eoi(void)
 }
 
 /*
- * Enable MSI-X for a device and allocate an
- * interrupt vector.
+ * Point an MSI/MSI-X vector at a processor.
  *
- * @dev: Device to enable MSI-X for.
- * @intr: MSI-X interrupt descriptor.
+ * @mvp: Vector to route.
+ * @vector: Interrupt vector it raises.
+ * @cpu: Logical ID of the target processor.
  */
 int
-pci_enable_msix(struct pci_device *dev, const struct msi_intr *intr)
+pci_msi_route(struct msi_vec *mvp, uint8_t vector, uint32_t cpu)
 {
-    volatile uint64_t *tbl;
     struct cpu_info *ci;
-    struct intr_hand ih, *ih_res;
-    uint32_t data, msg_ctl;
-    uint64_t msg_addr, tmp;
-    uint16_t tbl_off;
-    uint8_t bir;
-    uint8_t vector;
+    struct msi_msg msg;
 
-    if (dev->msix_capoff == 0)
-        return -ENOTSUP;
+    if ((ci = cpu_get(cpu)) == NULL) {
+        return -EINVAL;
+    }
 
-    /* Get the data from cap offset 0x04 */
-    data = pci_readl(dev, (dev->msix_capoff + 0x04));
-    bir = data & 3;
-    tbl_off = data & ~3;
+    /*
+     * The xAPIC message format only has 8 bits for the
+     * destination, x2APIC IDs above that can't be hit.
+     */
+    if (ci->apicid > 0xFF) {
+        return -EINVAL;
+    }
 
-    ci = this_cpu();
-    msg_addr = (0xFEE00000 | (ci->apicid << 12));
+    /* Fixed delivery, physical destination */
+    msg.addr = 0xFEE00000 | (ci->apicid << 12);
+    msg.data = vector;
+    pci_msi_write(mvp, &msg);
+    return 0;
+}
 
-    /* Calculate the start of the message table */
-    tbl = (void *)((dev->bar[bir] & PCI_BAR_MEMMASK) + MMIO_OFFSET);
-    tbl = (void *)((char *)tbl + tbl_off);
+/*
+ * Allocate an interrupt vector for an MSI/MSI-X
+ * vector of a device and route it. Vectors are
+ * spread across processors round-robin.
+ *
+ * @intr: Interrupt descriptor.
+ * @mvp: Vector to set up.
+ */
+int
+pci_msi_intr(const struct msi_intr *intr, struct msi_vec *mvp)
+{
+    static volatile uint32_t next_cpu = 0;
+    struct intr_hand ih, *ih_res;
+    uint32_t cpu;
+    int error;
 
     ih.func = intr->handler;
     ih.priority = IPL_BIO;
     ih.irq = -1;
+    ih.data.data_u64 = mvp->index;
     ih_res = intr_register(intr->name, &ih);
     if (ih_res == NULL) {
         return -EIO;
     }
-    vector = ih_res->vector;
 
-    /*
-     * Setup the message data at bits 95:64 of the message
-     * table by ORing the interrupt vector to it. We also
-     * unmask the interrupt with bit 1 of the vector control.
-     */
-    tmp = mmio_read64(&tbl[1]);
-    tmp |= vector;
-    tmp &= ~BIT(32);
-
-    /* Write the message table */
-    mmio_write64(&tbl[0], msg_addr);
-    mmio_write64(&tbl[1], tmp);
+    cpu = atomic_inc_int(&next_cpu) % cpu_count();
+    ih_res->msi = mvp;
+    if ((error = intr_set_affinity(ih_res, cpu)) < 0 && cpu != 0) {
+        /* Not addressable from a message, use the BSP */
+        error = intr_set_affinity(ih_res, 0);
+    }
 
-    /*
-     * Set bit 16 of message control to enable MSI-X.
-     * Message control lives at cap offset 0x00 in bits
-     * 31:16.
-     */
-    msg_ctl = pci_readl(dev, dev->msix_capoff);
-    msg_ctl |= BIT(31);
-    pci_writel(dev, dev->msix_capoff, msg_ctl);
-    return 0;
+    return error;
 }
@@ -27,9 +27,76 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * ChaCha20 stream cipher
+ *
+ * Besides the reference block function there are
+ * SSE2 and AVX2 versions that compute 4 and 8
+ * consecutive blocks at once, with each vector lane
+ * holding the same state word of a different block.
+ * The fastest one supported is picked on first use.
+ *
+ * This file is shared with libc. In the kernel, the
+ * caller's SIMD state is saved around the vector code
+ * and only SSE2 is used as FXSAVE does not cover the
+ * upper halves of the AVX registers.
+ */
+
+#include <sys/cdefs.h>
 #include <crypto/chacha20.h>
+#if defined(_KERNEL)
+#include <sys/errno.h>
+#include <sys/sched.h>
+#if defined(__x86_64__)
+#include <machine/asm.h>
+#endif  /* __x86_64__ */
+#else
+#include <stdlib/errno.h>
+#endif  /* _KERNEL */
+
+/*
+ * Errors are returned as negative values in the
+ * kernel, libc returns -1 and sets `errno'.
+ */
+#if defined(_KERNEL)
+#define CHACHA20_ERR(ERRNO) (-(ERRNO))
+#else
+#define CHACHA20_ERR(ERRNO) (errno = (ERRNO), -1)
+#endif  /* _KERNEL */
+
+/* Most blocks computed at once */
+#define CHACHA20_MAXWAY 8
+
+typedef uint32_t chacha_v4 __attribute__((__vector_size__(16)));
+typedef uint32_t chacha_v8 __attribute__((__vector_size__(32)));
+
+#define VROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define VQR(a,b,c,d) \
+    a += b; d ^= a; d = VROTL(d, 16); \
+    c += d; b ^= c; b = VROTL(b, 12); \
+    a += b; d ^= a; d = VROTL(d, 8);  \
+    c += d; b ^= c; b = VROTL(b, 7);
+
+#define VDOUBLEROUND(x) \
+    VQR(x[0], x[4], x[8], x[12]);   \
+    VQR(x[1], x[5], x[9], x[13]);   \
+    VQR(x[2], x[6], x[10], x[14]);  \
+    VQR(x[3], x[7], x[11], x[15]);  \
+    VQR(x[0], x[5], x[10], x[15]);  \
+    VQR(x[1], x[6], x[11], x[12]);  \
+    VQR(x[2], x[7], x[8], x[13]);   \
+    VQR(x[3], x[4], x[9], x[14]);
 
 static const char sigma[16] = "expand 32-byte k";
+static const char *impl_names[CHACHA20_NIMPL] = {
+    [CHACHA20_IMPL_SCALAR] = "scalar",
+    [CHACHA20_IMPL_SSE2] = "sse2",
+    [CHACHA20_IMPL_AVX2] = "avx2"
+};
+
+static int chacha20_impl = -1;
+static uint32_t chacha20_caps = 0;
 
 void chacha20_init(uint32_t state[16], const uint8_t key[32],
     const uint8_t nonce[12], uint32_t counter)
@@ -76,12 +143,293 @@ chacha20_block(uint32_t state[16], uint8_t out[64])
     state[12]++;
 }
 
+#if defined(__x86_64__)
+/*
+ * Write out the words of `nway' blocks that were
+ * computed one block per lane.
+ *
+ * @out: Keystream output
+ * @lane: State words, `nway' lanes per word
+ * @nway: Number of blocks
+ */
+static void
+chacha20_scatter(uint8_t *out, const uint32_t *lane, size_t nway)
+{
+    uint32_t *blk;
+
+    for (size_t b = 0; b < nway; ++b) {
+        blk = (uint32_t *)&out[b * CHACHA20_BLOCK_SIZE];
+        for (size_t i = 0; i < 16; ++i) {
+            blk[i] = lane[i * nway + b];
+        }
+    }
+}
+
+static void __target("sse2")
+chacha20_blocks_sse2(uint32_t state[16], uint8_t *out)
+{
+    chacha_v4 x[16], s[16];
+    uint32_t lane[16 * 4];
+
+    for (int i = 0; i < 16; ++i) {
+        s[i] = (chacha_v4){0} + state[i];
+    }
+
+    s[12] += (chacha_v4){0, 1, 2, 3};
+    memcpy(x, s, sizeof(x));
+
+    for (int i = 0; i < 10; ++i) {
+        VDOUBLEROUND(x);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] += s[i];
+    }
+
+    memcpy(lane, x, sizeof(lane));
+    chacha20_scatter(out, lane, 4);
+    state[12] += 4;
+}
+
+#if !defined(_KERNEL)
+static void __target("avx2")
+chacha20_blocks_avx2(uint32_t state[16], uint8_t *out)
+{
+    chacha_v8 x[16], s[16];
+    uint32_t lane[16 * 8];
+
+    for (int i = 0; i < 16; ++i) {
+        s[i] = (chacha_v8){0} + state[i];
+    }
+
+    s[12] += (chacha_v8){0, 1, 2, 3, 4, 5, 6, 7};
+    memcpy(x, s, sizeof(x));
+
+    for (int i = 0; i < 10; ++i) {
+        VDOUBLEROUND(x);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] += s[i];
+    }
+
+    memcpy(lane, x, sizeof(lane));
+    chacha20_scatter(out, lane, 8);
+    state[12] += 8;
+}
+#endif  /* !_KERNEL */
+
+static inline void
+chacha20_cpuid(uint32_t leaf, uint32_t sub, uint32_t regs[4])
+{
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "0" (leaf), "2" (sub)
+    );
+}
+#endif  /* __x86_64__ */
+
+/*
+ * Find which implementations this machine can
+ * run, the scalar one always works.
+ */
+static uint32_t
+chacha20_detect(void)
+{
+    uint32_t caps = 1 << CHACHA20_IMPL_SCALAR;
+#if defined(__x86_64__)
+    uint32_t regs[4];
+#if !defined(_KERNEL)
+    uint32_t ecx1, xcr0_lo, xcr0_hi;
+#endif  /* !_KERNEL */
+
+    chacha20_cpuid(1, 0, regs);
+
+    /* SSE2 is CPUID.(EAX=1H):EDX[26] */
+    if ((regs[3] & (1U << 26)) != 0) {
+        caps |= 1 << CHACHA20_IMPL_SSE2;
+    }
+#if defined(_KERNEL)
+    /* SSE needs to be enabled by simd_init() first */
+    if ((amd64_read_cr4() & CR4_OSFXSR) == 0) {
+        caps &= ~(1 << CHACHA20_IMPL_SSE2);
+    }
+#else
+    /*
+     * AVX2 is CPUID.(EAX=7H,ECX=0H):EBX[5] and also
+     * needs the OS to save the YMM registers, which is
+     * OSXSAVE (CPUID.1:ECX[27]) plus XCR0[2:1].
+     */
+    ecx1 = regs[2];
+    chacha20_cpuid(0, 0, regs);
+    if (regs[0] >= 7 && (ecx1 & (1U << 27)) != 0) {
+        __asm__ __volatile__(
+            "xgetbv"
+            : "=a" (xcr0_lo), "=d" (xcr0_hi)
+            : "c" (0)
+        );
+
+        chacha20_cpuid(7, 0, regs);
+        if ((regs[1] & (1U << 5)) != 0 && (xcr0_lo & 0x6) == 0x6) {
+            caps |= 1 << CHACHA20_IMPL_AVX2;
+        }
+    }
+#endif  /* _KERNEL */
+#endif  /* __x86_64__ */
+
+    return caps;
+}
+
+/*
+ * Force a specific implementation, mostly useful
+ * to compare them.
+ *
+ * @impl: Implementation to use (CHACHA20_IMPL_*)
+ *
+ * Returns zero on success, otherwise a less than
+ * zero value is returned (see CHACHA20_ERR()).
+ */
+int
+chacha20_impl_set(int impl)
+{
+    if (impl < 0 || impl >= CHACHA20_NIMPL) {
+        return CHACHA20_ERR(EINVAL);
+    }
+
+    if (chacha20_impl < 0) {
+        chacha20_impl_get();
+    }
+    if ((chacha20_caps & (1 << impl)) == 0) {
+        return CHACHA20_ERR(ENOTSUP);
+    }
+
+    chacha20_impl = impl;
+    return 0;
+}
+
+/*
+ * Returns the implementation in use, picking the
+ * fastest supported one on first use.
+ */
+int
+chacha20_impl_get(void)
+{
+    uint32_t caps;
+    int impl = CHACHA20_IMPL_SCALAR;
+
+    if (chacha20_impl >= 0) {
+        return chacha20_impl;
+    }
+
+    caps = chacha20_detect();
+    for (int i = 0; i < CHACHA20_NIMPL; ++i) {
+        if ((caps & (1 << i)) != 0) {
+            impl = i;
+        }
+    }
+
+    chacha20_caps = caps;
+    chacha20_impl = impl;
+    return impl;
+}
+
+const char *
+chacha20_impl_name(int impl)
+{
+    if (impl < 0 || impl >= CHACHA20_NIMPL) {
+        return NULL;
+    }
+
+    return impl_names[impl];
+}
+
+static void
+chacha20_xor(uint8_t *out, const uint8_t *in, const uint8_t *ks, size_t len)
+{
+    uint64_t a, b;
+    size_t i = 0;
+
+    for (; i + sizeof(a) <= len; i += sizeof(a)) {
+        memcpy(&a, &in[i], sizeof(a));
+        memcpy(&b, &ks[i], sizeof(b));
+        a ^= b;
+        memcpy(&out[i], &a, sizeof(a));
+    }
+
+    for (; i < len; ++i) {
+        out[i] = in[i] ^ ks[i];
+    }
+}
+
+/*
+ * Run whole batches of `nway' blocks through the
+ * vector code, returns the number of bytes done.
+ */
+static size_t
+chacha20_bulk(uint32_t state[16], uint8_t *in, uint8_t *out, size_t len,
+    int impl)
+{
+#if defined(__x86_64__)
+    uint8_t block[CHACHA20_BLOCK_SIZE * CHACHA20_MAXWAY];
+    size_t n, offset = 0;
+#if defined(_KERNEL)
+    uint8_t fxarea[512] __aligned(16);
+#endif  /* _KERNEL */
+
+    n = (impl == CHACHA20_IMPL_AVX2) ? 8 : 4;
+    n *= CHACHA20_BLOCK_SIZE;
+    if (len < n) {
+        return 0;
+    }
+
+#if defined(_KERNEL)
+    /* Keep the SIMD state of whoever we interrupted */
+    sched_preempt_set(false);
+    amd64_fxsave(fxarea);
+#endif  /* _KERNEL */
+
+    while (len - offset >= n) {
+        uint8_t *ks = (in == NULL) ? &out[offset] : block;
+
+#if !defined(_KERNEL)
+        if (impl == CHACHA20_IMPL_AVX2) {
+            chacha20_blocks_avx2(state, ks);
+        } else
+#endif  /* !_KERNEL */
+        chacha20_blocks_sse2(state, ks);
+
+        if (in != NULL) {
+            chacha20_xor(&out[offset], &in[offset], ks, n);
+        }
+        offset += n;
+    }
+
+#if defined(_KERNEL)
+    amd64_fxrstor(fxarea);
+    sched_preempt_set(true);
+#endif  /* _KERNEL */
+
+    memset(block, 0, sizeof(block));
+    return offset;
+#else
+    return 0;
+#endif  /* __x86_64__ */
+}
+
 void
 chacha20_encrypt(uint32_t state[16], uint8_t *in,
     uint8_t *out, size_t len)
 {
     uint8_t block[64];
     size_t offset = 0;
+    int impl;
+
+    impl = chacha20_impl_get();
+    if (impl != CHACHA20_IMPL_SCALAR) {
+        offset = chacha20_bulk(state, in, out, len, impl);
+        len -= offset;
+    }
 
     while (len > 0) {
         chacha20_block(state, block);
@@ -94,4 +442,6 @@ chacha20_encrypt(uint32_t state[16], uint8_t *in,
         offset += n;
         len -= n;
     }
+
+    memset(block, 0, sizeof(block));
 }
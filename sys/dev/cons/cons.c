@@ -277,7 +277,7 @@ cons_clear_scr(struct cons_screen *scr, uint32_t bg)
     scr->curs_col = 0;
     scr->curs_row = 0;
 
-    for (size_t i = 0; i < fbdev.height * fbdev.pitch; ++i) {
+    for (size_t i = 0; i < fbdev.height * (fbdev.pitch / 4); ++i) {
         scr->fb_mem[i] = bg;
     }
 
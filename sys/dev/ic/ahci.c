@@ -1103,4 +1103,4 @@ static struct bdevsw ahci_bdevsw = {
     .bsize = ahci_dev_bsize
 };
 
-DRIVER_EXPORT(ahci_init, "ahci");
+DRIVER_DEFER(ahci_init, "ahci");
@@ -43,11 +43,13 @@
 #include <dev/timer.h>
 #include <vm/dynalloc.h>
 #include <vm/vm.h>
+#include <machine/cdefs.h>
 #include <string.h>
 
 #define pr_trace(fmt, ...) kprintf("nvme: " fmt, ##__VA_ARGS__)
 #define pr_error(...) pr_trace(__VA_ARGS__)
 
+static struct driver_var __driver_var;
 static struct bdevsw nvme_bdevsw;
 static TAILQ_HEAD(,nvme_ns) namespaces;
 static struct pci_device *nvme_dev;
@@ -496,12 +498,20 @@ nvme_dev_rw(dev_t dev, struct sio_txn *sio, bool write)
 static int
 nvme_dev_read(dev_t dev, struct sio_txn *sio, int flags)
 {
+    while (DRIVER_DEFERRED()) {
+        md_pause();
+    }
+
     return nvme_dev_rw(dev, sio, false);
 }
 
 static int
 nvme_dev_write(dev_t dev, struct sio_txn *sio, int flags)
 {
+    while (DRIVER_DEFERRED()) {
+        md_pause();
+    }
+
     return nvme_dev_rw(dev, sio, true);
 }
 
@@ -718,4 +728,4 @@ static struct bdevsw nvme_bdevsw = {
     .write = nvme_dev_write
 };
 
-DRIVER_EXPORT(nvme_init, "nvme");
+DRIVER_DEFER(nvme_init, "nvme");
@@ -33,11 +33,13 @@
 #include <sys/errno.h>
 #include <sys/spinlock.h>
 #include <sys/mmio.h>
+#include <sys/param.h>
 #include <dev/pci/pci.h>
 #include <dev/pci/pciregs.h>
 #include <dev/acpi/acpi.h>
 #include <dev/acpi/tables.h>
 #include <machine/pci/pci.h>
+#include <machine/bus.h>
 #include <vm/dynalloc.h>
 #include <vm/vm.h>
 #include <lib/assert.h>
@@ -156,6 +158,8 @@ pci_set_device_info(struct pci_device *dev)
         dev->irq_line = pci_readl(dev, PCIREG_IRQLINE) & 0xFF;
         capoff = pci_get_cap(dev, PCI_CAP_MSIX);
         dev->msix_capoff = (capoff < 0) ? 0 : capoff;
+        capoff = pci_get_cap(dev, PCI_CAP_MSI);
+        dev->msi_capoff = (capoff < 0) ? 0 : capoff;
         break;
     case PCI_HDRTYPE_BRIDGE:
         buses = pci_readl(dev, PCIREG_BUSES);
@@ -366,6 +370,199 @@ pci_writel(struct pci_device *dev, uint32_t offset, pcireg_t val)
     cam_hook.cam_writel(dev, offset, val);
 }
 
+/*
+ * Returns the number of MSI-X table entries of
+ * a device, zero if it does not support MSI-X.
+ */
+uint16_t
+pci_msix_count(struct pci_device *dev)
+{
+    uint32_t msg_ctl;
+
+    if (dev->msix_capoff == 0) {
+        return 0;
+    }
+
+    /* Table size is N - 1 in bits 26:16 */
+    msg_ctl = pci_readl(dev, dev->msix_capoff);
+    return ((msg_ctl >> 16) & 0x7FF) + 1;
+}
+
+/*
+ * Write an MSI/MSI-X message to a device. This is
+ * used to set up a vector and whenever a vector is
+ * moved to another processor.
+ *
+ * @mvp: Vector to write the message for.
+ * @msg: Message to write.
+ */
+void
+pci_msi_write(struct msi_vec *mvp, const struct msi_msg *msg)
+{
+    struct pci_device *dev = mvp->dev;
+    volatile uint32_t *entry = mvp->entry;
+    uint32_t ctl, tmp, dataoff;
+
+    if (mvp->msix) {
+        /* Keep the entry masked while it changes */
+        ctl = mmio_read32(&entry[3]);
+        mmio_write32(&entry[3], ctl | BIT(0));
+        mmio_write32(&entry[0], msg->addr & 0xFFFFFFFF);
+        mmio_write32(&entry[1], msg->addr >> 32);
+        mmio_write32(&entry[2], msg->data);
+        mmio_write32(&entry[3], ctl & ~BIT(0));
+        return;
+    }
+
+    /*
+     * The data register follows the upper address dword
+     * if the function is 64-bit capable (bit 23 of
+     * message control), otherwise the lower one.
+     */
+    ctl = pci_readl(dev, dev->msi_capoff);
+    pci_writel(dev, dev->msi_capoff + 0x04, msg->addr & 0xFFFFFFFF);
+    if (ISSET(ctl, BIT(23))) {
+        pci_writel(dev, dev->msi_capoff + 0x08, msg->addr >> 32);
+        dataoff = dev->msi_capoff + 0x0C;
+    } else {
+        dataoff = dev->msi_capoff + 0x08;
+    }
+
+    tmp = pci_readl(dev, dataoff) & ~0xFFFF;
+    pci_writel(dev, dataoff, tmp | (msg->data & 0xFFFF));
+}
+
+/*
+ * Allocate up to `nvec' MSI-X vectors for a device
+ * and enable MSI-X. The vectors are spread across
+ * processors, vector N uses MSI-X table entry N.
+ *
+ * @dev: Device to allocate vectors for.
+ * @intr: Interrupt descriptor shared by all vectors.
+ * @nvec: Number of vectors wanted.
+ *
+ * Returns the number of vectors allocated on success,
+ * otherwise a less than zero value.
+ */
+int
+pci_alloc_msix(struct pci_device *dev, const struct msi_intr *intr, uint16_t nvec)
+{
+    volatile uint32_t *tbl;
+    struct msi_vec *mvp;
+    uintptr_t bar;
+    uint32_t data, msg_ctl;
+    uint16_t count, i;
+    uint8_t bir;
+    int error = 0;
+
+    if ((count = pci_msix_count(dev)) == 0) {
+        return -ENOTSUP;
+    }
+
+    nvec = MIN(nvec, count);
+    if (nvec == 0) {
+        return -EINVAL;
+    }
+
+    /* Table BAR in bits 2:0 and offset in bits 31:3 */
+    data = pci_readl(dev, dev->msix_capoff + 0x04);
+    bir = data & 7;
+    if (bir > 5) {
+        return -EINVAL;
+    }
+
+    bar = dev->bar[bir] & ~0xF;
+    if (PCI_BAR_64(dev->bar[bir]) && bir < 5) {
+        bar |= (uint64_t)dev->bar[bir + 1] << 32;
+    }
+    tbl = (void *)(bar + (data & ~7) + MMIO_OFFSET);
+
+    /* Enable with the function masked while we set up */
+    msg_ctl = pci_readl(dev, dev->msix_capoff);
+    msg_ctl |= (BIT(31) | BIT(30));
+    pci_writel(dev, dev->msix_capoff, msg_ctl);
+
+    for (i = 0; i < nvec; ++i) {
+        if ((mvp = dynalloc(sizeof(*mvp))) == NULL) {
+            error = -ENOMEM;
+            break;
+        }
+
+        mvp->dev = dev;
+        mvp->entry = &tbl[i * 4];
+        mvp->index = i;
+        mvp->msix = 1;
+        if ((error = pci_msi_intr(intr, mvp)) < 0) {
+            dynfree(mvp);
+            break;
+        }
+    }
+
+    /* Unmask the function if anything was set up */
+    msg_ctl &= ~BIT(30);
+    if (i == 0) {
+        msg_ctl &= ~BIT(31);
+    }
+
+    pci_writel(dev, dev->msix_capoff, msg_ctl);
+    return (i == 0) ? error : i;
+}
+
+/*
+ * Enable MSI-X for a device and allocate a
+ * single interrupt vector.
+ *
+ * @dev: Device to enable MSI-X for.
+ * @intr: MSI-X interrupt descriptor.
+ */
+int
+pci_enable_msix(struct pci_device *dev, const struct msi_intr *intr)
+{
+    int retval;
+
+    retval = pci_alloc_msix(dev, intr, 1);
+    return (retval < 0) ? retval : 0;
+}
+
+/*
+ * Allocate a single MSI vector for a device that
+ * lacks MSI-X and enable MSI.
+ *
+ * @dev: Device to allocate a vector for.
+ * @intr: MSI interrupt descriptor.
+ */
+int
+pci_alloc_msi(struct pci_device *dev, const struct msi_intr *intr)
+{
+    struct msi_vec *mvp;
+    uint32_t msg_ctl;
+    int error;
+
+    if (dev->msi_capoff == 0) {
+        return -ENOTSUP;
+    }
+
+    if ((mvp = dynalloc(sizeof(*mvp))) == NULL) {
+        return -ENOMEM;
+    }
+
+    mvp->dev = dev;
+    mvp->entry = NULL;
+    mvp->index = 0;
+    mvp->msix = 0;
+    if ((error = pci_msi_intr(intr, mvp)) < 0) {
+        dynfree(mvp);
+        return error;
+    }
+
+    /* One message (bits 22:20 clear) and enable */
+    msg_ctl = pci_readl(dev, dev->msi_capoff);
+    msg_ctl &= ~(7 << 20);
+    msg_ctl |= BIT(16);
+    pci_writel(dev, dev->msi_capoff, msg_ctl);
+    return 0;
+}
+
 int
 pci_init(void)
 {
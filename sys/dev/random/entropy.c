@@ -27,27 +27,66 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/cdefs.h>
 #include <stdint.h>
 #include <string.h>
 #include <dev/random/entropy.h>
 #include <crypto/siphash.h>
 
+/* Bytes of input hashed into the pool at once */
+#define ENTROPY_CHUNK 64
+
+/* One siphash24_x4() lane per 8 bytes of pool */
+__static_assert(ENTROPY_POOL_SIZE / 8 == 4, "pool must be 4 lanes");
+
+/*
+ * Each lane of the pool is hashed under its own key,
+ * the lane number replaces the first key byte.
+ */
+static const char lane_keys[ENTROPY_POOL_SIZE / 8][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 1, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 3, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 }
+};
+
+/*
+ * Mix input into the entropy pool.
+ *
+ * The input is hashed in fixed sized chunks along
+ * with the current pool, each 8 byte lane of the pool
+ * is folded with a hash under its own key so every
+ * byte of the pool depends on the input. The lanes
+ * are hashed together with siphash24_x4().
+ */
 void
 mix_entropy(struct entropy_pool *ep, const uint8_t *input,
     size_t input_len, uint32_t input_entropy_bits)
 {
-    char key[16] = {0,1,2,3,4,5,6,7,8,9,0xa,0xb,0xc,0xd,0xe,0xf};
-    uint64_t hash_result;
-    uint8_t buffer[ENTROPY_POOL_SIZE + input_len];
-    memcpy(buffer, ep->pool, ENTROPY_POOL_SIZE);
-    memcpy(buffer + ENTROPY_POOL_SIZE, input, input_len);
+    uint8_t buffer[ENTROPY_POOL_SIZE + ENTROPY_CHUNK];
+    uint64_t hash_result[ENTROPY_POOL_SIZE / 8];
+    size_t n, off = 0;
 
-    hash_result = siphash24(buffer, sizeof(buffer), key);
+    do {
+        n = input_len - off;
+        if (n > ENTROPY_CHUNK) {
+            n = ENTROPY_CHUNK;
+        }
 
-    for (int i = 0; i < 8; ++i) {
-        ep->pool[i] ^= (hash_result >> (i * 8)) & 0xFF;
-    }
+        memcpy(buffer, ep->pool, ENTROPY_POOL_SIZE);
+        memcpy(buffer + ENTROPY_POOL_SIZE, &input[off], n);
+
+        siphash24_x4(buffer, ENTROPY_POOL_SIZE + n, lane_keys, hash_result);
+        for (size_t lane = 0; lane < ENTROPY_POOL_SIZE / 8; ++lane) {
+            for (int i = 0; i < 8; ++i) {
+                ep->pool[lane * 8 + i] ^= hash_result[lane] >> (i * 8);
+            }
+        }
+
+        off += n;
+    } while (off < input_len);
 
+    memset(buffer, 0, sizeof(buffer));
     ep->entropy_bits += input_entropy_bits;
     if (ep->entropy_bits > ENTROPY_POOL_SIZE * 8) {
         ep->entropy_bits = ENTROPY_POOL_SIZE * 8;
@@ -27,62 +27,383 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * Kernel random number generator
+ *
+ * Entropy is gathered into a global pool and each
+ * processor runs its own ChaCha20 generator seeded
+ * from it. Generators produce output in batches and
+ * the first 32 bytes of every batch become the key
+ * for the next one (fast key erasure), so learning
+ * the state of a generator does not reveal anything
+ * it has output before. Used output is wiped.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/errno.h>
 #include <sys/sio.h>
 #include <sys/device.h>
 #include <sys/driver.h>
+#include <sys/percpu.h>
+#include <sys/random.h>
+#include <sys/sched.h>
+#include <sys/spinlock.h>
+#include <sys/systm.h>
 #include <dev/random/entropy.h>
 #include <crypto/chacha20.h>
-#include <crypto/siphash.h>
 #include <fs/devfs.h>
 #include <string.h>
+#if defined(__x86_64__)
+#include <machine/cpuid.h>
+#include <machine/tsc.h>
+#endif  /* __x86_64__ */
+
+/* Bytes generated at once, including the next key */
+#define RNG_BATCH 512
+
+/* Bytes of output before a generator is reseeded */
+#define RNG_RESEED (1 << 20)
+
+/* Tries before giving up on RDRAND/RDSEED */
+#define RNG_HWTRIES 10
+
+/*
+ * Per-CPU generator
+ *
+ * @key: Key of the next batch
+ * @buf: Output left over from the last batch
+ * @avail: Bytes left in `buf', used from the front
+ * @nout: Bytes output since the last reseed
+ * @epoch: Pool epoch at the last reseed
+ * @seeded: Set once seeded from the pool
+ */
+struct rng_cpu {
+    uint8_t key[32];
+    uint8_t buf[RNG_BATCH];
+    size_t avail;
+    size_t nout;
+    uint32_t epoch;
+    uint8_t seeded : 1;
+};
 
 static struct cdevsw random_cdevsw;
 static struct entropy_pool entropy;
-
-uint8_t key[32] = {0};
-uint8_t nonce[12] = {0};
-uint32_t state[16];
-uint32_t tsc;
+static struct spinlock entropy_lock = {0};
+static volatile uint32_t entropy_epoch = 0;
+static DEFINE_PERCPU(struct rng_cpu, rng_cpu);
+static bool have_rdrand = false;
+static bool have_rdseed = false;
 
 static inline uint64_t
-read_tsc(void)
+rng_stamp(void)
+{
+#if defined(__x86_64__)
+    return rdtsc();
+#else
+    return 0;
+#endif  /* __x86_64__ */
+}
+
+/*
+ * Read up to 32 bytes from RDSEED, or RDRAND if
+ * RDSEED is not supported.
+ *
+ * Returns the number of bytes read.
+ */
+static size_t
+rng_hwseed(uint8_t out[32])
+{
+#if defined(__x86_64__)
+    uint64_t val;
+    uint8_t ok = 0;
+    size_t n = 0;
+
+    if (!have_rdrand && !have_rdseed) {
+        return 0;
+    }
+
+    while (n < 32) {
+        for (int i = 0; i < RNG_HWTRIES; ++i) {
+            if (have_rdseed) {
+                __ASMV("rdseed %0; setc %1" : "=r" (val), "=qm" (ok));
+            } else {
+                __ASMV("rdrand %0; setc %1" : "=r" (val), "=qm" (ok));
+            }
+            if (ok) {
+                break;
+            }
+        }
+
+        if (!ok) {
+            break;
+        }
+
+        memcpy(&out[n], &val, sizeof(val));
+        n += sizeof(val);
+    }
+
+    return n;
+#else
+    return 0;
+#endif  /* __x86_64__ */
+}
+
+/*
+ * Extract a seed from the entropy pool and step the
+ * pool forward so the seed cannot be recovered from
+ * any later state of the pool.
+ *
+ * @seed: Seed is written here
+ * @epoch: Pool epoch is written here
+ */
+static void
+rng_extract(uint8_t seed[32], uint32_t *epoch)
+{
+    uint8_t nonce[12] = {0};
+    uint8_t block[64], hw[32];
+    uint32_t state[16];
+    uint64_t stamp;
+    size_t nhw;
+
+    stamp = rng_stamp();
+    nhw = rng_hwseed(hw);
+
+    spinlock_acquire(&entropy_lock);
+    mix_entropy(&entropy, (uint8_t *)&stamp, sizeof(stamp), 1);
+    if (nhw > 0) {
+        mix_entropy(&entropy, hw, nhw, nhw * 8);
+    }
+
+    chacha20_init(state, entropy.pool, nonce, 0);
+    chacha20_block(state, block);
+    memcpy(entropy.pool, block, ENTROPY_POOL_SIZE);
+    memcpy(seed, &block[32], 32);
+    *epoch = entropy_epoch;
+    spinlock_release(&entropy_lock);
+
+    memset(block, 0, sizeof(block));
+    memset(state, 0, sizeof(state));
+    memset(hw, 0, sizeof(hw));
+}
+
+/*
+ * Generate the next batch of a generator, its first
+ * 32 bytes replace the key and are wiped.
+ */
+static void
+rng_refill(struct rng_cpu *rcp)
 {
-    uint32_t lo, hi;
-    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
-    return ((uint64_t)hi << 32) | lo;
+    uint8_t nonce[12] = {0};
+    uint32_t state[16];
+
+    chacha20_init(state, rcp->key, nonce, 0);
+    chacha20_encrypt(state, NULL, rcp->buf, sizeof(rcp->buf));
+    memcpy(rcp->key, rcp->buf, sizeof(rcp->key));
+    memset(rcp->buf, 0, sizeof(rcp->key));
+
+    rcp->avail = sizeof(rcp->buf) - sizeof(rcp->key);
+    memset(state, 0, sizeof(state));
+}
+
+static inline bool
+rng_need_reseed(const struct rng_cpu *rcp)
+{
+    if (!rcp->seeded || rcp->nout >= RNG_RESEED) {
+        return true;
+    }
+
+    return rcp->epoch != entropy_epoch;
+}
+
+/*
+ * Fill a kernel buffer with random bytes.
+ *
+ * @buf: Buffer to fill
+ * @len: Number of bytes to fill
+ */
+void
+random_bytes(void *buf, size_t len)
+{
+    struct rng_cpu *rcp;
+    uint8_t seed[32], *p = buf;
+    uint32_t epoch = 0;
+    bool reseed;
+    size_t n, off;
+
+    while (len > 0) {
+        /* Take the seed before disabling preemption */
+        rcp = PERCPU_PTR(rng_cpu);
+        if ((reseed = rng_need_reseed(rcp))) {
+            rng_extract(seed, &epoch);
+        }
+
+        sched_preempt_set(false);
+        rcp = PERCPU_PTR(rng_cpu);
+
+        if (reseed) {
+            for (size_t i = 0; i < sizeof(rcp->key); ++i) {
+                rcp->key[i] ^= seed[i];
+            }
+
+            memset(rcp->buf, 0, sizeof(rcp->buf));
+            rcp->avail = 0;
+            rcp->nout = 0;
+            rcp->epoch = epoch;
+            rcp->seeded = 1;
+        }
+
+        if (rcp->avail == 0) {
+            rng_refill(rcp);
+        }
+
+        /* Hand out bytes and wipe them */
+        n = MIN(len, rcp->avail);
+        off = sizeof(rcp->buf) - rcp->avail;
+        memcpy(p, &rcp->buf[off], n);
+        memset(&rcp->buf[off], 0, n);
+        rcp->avail -= n;
+        rcp->nout += n;
+
+        sched_preempt_set(true);
+        p += n;
+        len -= n;
+    }
+
+    memset(seed, 0, sizeof(seed));
+}
+
+/*
+ * Mix data into the entropy pool, every generator
+ * reseeds before its next output.
+ *
+ * @buf: Data to mix in
+ * @len: Length of `buf'
+ * @bits: Bits of entropy `buf' is worth
+ */
+void
+random_add_entropy(const void *buf, size_t len, uint32_t bits)
+{
+    spinlock_acquire(&entropy_lock);
+    mix_entropy(&entropy, buf, len, bits);
+    ++entropy_epoch;
+    spinlock_release(&entropy_lock);
+}
+
+/*
+ * Fill a user buffer with random bytes
+ *
+ * arg0: Buffer
+ * arg1: Length of buffer
+ * arg2: Flags (see GRND_*)
+ *
+ * Returns the number of bytes filled.
+ */
+scret_t
+sys_getrandom(struct syscall_args *scargs)
+{
+    uint8_t kbuf[256];
+    char *u_buf = (char *)scargs->arg0;
+    size_t len = scargs->arg1;
+    uint32_t flags = scargs->arg2;
+    size_t n, done = 0;
+    int error = 0;
+
+    if (ISSET(flags, ~(GRND_NONBLOCK | GRND_RANDOM))) {
+        return -EINVAL;
+    }
+
+    len = MIN(len, GETRANDOM_MAX);
+    while (done < len) {
+        n = MIN(len - done, sizeof(kbuf));
+        random_bytes(kbuf, n);
+        if ((error = copyout(kbuf, &u_buf[done], n)) < 0) {
+            break;
+        }
+        done += n;
+    }
+
+    memset(kbuf, 0, sizeof(kbuf));
+    return (done == 0 && error < 0) ? error : done;
 }
 
 static int
 random_read(dev_t dev, struct sio_txn *sio, int flags)
 {
-    tsc = read_tsc();
-    mix_entropy(&entropy, (uint8_t *)&tsc, sizeof(tsc), 1);
+    random_bytes(sio->buf, sio->len);
+    return sio->len;
+}
 
-    chacha20_init(state, entropy.pool, nonce, 0);
-    chacha20_encrypt(state, NULL, sio->buf, sio->len);
+/*
+ * Writes are mixed into the pool but are not
+ * credited with any entropy.
+ *
+ * Every write forces all generators to reseed, so
+ * only root may write (the nodes are 0644 but devfs
+ * does not check modes).
+ */
+static int
+random_write(dev_t dev, struct sio_txn *sio, int flags)
+{
+    struct proc *td;
+
+    td = this_td();
+    if (td != NULL && td->cred.euid != 0) {
+        return -EPERM;
+    }
 
+    random_add_entropy(sio->buf, sio->len, 0);
     return sio->len;
 }
 
+static void
+random_detect_hw(void)
+{
+#if defined(__x86_64__)
+    uint32_t eax, ebx, ecx, edx;
+
+    /* RDRAND is CPUID.(EAX=1H):ECX[30] */
+    CPUID(0x00000001, eax, ebx, ecx, edx);
+    have_rdrand = ISSET(ecx, BIT(30));
+
+    /* RDSEED is CPUID.(EAX=7H,ECX=0H):EBX[18] */
+    CPUID(0x00000000, eax, ebx, ecx, edx);
+    if (eax >= 7) {
+        CPUID_SUB(0x00000007, 0, eax, ebx, ecx, edx);
+        have_rdseed = ISSET(ebx, BIT(18));
+    }
+#endif  /* __x86_64__ */
+}
+
 static int
 random_init(void)
 {
     char devname[] = "random";
+    char udevname[] = "urandom";
     devmajor_t major;
+    uint64_t stamp;
     dev_t dev;
 
+    random_detect_hw();
+    stamp = rng_stamp();
+    random_add_entropy(&stamp, sizeof(stamp), 1);
+
     /* Register the device here */
     major = dev_alloc_major();
     dev = dev_alloc(major);
     dev_register(major, dev, &random_cdevsw);
-    devfs_create_entry(devname, major, dev, 0444);
+    devfs_create_entry(devname, major, dev, 0644);
 
+    /* Both are the same generator */
+    dev = dev_alloc(major);
+    dev_register(major, dev, &random_cdevsw);
+    devfs_create_entry(udevname, major, dev, 0644);
     return 0;
 }
 
 static struct cdevsw random_cdevsw = {
     .read = random_read,
-    .write = nowrite
+    .write = random_write
 };
 
 DRIVER_EXPORT(random_init, "random");
@@ -587,4 +587,4 @@ xhci_init(void)
     return xhci_init_hc(&xhc);
 }
 
-DRIVER_EXPORT(xhci_init, "xhci");
+DRIVER_DEFER(xhci_init, "xhci");
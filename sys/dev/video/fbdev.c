@@ -37,6 +37,7 @@
 #include <fs/devfs.h>
 #include <fs/ctlfs.h>
 #include <vm/vm.h>
+#include <vm/map.h>
 #include <string.h>
 
 #define FRAMEBUFFER \
@@ -87,12 +88,52 @@ ctl_attr_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
     return len;
 }
 
+/*
+ * Give the kernel its own write-combining view of
+ * the framebuffer. The bootloader's mapping lives in
+ * the HHDM which may use huge pages that pmap cannot
+ * change the caching type of, so a separate window
+ * is used when the machine provides one.
+ *
+ * Returns the pointer to draw through, falling back
+ * to the bootloader's mapping.
+ */
+static uint32_t *
+fbdev_kmap(void)
+{
+#if defined(FBDEV_KVA)
+    static uint32_t *kva = NULL;
+    vm_prot_t prot = PROT_READ | PROT_WRITE;
+    size_t size;
+    paddr_t pa;
+
+    if (kva != NULL) {
+        return kva;
+    }
+
+    pa = VIRT_TO_PHYS(FRAMEBUFFER->address);
+    size = FRAMEBUFFER->pitch * FRAMEBUFFER->height;
+    if (vm_map(g_kvas, FBDEV_KVA, pa, prot, size) != 0) {
+        return FRAMEBUFFER->address;
+    }
+    if (vm_set_cache(g_kvas, FBDEV_KVA, VM_CACHE_WC, size) != 0) {
+        vm_unmap(g_kvas, FBDEV_KVA, size);
+        return FRAMEBUFFER->address;
+    }
+
+    kva = (uint32_t *)FBDEV_KVA;
+    return kva;
+#else
+    return FRAMEBUFFER->address;
+#endif  /* FBDEV_KVA */
+}
+
 struct fbdev
 fbdev_get(void)
 {
     struct fbdev ret;
 
-    ret.mem = FRAMEBUFFER->address;
+    ret.mem = fbdev_kmap();
     ret.width = FRAMEBUFFER->width;
     ret.height = FRAMEBUFFER->height;
     ret.pitch = FRAMEBUFFER->pitch;
@@ -127,7 +168,8 @@ fbdev_init(void)
 static struct cdevsw fb_cdevsw = {
     .read = noread,
     .write = nowrite,
-    .mmap = fbdev_mmap
+    .mmap = fbdev_mmap,
+    .flags = CDEV_MMAP_WC
 };
 
 static const struct ctlops fb_size_ctl = {
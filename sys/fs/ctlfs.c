@@ -34,6 +34,7 @@
 #include <sys/syslog.h>
 #include <sys/mount.h>
 #include <sys/queue.h>
+#include <sys/spinlock.h>
 #include <fs/ctlfs.h>
 #include <vm/dynalloc.h>
 #include <string.h>
@@ -101,6 +102,7 @@ struct ctlfs_node {
 };
 
 static TAILQ_HEAD(, ctlfs_node) nodeq;
+static struct spinlock nodeq_lock = {0};
 
 /*
  * Look up entries within a ctlfs
@@ -299,8 +301,11 @@ ctlfs_create_node(const char *name, const struct ctlfs_dev *dp)
     cnp->name[namelen] = '\0';
     cnp->mode = dp->mode;
     cnp->magic = CTLFS_NODE_MAG;
-    TAILQ_INSERT_TAIL(&nodeq, cnp, link);
     TAILQ_INIT(&cnp->eq);
+
+    spinlock_acquire(&nodeq_lock);
+    TAILQ_INSERT_TAIL(&nodeq, cnp, link);
+    spinlock_release(&nodeq_lock);
     return 0;
 }
 
@@ -355,7 +360,10 @@ ctlfs_create_entry(const char *name, const struct ctlfs_dev *dp)
     enp->magic = CTLFS_ENTRY_MAG;
     enp->mode = dp->mode;
     enp->parent = parent;
+
+    spinlock_acquire(&nodeq_lock);
     TAILQ_INSERT_TAIL(&parent->eq, enp, link);
+    spinlock_release(&nodeq_lock);
     return 0;
 }
 
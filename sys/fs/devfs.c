@@ -34,6 +34,7 @@
 #include <sys/syslog.h>
 #include <sys/mount.h>
 #include <sys/device.h>
+#include <sys/spinlock.h>
 #include <fs/devfs.h>
 #include <vm/dynalloc.h>
 #include <string.h>
@@ -49,6 +50,7 @@ struct devfs_node {
 };
 
 static TAILQ_HEAD(, devfs_node) devlist;
+static struct spinlock devlist_lock = {0};
 
 static inline int
 cdevsw_read(void *devsw, dev_t dev, struct sio_txn *sio)
@@ -297,7 +299,10 @@ devfs_create_entry(const char *name, devmajor_t major, dev_t dev, mode_t mode)
     dnp->major = major;
     dnp->dev = dev;
     dnp->mode = mode;
+
+    spinlock_acquire(&devlist_lock);
     TAILQ_INSERT_TAIL(&devlist, dnp, link);
+    spinlock_release(&devlist_lock);
     return 0;
 }
 
@@ -219,29 +219,21 @@ static int
 initramfs_read(struct vnode *vp, struct sio_txn *sio)
 {
     struct initramfs_node *n = vp->data;
-    uint8_t *src, *dest;
-    uint32_t count = 0;
+    uint8_t *src;
+    size_t count;
 
     /* Ensure pointers are valid */
     if (n == NULL)
         return -EIO;
     if (sio->buf == NULL)
         return -EIO;
-    if (sio->len > n->size)
-        sio->len = n->size;
-
-    src = n->data;
-    dest = sio->buf;
+    if (sio->offset >= n->size)
+        return 0;
 
     /* Copy the file data */
-    for (size_t i = 0; i < sio->len; ++i) {
-        if ((sio->offset + i) >= n->size) {
-            break;
-        }
-        dest[i] = src[sio->offset + i];
-        ++count;
-    }
-
+    src = n->data;
+    count = MIN(sio->len, n->size - sio->offset);
+    memcpy(sio->buf, &src[sio->offset], count);
     return count;
 }
 
@@ -53,5 +53,6 @@ struct intr_hand {
 };
 
 void *intr_register(const char *name, const struct intr_hand *ih);
+void intr_stat_init(void);
 
 #endif  /* !_MACHINE_INTR_H_ */
@@ -39,6 +39,7 @@
 #define CR4_DE      BIT(3)  /* Debugging extensions */
 #define CR4_PSE     BIT(4)  /* Page size extensions */
 #define CR4_PCE     BIT(8)  /* Performance monitoring counter enable */
+#define CR4_OSFXSR  BIT(9)  /* FXSAVE/FXRSTOR and SSE enable */
 #define CR4_UMIP    BIT(11) /* User mode instruction prevention */
 #define CR4_LA57    BIT(12) /* Level 5 paging enable */
 #define CR4_VMXE    BIT(13) /* Virtual machine extensions enable */
@@ -106,6 +107,20 @@ amd64_write_cr0(uint64_t val)
     __ASMV("mov %0, %%cr0" :: "r" (val) : "memory");
 }
 
+static inline uint64_t
+amd64_read_cr3(void)
+{
+    uint64_t cr3;
+    __ASMV("mov %%cr3, %0" : "=r" (cr3) :: "memory");
+    return cr3;
+}
+
+static inline void
+amd64_write_cr3(uint64_t val)
+{
+    __ASMV("mov %0, %%cr3" :: "r" (val) : "memory");
+}
+
 static inline uint64_t
 amd64_read_cr8(void)
 {
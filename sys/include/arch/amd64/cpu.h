@@ -32,6 +32,7 @@
 
 #include <sys/types.h>
 #include <sys/cdefs.h>
+#include <sys/param.h>
 #include <sys/proc.h>
 #include <sys/sched.h>
 #include <sys/spinlock.h>
@@ -58,7 +59,6 @@ struct cpu_info {
     uint32_t apicid;
     uint32_t feat;
     uint32_t vendor;            /* Vendor (see CPU_VENDOR_*) */
-    uint8_t preempt : 1;        /* CPU is preemptable */
     uint8_t ipi_dispatch : 1;   /* 1: IPIs being dispatched */
     ipi_pend_t ipi_pending;
     uint8_t id;                 /* MI Logical ID */
@@ -68,6 +68,7 @@ struct cpu_info {
     uint8_t tlb_shootdown : 1;
     uint8_t online : 1;         /* CPU online */
     uint8_t ipl;
+    uint32_t nopreempt;         /* Preemption disable depth */
     size_t lapic_tmr_freq;
     uint8_t irq_mask;
     vaddr_t shootdown_va;
@@ -75,8 +76,9 @@ struct cpu_info {
     struct tss_entry *tss;
     struct proc *curtd;
     struct spinlock lock;
+    void *percpu;               /* Per-CPU data area */
     struct cpu_info *self;
-};
+} __aligned(COHERENCY_UNIT);
 
 __dead void cpu_halt_all(void);
 void cpu_halt_others(void);
@@ -84,6 +86,7 @@ void cpu_startup(struct cpu_info *ci);
 
 void cpu_enable_smep(void);
 void cpu_disable_smep(void);
+int cpu_init_pat(void);
 
 struct cpu_info *cpu_get(uint32_t index);
 struct sched_cpu *cpu_get_stat(uint32_t cpu_index);
@@ -95,6 +98,7 @@ struct cpu_info *this_cpu(void);
 void mp_bootstrap_aps(struct cpu_info *ci);
 
 extern struct cpu_info g_bsp_ci;
+extern volatile bool g_gsbase_ready;
 
 __always_inline static inline void
 cpu_halt(void)
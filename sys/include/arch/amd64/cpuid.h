@@ -37,4 +37,10 @@
             : "=a" (a), "=b" (b), "=c" (c), "=d" (d)    \
             : "0" (level))
 
+/* Same as CPUID() but with a subleaf in ECX */
+#define CPUID_SUB(level, sub, a, b, c, d)               \
+    __ASMV("cpuid\n\t"                                  \
+            : "=a" (a), "=b" (b), "=c" (c), "=d" (d)    \
+            : "0" (level), "2" (sub))
+
 #endif  /* !_MACHINE_CPUID_H_ */
@@ -53,6 +53,8 @@
 #define IPI_PER_VEC 16  /* Max IPIs per vector */
 
 struct intr_hand;
+struct msi_vec;
+struct trapframe;
 
 /*
  * Contains information passed to driver
@@ -83,6 +85,8 @@ struct intr_data {
  * @priority: Interrupt priority    [r]
  * @irq: Interrupt request number   [o]
  * @vector: Interrupt vector        [v]
+ * @affinity: Processor routed to   [v]
+ * @msi: MSI/MSI-X vector           [i]
  *
  * XXX: `name' must be null terminated ('\0')
  *
@@ -104,9 +108,15 @@ struct intr_hand {
     int priority;
     int irq;
     int vector;
+    uint32_t affinity;
+    struct msi_vec *msi;
 };
 
 void *intr_register(const char *name, const struct intr_hand *ih);
+int intr_set_affinity(struct intr_hand *ih, uint32_t cpu);
+void intr_account(struct intr_hand *ih);
+void intr_dispatch(struct trapframe *tf);
+void intr_stat_init(void);
 
 int splraise(uint8_t s);
 void splx(uint8_t s);
@@ -42,5 +42,6 @@ void ioapic_irq_mask(uint8_t irq);
 
 void ioapic_irq_unmask(uint8_t irq);
 void ioapic_set_vec(uint8_t irq, uint8_t vector);
+void ioapic_set_dest(uint8_t irq, uint8_t apicid);
 
 #endif  /* !_MACHINE_IOAPIC_H_ */
@@ -62,6 +62,7 @@ struct cpu_ipi {
 
 int md_ipi_alloc(struct cpu_ipi **res);
 int md_ipi_send(struct cpu_info *ci, ipi_pend_t ipi);
+int md_ipi_broadcast(ipi_pend_t ipi, bool self);
 void md_ipi_init(void);
 
 #endif  /* !_MACHINE_IPI_H_ */
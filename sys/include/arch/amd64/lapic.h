@@ -43,7 +43,7 @@
 
 void lapic_init(void);
 void lapic_eoi(void);
-void lapic_send_ipi(uint8_t id, uint8_t shorthand, uint8_t vector);
+void lapic_send_ipi(uint32_t id, uint8_t shorthand, uint8_t vector);
 
 extern void *g_lapic_base;
 
@@ -35,6 +35,7 @@
 #define IA32_GS_BASE        0xC0000101
 #define IA32_FS_BASE        0xC0000100
 #define IA32_APIC_BASE_MSR  0x0000001B
+#define IA32_PAT            0x00000277
 
 #if !defined(__ASSEMBLER__)
 static inline uint64_t
@@ -32,9 +32,15 @@
 
 #include <sys/types.h>
 #include <vm/pmap.h>
+#include <vm/vm.h>
+
+/* Per-thread system call stack */
+#define PCB_KSTACK_PAGES 1
+#define PCB_KSTACK_SIZE  (PCB_KSTACK_PAGES * DEFAULT_PAGESIZE)
 
 struct pcb {
     struct vas addrsp;
+    vaddr_t kstack;             /* System call stack base */
 };
 
 #endif  /* !_MACHINE_PCB_H_ */
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _MACHINE_PERCPU_H_
+#define _MACHINE_PERCPU_H_
+
+#include <sys/types.h>
+#include <sys/cdefs.h>
+#include <machine/cpu.h>
+
+void md_percpu_early(struct cpu_info *ci);
+
+/*
+ * Get the per-CPU data area of the current processor,
+ * returns NULL if %gs has not been set up yet.
+ */
+__always_inline static inline void *
+md_percpu_base(void)
+{
+    void *base;
+
+    if (__unlikely(!g_gsbase_ready)) {
+        return NULL;
+    }
+
+    __ASMV("mov %%gs:%1, %0"
+        : "=r" (base)
+        : "m" (*&((struct cpu_info *)0)->percpu));
+
+    if (__unlikely(base == NULL)) {
+        md_percpu_early(this_cpu());
+    }
+
+    return base;
+}
+
+/*
+ * Get the per-CPU data area of a specific processor.
+ *
+ * @ci: Processor to get the area of
+ */
+__always_inline static inline void *
+md_percpu_base_cpu(struct cpu_info *ci)
+{
+    if (__unlikely(ci->percpu == NULL)) {
+        md_percpu_early(ci);
+    }
+
+    return ci->percpu;
+}
+
+#endif  /* !_MACHINE_PERCPU_H_ */
@@ -33,6 +33,12 @@
 #include <sys/types.h>
 #include <sys/spinlock.h>
 
+/*
+ * Kernel window for the framebuffer, unused PML4
+ * slot right below the kernel image.
+ */
+#define FBDEV_KVA 0xFFFFFF0000000000ULL
+
 /*
  * VAS structure - describes a virtual address space
  */
@@ -27,10 +27,21 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#ifndef _CRYPTO_CHACHA20_H_
+#define _CRYPTO_CHACHA20_H_
+
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h>
 
+#define CHACHA20_BLOCK_SIZE 64
+
+/* Implementations of the block function */
+#define CHACHA20_IMPL_SCALAR    0   /* One block at a time */
+#define CHACHA20_IMPL_SSE2      1   /* 4 blocks at a time */
+#define CHACHA20_IMPL_AVX2      2   /* 8 blocks at a time */
+#define CHACHA20_NIMPL          3
+
 #define ROTL(a,b) (((a) << (b)) | ((a) >> (32 - (b))))
 
 #define QR(a,b,c,d) \
@@ -45,3 +56,8 @@ void chacha20_init(uint32_t state[16], const uint8_t key[32],
 void chacha20_block(uint32_t state[16], uint8_t out[64]);
 void chacha20_encrypt(uint32_t state[16], uint8_t *in, uint8_t *out, size_t len);
 
+int chacha20_impl_set(int impl);
+int chacha20_impl_get(void);
+const char *chacha20_impl_name(int impl);
+
+#endif  /* !_CRYPTO_CHACHA20_H_ */
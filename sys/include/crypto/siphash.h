@@ -32,3 +32,5 @@
 #include <stdint.h>
 
 uint64_t siphash24(const void *src, unsigned long src_sz, const char k[16]);
+void siphash24_x4(const void *src, unsigned long src_sz,
+    const char keys[4][16], uint64_t out[4]);
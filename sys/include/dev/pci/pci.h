@@ -55,6 +55,7 @@ struct pci_device {
     uint8_t func;
 
     uint16_t segment;
+    uint16_t msi_capoff;
     uint16_t msix_capoff;
     uint16_t device_id;
     uint16_t vendor_id;
@@ -74,11 +75,45 @@ struct pci_device {
     TAILQ_ENTRY(pci_device) link;
 };
 
+/*
+ * MSI/MSI-X interrupt descriptor
+ *
+ * @name: Name of the interrupt
+ * @handler: Interrupt handler
+ *
+ * XXX: The handler finds the index of the vector
+ *      that fired (e.g., its queue number) in the
+ *      `data_u64' field of its interrupt data.
+ */
 struct msi_intr {
     const char *name;
     int(*handler)(void *);
 };
 
+/*
+ * A single MSI or MSI-X vector of a device
+ *
+ * @dev: Device the vector belongs to
+ * @entry: MSI-X table entry (MSI-X only)
+ * @index: Index of the vector
+ * @msix: 1 if MSI-X, 0 if MSI
+ */
+struct msi_vec {
+    struct pci_device *dev;
+    volatile uint32_t *entry;
+    uint16_t index;
+    uint8_t msix : 1;
+};
+
+/*
+ * MSI/MSI-X message, composed by the machine
+ * dependent code.
+ */
+struct msi_msg {
+    uint64_t addr;
+    uint32_t data;
+};
+
 pcireg_t pci_readl(struct pci_device *dev, uint32_t offset);
 struct pci_device *pci_get_device(struct pci_lookup lookup, uint16_t lookup_type);
 
@@ -86,8 +121,16 @@ int pci_map_bar(struct pci_device *dev, uint8_t barno, void **vap);
 void pci_writel(struct pci_device *dev, uint32_t offset, pcireg_t val);
 
 int pci_enable_msix(struct pci_device *dev, const struct msi_intr *intr);
+int pci_alloc_msix(struct pci_device *dev, const struct msi_intr *intr, uint16_t nvec);
+int pci_alloc_msi(struct pci_device *dev, const struct msi_intr *intr);
+uint16_t pci_msix_count(struct pci_device *dev);
+void pci_msi_write(struct msi_vec *mvp, const struct msi_msg *msg);
 void pci_add_device(struct pci_device *dev);
 
+/* Machine dependent MSI/MSI-X routines */
+int pci_msi_intr(const struct msi_intr *intr, struct msi_vec *mvp);
+int pci_msi_route(struct msi_vec *mvp, uint8_t vector, uint32_t cpu);
+
 void pci_msix_eoi(void);
 int pci_init(void);
 
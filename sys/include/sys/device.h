@@ -45,10 +45,14 @@ typedef int(*dev_read_t)(dev_t, struct sio_txn *, int);
 typedef int(*dev_write_t)(dev_t, struct sio_txn *, int);
 typedef int(*dev_bsize_t)(dev_t);
 
+/* Character device flags */
+#define CDEV_MMAP_WC BIT(0)     /* Map write-combining */
+
 struct cdevsw {
     int(*read)(dev_t dev, struct sio_txn *sio, int flags);
     int(*write)(dev_t dev, struct sio_txn *sio, int flags);
     paddr_t(*mmap)(dev_t dev, size_t size, off_t off, int flags);
+    uint32_t flags;
 
     /* Private */
     struct vm_object vmobj;
@@ -31,19 +31,53 @@
 #define _SYS_DRIVER_H_
 
 #include <sys/cdefs.h>
-#include <sys/proc.h>
 #include <sys/types.h>
+#if defined(_KERNEL)
+#include <sys/proc.h>
+#endif  /* _KERNEL */
+
+#define DRIVER_NAMELEN 16
+
+/*
+ * Boot timeline entry, one per driver that was
+ * started. Read back from '/ctl/boot/timeline'
+ *
+ * @name: Name of the driver
+ * @start_usec: Time init started (usec since boot)
+ * @end_usec: Time init returned (usec since boot)
+ * @status: Value returned by init
+ * @cpu: Logical ID of the processor that ran init
+ * @deferred: 1 if this is a deferred driver
+ */
+struct driver_time {
+    char name[DRIVER_NAMELEN];
+    uint64_t start_usec;
+    uint64_t end_usec;
+    int32_t status;
+    uint8_t cpu;
+    uint8_t deferred;
+    uint16_t reserved;
+};
 
 #if defined(_KERNEL)
 
 /* Variable driver data */
 struct driver_var {
     uint8_t deferred : 1;
+    uint8_t started : 1;
 };
 
+/*
+ * @init: Driver init routine
+ * @name: Name of the driver
+ * @deps: NULL terminated list of driver names that
+ *        must be started first, may be NULL.
+ * @data: Variable driver data
+ */
 struct driver {
     int(*init)(void);
     const char *name;
+    const char **deps;
     struct driver_var *data;
 };
 
@@ -57,18 +91,22 @@ extern char __drivers_init_end[];
 extern char __driversd_init_start[];
 extern char __driversd_init_end[];
 
-#define DRIVER_EXPORT(INIT, NAME)                   \
-    static struct driver_var __driver_var = {       \
-        .deferred = 0                               \
-    };                                              \
-                                                    \
-    __attribute__((used, section(".drivers")))      \
-    static struct driver __driver_desc = {          \
-        .init = INIT,                               \
-        .data = &__driver_var,                      \
-        .name = NAME                                \
+#define __DRIVER_DESC(SECTION, DEFER, INIT, NAME, DEPS) \
+    static struct driver_var __driver_var = {           \
+        .deferred = DEFER                               \
+    };                                                  \
+                                                        \
+    __attribute__((used, section(SECTION)))             \
+    static struct driver __driver_desc = {              \
+        .init = INIT,                                   \
+        .data = &__driver_var,                          \
+        .name = NAME,                                   \
+        .deps = DEPS                                    \
     }
 
+#define DRIVER_EXPORT(INIT, NAME) \
+    __DRIVER_DESC(".drivers", 0, INIT, NAME, NULL)
+
 /*
  * Some drivers are not required to start up
  * early for proper system operation and may
@@ -85,18 +123,18 @@ extern char __driversd_init_end[];
  * macro gives the value of 1 if the current driver
  * context has yet to be initialized. The driver may
  * use this to defer requests for I/O.
+ *
+ * Deferred drivers are started concurrently across
+ * all processors. A driver that needs others to be
+ * started first lists them with DRIVER_DEFER_DEPS(),
+ * e.g., DRIVER_DEFER_DEPS(foo_init, "foo", "ahci").
  */
-#define DRIVER_DEFER(INIT, NAME)                     \
-    static struct driver_var __driver_var = {        \
-        .deferred = 1                                \
-    };                                               \
-                                                     \
-    __attribute__((used, section(".drivers.defer"))) \
-    static struct driver __driver_desc = {           \
-        .init = INIT,                                \
-        .data = &__driver_var,                       \
-        .name = NAME                                 \
-    }
+#define DRIVER_DEFER(INIT, NAME) \
+    __DRIVER_DESC(".drivers.defer", 1, INIT, NAME, NULL)
+
+#define DRIVER_DEFER_DEPS(INIT, NAME, ...)              \
+    __DRIVER_DESC(".drivers.defer", 1, INIT, NAME,      \
+        ((const char *[]){ __VA_ARGS__, NULL }))
 
 #define DRIVER_DEFERRED() __driver_var.deferred
 
@@ -107,7 +145,7 @@ extern char __driversd_init_end[];
         if (driver_blacklist_check((__d)->name)) {                      \
             continue;                                                   \
         }                                                               \
-        __d->init();                                                    \
+        driver_run(__d);                                                \
     }
 
 #define DRIVERS_SCHED() \
@@ -118,6 +156,8 @@ int driver_blacklist(const char *name);
 int driver_blacklist_check(const char *name);
 void driver_blacklist_init(void);
 
+int driver_run(const struct driver *dp);
+void driver_timeline_init(void);
 void __driver_init_td(void);
 
 #endif  /* _KERNEL */
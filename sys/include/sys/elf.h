@@ -562,4 +562,28 @@ typedef struct {
 #define SHF_COMPRESSED	     (1 << 11)	/* Section with compressed data. */
 #define SHF_MASKOS	     0x0ff00000	/* OS-specific.  */
 #define SHF_MASKPROC	     0xf0000000	/* Processor-specific */
+
+/* Symbol table entry.  */
+
+typedef struct {
+  Elf64_Word st_name;		/* Symbol name (string tbl index) */
+  unsigned char st_info;	/* Symbol type and binding */
+  unsigned char st_other;	/* Symbol visibility */
+  Elf64_Section st_shndx;	/* Section index */
+  Elf64_Addr st_value;		/* Symbol value */
+  Elf64_Xword st_size;		/* Symbol size */
+} Elf64_Sym;
+
+/* How to extract and insert information held in the st_info field.  */
+
+#define ELF64_ST_BIND(val)	(((unsigned char) (val)) >> 4)
+#define ELF64_ST_TYPE(val)	((val) & 0xf)
+
+/* Legal values for ST_TYPE subfield of st_info (symbol type).  */
+
+#define STT_NOTYPE	0		/* Symbol type is unspecified */
+#define STT_OBJECT	1		/* Symbol is a data object */
+#define STT_FUNC	2		/* Symbol is a code object */
+#define STT_SECTION	3		/* Symbol associated with a section */
+#define STT_FILE	4		/* Symbol's name is file name */
 #endif      /* _SYS_ELF_H_ */
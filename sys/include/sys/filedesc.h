@@ -60,6 +60,7 @@ int fd_open(const char *pathname, int flags);
 off_t fd_seek(int fildes, off_t offset, int whence);
 
 int fd_dup(struct proc *td, int fd);
+void fd_closeall(struct proc *td);
 struct filedesc *fd_get(struct proc *td, unsigned int fdno);
 
 scret_t sys_lseek(struct syscall_args *scargs);
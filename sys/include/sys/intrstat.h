@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_INTRSTAT_H_
+#define _SYS_INTRSTAT_H_
+
+#include <sys/types.h>
+
+#define INTR_NAMELEN 24
+
+/*
+ * Number of times an interrupt fired on a single
+ * processor, read back from '/ctl/intr/stat' with
+ * one record per interrupt per processor.
+ *
+ * @name: Name of the interrupt
+ * @count: Times it fired on `cpu'
+ * @vector: Interrupt vector
+ * @cpu: Processor `count' is for
+ * @affinity: Processor the interrupt is routed to
+ */
+struct intr_stat {
+    char name[INTR_NAMELEN];
+    uint64_t count;
+    uint16_t vector;
+    uint16_t cpu;
+    uint16_t affinity;
+    uint16_t reserved;
+};
+
+/*
+ * Written to '/ctl/intr/affinity' to route an
+ * interrupt to another processor.
+ *
+ * @vector: Interrupt vector to move
+ * @cpu: Logical ID of the new processor
+ */
+struct intr_affinity {
+    uint32_t vector;
+    uint32_t cpu;
+};
+
+#endif  /* !_SYS_INTRSTAT_H_ */
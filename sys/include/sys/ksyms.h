@@ -40,5 +40,7 @@ struct kernel_symbol {
 
 __weak extern struct kernel_symbol g_ksym_table[];
 
+const char *ksyms_lookup(uintptr_t addr, off_t *off);
+
 #endif  /* defined(_KERNEL) */
 #endif
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_KTRACE_H_
+#define _SYS_KTRACE_H_
+
+#include <sys/types.h>
+#include <sys/param.h>
+
+#define SYSCALL_NSTAT   64      /* Max syscalls accounted */
+#define SYSCALL_NHIST   20      /* Latency histogram buckets */
+#define SYSCALL_HSHIFT  8       /* log2(cycles) of the first bucket */
+
+/* Record types */
+#define KTR_CALL    0           /* Syscall entry, `arg' holds args */
+#define KTR_RET     1           /* Syscall exit, see `ret' / `cycles' */
+
+/* Control operations */
+#define KTROP_SET   0           /* Start tracing a process */
+#define KTROP_CLEAR 1           /* Stop tracing a process */
+
+/*
+ * Per-syscall statistics, read back from
+ * '/ctl/syscall/stat' as one entry per syscall
+ * number, summed across all processors.
+ *
+ * @calls: Number of times the syscall was made
+ * @cycles: Total TSC cycles spent in the syscall
+ * @max: Longest single call in TSC cycles
+ * @hist: Latency histogram, bucket `n' counts calls
+ *        that took [2^(n+SYSCALL_HSHIFT), 2^(n+SYSCALL_HSHIFT+1))
+ *        cycles. The first and last buckets are open ended.
+ */
+struct syscall_stat {
+    uint64_t calls;
+    uint64_t cycles;
+    uint64_t max;
+    uint64_t hist[SYSCALL_NHIST];
+};
+
+/*
+ * A ktrace record, read back in bulk from
+ * '/ctl/ktrace/buf'
+ *
+ * @tsc: Timestamp counter value
+ * @pid: PID of the traced process
+ * @cpu: Logical ID of the processor
+ * @type: Record type (see KTR_*)
+ * @scnum: Syscall number
+ * @arg: Syscall arguments (KTR_CALL)
+ * @ret: Syscall return value (KTR_RET)
+ * @cycles: Time spent in the syscall (KTR_RET)
+ */
+struct ktr_rec {
+    uint64_t tsc;
+    uint32_t pid;
+    uint8_t cpu;
+    uint8_t type;
+    uint16_t scnum;
+    union {
+        uint64_t arg[6];
+        struct {
+            int64_t ret;
+            uint64_t cycles;
+        };
+    };
+};
+
+/*
+ * Tracing control, written to '/ctl/ktrace/ctl'
+ *
+ * @pid: Child of the caller to trace, or 0 for the
+ *       caller itself.
+ * @op: Operation to perform (see KTROP_*)
+ *
+ * Tracing is inherited by processes spawned while
+ * it is enabled.
+ */
+struct ktrace_ctl {
+    int32_t pid;
+    uint32_t op;
+};
+
+#if defined(_KERNEL)
+#include <sys/syscall.h>
+
+void syscall_account(uint16_t scnum, uint64_t cycles);
+void ktrace_call(uint16_t scnum, const struct syscall_args *scargs);
+void ktrace_ret(uint16_t scnum, scret_t ret, uint64_t cycles);
+void ktrace_init(void);
+
+#endif  /* _KERNEL */
+#endif  /* !_SYS_KTRACE_H_ */
@@ -85,6 +85,9 @@ struct mmap_lgdr {
 int mmap_entrycmp(const struct mmap_entry *a, const struct mmap_entry *b);
 RBT_PROTOTYPE(lgdr_entries, mmap_entry, hd, mmap_entrycmp)
 
+struct proc;
+void mmap_release(struct proc *td);
+
 /* Syscall layer */
 scret_t sys_mmap(struct syscall_args *scargs);
 scret_t sys_munmap(struct syscall_args *scargs);
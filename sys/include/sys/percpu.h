@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_PERCPU_H_
+#define _SYS_PERCPU_H_
+
+#include <sys/types.h>
+#include <sys/cdefs.h>
+#if defined(_KERNEL)
+#include <machine/percpu.h>
+#endif  /* _KERNEL */
+
+#if defined(_KERNEL)
+
+/*
+ * Per-CPU variables live in the .data.percpu section
+ * which is only a template. Every processor gets its
+ * own cache line aligned copy of the template when it
+ * starts up, reachable with a single %gs relative load
+ * on amd64.
+ *
+ * XXX: Nothing stops the current thread from being
+ *      migrated after PERCPU_PTR() returns. Use atomics
+ *      on the result (e.g., for counters) unless
+ *      preemption is off.
+ */
+#define __percpu __attribute__((__section__(".data.percpu")))
+
+#define DEFINE_PERCPU(TYPE, NAME) __percpu TYPE NAME
+#define DECLARE_PERCPU(TYPE, NAME) extern TYPE NAME
+
+/* Pointer to the current processor's copy */
+#define PERCPU_PTR(NAME) \
+    ((__typeof__(&(NAME)))percpu_addr(md_percpu_base(), &(NAME)))
+
+/* Pointer to the copy of a specific processor */
+#define PERCPU_PTR_CPU(NAME, CI) \
+    ((__typeof__(&(NAME)))percpu_addr(md_percpu_base_cpu(CI), &(NAME)))
+
+#define PERCPU(NAME) (*PERCPU_PTR(NAME))
+
+extern char __percpu_start[];
+extern char __percpu_end[];
+
+/*
+ * Translate the address of a per-CPU variable in the
+ * template to its address within a per-CPU data area.
+ * A NULL base uses the template itself, the MD code
+ * only allows that while the BSP sets up its area.
+ *
+ * @base: Base of the per-CPU data area
+ * @var: Address of the variable in the template
+ */
+__always_inline static inline void *
+percpu_addr(void *base, void *var)
+{
+    if (__unlikely(base == NULL)) {
+        return var;
+    }
+
+    return (char *)base + ((uintptr_t)var - (uintptr_t)__percpu_start);
+}
+
+void *percpu_alloc(void);
+
+#endif  /* _KERNEL */
+#endif  /* !_SYS_PERCPU_H_ */
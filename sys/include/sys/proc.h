@@ -43,6 +43,7 @@
 #include <sys/vsr.h>
 #include <sys/filedesc.h>
 #include <sys/signal.h>
+#include <sys/resource.h>
 #include <sys/vnode.h>
 #if defined(_KERNEL)
 #include <machine/frame.h>
@@ -84,12 +85,20 @@ struct __packed coredump {
  */
 typedef int16_t affinity_t;
 
+struct sched_cpu;
+
 struct proc {
     pid_t pid;
     struct exec_prog exec;
     struct ucred cred;
-    struct ksiginfo *ksig_list[PROC_SIGMAX];
+    struct rlimit rlim[RLIM_NLIMITS];
+    uint64_t cpu_usec;              /* CPU time charged (see RLIMIT_CPU) */
+    struct ksiginfo ksig_list[SIGRTMIN];
+    struct ksiginfo ksigq_pool[SIGQUEUE_MAX];
+    uint32_t ksigq_used;            /* Busy `ksigq_pool' slots */
+    volatile sigset_t sigpend;      /* Pending signals */
     struct filedesc *fds[PROC_MAX_FILEDES];
+    uint64_t fdmap[PROC_MAX_FILEDES / 64];  /* Open fds in `fds' */
     struct vsr_domain *vsr_tab[VSR_MAX_DOMAIN];
     struct mmap_lgdr *mlgdr;
     struct vcache *vcache;
@@ -110,6 +119,12 @@ struct proc {
     TAILQ_ENTRY(proc) leaf_link;
     TAILQ_HEAD(, ksiginfo) ksigq;
     TAILQ_ENTRY(proc) link;
+    struct proc *pid_next;
+    TAILQ_ENTRY(proc) reap_link;
+    TAILQ_ENTRY(proc) sleep_link;
+    void *wchan;                    /* Wait channel (see sched_sleep()) */
+    const struct sched_cpu *exit_cpu;
+    uint64_t exit_nswitch;
 };
 
 #define PROC_EXITING    BIT(0)  /* Exiting */
@@ -120,16 +135,31 @@ struct proc {
 #define PROC_KTD        BIT(5)  /* Kernel thread */
 #define PROC_SLEEP      BIT(6)  /* Thread execution paused */
 #define PROC_PINNED     BIT(7)  /* Pinned to CPU */
+#define PROC_KTRACE     BIT(8)  /* Syscalls being traced */
+#define PROC_REAPED     BIT(9)  /* Resources torn down by the reaper */
+#define PROC_XCPU       BIT(10) /* SIGXCPU sent (soft CPU limit hit) */
 
 struct proc *this_td(void);
 struct proc *td_copy(struct proc *td);
 struct proc *get_child(struct proc *cur, pid_t pid);
+struct proc *proc_lookup(pid_t pid);
+struct proc *proc_lookup_lock(pid_t pid);
+void proc_unlock(void);
+
+struct proc *proc_alloc(void);
+void proc_free(struct proc *td);
+void proc_hash(struct proc *td);
+void proc_reparent(struct proc *td, struct proc *newparent);
+void proc_set_zombie(struct proc *td);
+void proc_wait_zombie(struct proc *td, struct proc *child);
+size_t proc_count_uid(uid_t uid);
 
 int proc_init(struct proc *td, struct proc *parent);
 void proc_pin(struct proc *td, affinity_t cpu);
 void proc_unpin(struct proc *td);
 
 void proc_reap(struct proc *td);
+void reaper_init(void);
 void proc_coredump(struct proc *td, uintptr_t fault_addr);
 
 pid_t getpid(void);
@@ -146,6 +176,7 @@ pid_t spawn(struct proc *cur, void(*func)(void), void *p, int flags, struct proc
 
 uintptr_t md_td_stackinit(struct proc *td, void *stack_top, struct exec_prog *prog);
 __dead void md_td_kick(struct proc *td);
+void md_td_release(struct proc *td);
 
 int fork1(struct proc *cur, int flags, void(*ip)(void), struct proc **newprocp);
 int exit1(struct proc *td, int flags);
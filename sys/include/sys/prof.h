@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_PROF_H_
+#define _SYS_PROF_H_
+
+#include <sys/types.h>
+#include <sys/param.h>
+
+#define PROF_MAXDEPTH   15      /* Max frames per sample */
+#define PROF_MIN_HZ     10      /* Lowest sample rate */
+#define PROF_MAX_HZ     10000   /* Highest sample rate */
+#define PROF_DEFAULT_HZ 1000    /* Default sample rate */
+#define PROF_SYMLEN     56      /* Max symbol name length */
+
+/* Sample flags */
+#define PROF_USER BIT(0)        /* Sample taken in user mode */
+
+/*
+ * A single profiler sample, read back in bulk
+ * from '/ctl/prof/samples'
+ *
+ * @pid: PID of the interrupted thread
+ * @cpu: Logical ID of the sampled processor
+ * @flags: Sample flags (see PROF_USER)
+ * @depth: Number of valid entries in `pc'
+ * @pc: Interrupted PC followed by return addresses
+ */
+struct prof_sample {
+    uint32_t pid;
+    uint16_t cpu;
+    uint8_t flags;
+    uint8_t depth;
+    uint64_t pc[PROF_MAXDEPTH];
+};
+
+/*
+ * Profiler control, written to '/ctl/prof/ctl'
+ *
+ * @enable: 1 to start sampling, 0 to stop
+ * @hz: Samples per second per processor
+ */
+struct prof_ctl {
+    uint32_t enable;
+    uint32_t hz;
+};
+
+/*
+ * Kernel symbol table entry, read back from
+ * '/ctl/prof/ksyms' in address order.
+ */
+struct prof_ksym {
+    uint64_t addr;
+    char name[PROF_SYMLEN];
+};
+
+#if defined(_KERNEL)
+struct trapframe;
+
+extern volatile size_t g_prof_usec;
+
+bool prof_intr(struct trapframe *tf);
+int md_prof_capture(struct trapframe *tf, struct prof_sample *sp);
+void prof_init(void);
+
+#endif  /* _KERNEL */
+#endif  /* !_SYS_PROF_H_ */
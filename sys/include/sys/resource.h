@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_RESOURCE_H_
+#define _SYS_RESOURCE_H_
+
+#include <sys/types.h>
+
+/* Resources (see getrlimit()) */
+#define RLIMIT_CPU      0   /* CPU time in seconds */
+#define RLIMIT_NOFILE   1   /* Open file descriptors */
+#define RLIMIT_AS       2   /* Bytes mapped with mmap() */
+#define RLIMIT_NPROC    3   /* Processes per real user ID */
+#define RLIM_NLIMITS    4
+
+#define RLIM_INFINITY   ((rlim_t)-1)
+
+typedef uint64_t rlim_t;
+
+struct rlimit {
+    rlim_t rlim_cur;        /* Soft limit */
+    rlim_t rlim_max;        /* Hard limit */
+};
+
+/*
+ * Limit enforcement counters, read back from
+ * '/ctl/rlimit/stat'
+ *
+ * @hits: Number of times each limit (RLIMIT_*)
+ *        was hit and an operation refused.
+ */
+struct rlimit_stat {
+    uint64_t hits[RLIM_NLIMITS];
+};
+
+#if defined(_KERNEL)
+#include <sys/syscall.h>
+
+struct proc;
+
+void rlim_init(struct proc *td, struct proc *parent);
+int rlim_check(struct proc *td, int resource, rlim_t value);
+int rlim_check_inc(struct proc *td, int resource, rlim_t used, rlim_t inc);
+int rlim_check_nproc(struct proc *td);
+void rlim_cputick(struct proc *td, uint32_t usec);
+void rlimit_stat_init(void);
+
+scret_t sys_getrlimit(struct syscall_args *scargs);
+scret_t sys_setrlimit(struct syscall_args *scargs);
+#else
+int getrlimit(int resource, struct rlimit *rlim);
+int setrlimit(int resource, const struct rlimit *rlim);
+#endif  /* _KERNEL */
+#endif  /* !_SYS_RESOURCE_H_ */
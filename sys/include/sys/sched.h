@@ -73,6 +73,10 @@ void sched_yield(void);
 void sched_suspend(struct proc *td, const struct timeval *tv);
 void sched_detach(struct proc *td);
 
+void sched_sleep(void *chan, struct spinlock *lock);
+void sched_wakeup(void *chan);
+void sched_unsleep(struct proc *td);
+
 __dead void sched_enter(void);
 void sched_enqueue_td(struct proc *td);
 
@@ -32,18 +32,41 @@
 
 #include <sys/types.h>
 #include <sys/queue.h>
-#include <sys/proc.h>
 
 #define SIGFPE      8   /* Floating point exception */
 #define SIGKILL     9   /* Kill */
 #define SIGSEGV     11  /* Segmentation violation */
 #define SIGTERM     15  /* Terminate gracefully */
+#define SIGXCPU     24  /* CPU time limit exceeded */
 
-typedef uint32_t sigset_t;
+/*
+ * Realtime signals, these are queued rather than
+ * merged and carry a value. Signals below SIGRTMIN
+ * are standard signals.
+ */
+#define SIGRTMIN    32
+#define SIGRTMAX    63
+
+/* Max queued realtime signals per process */
+#define SIGQUEUE_MAX 32
+
+/* Signal codes (si_code) */
+#define SI_USER     0   /* Sent by kill() */
+#define SI_QUEUE    1   /* Sent by sigqueue() */
+#define SI_KERNEL   2   /* Sent by the kernel */
+
+typedef uint64_t sigset_t;
+
+union sigval {
+    int sival_int;
+    void *sival_ptr;
+};
 
 typedef struct {
     int si_signo;
     int si_code;
+    pid_t si_pid;
+    union sigval si_value;
 } siginfo_t;
 
 struct sigaction {
@@ -53,12 +76,28 @@ struct sigaction {
     void(*sa_sigaction)(int signo, siginfo_t *si, void *p);
 };
 
+/* Sigset functions */
+int sigemptyset(sigset_t *set);
+int sigfillset(sigset_t *set);
+int sigaddset(sigset_t *set, int signo);
+int sigdelset(sigset_t *set, int signo);
+int sigismember(const sigset_t *set, int signo);
+
 #if defined(_KERNEL)
+#include <sys/syscall.h>
+
 struct proc;
 
+/*
+ * Kernel signal descriptor. Standard signals use one
+ * preallocated slot per signal in the process, queued
+ * realtime signals come from a per-process pool.
+ */
 struct ksiginfo {
     int signo;
     int sigcode;
+    pid_t sender;
+    union sigval value;
     struct sigaction *si;
     TAILQ_ENTRY(ksiginfo) link;
 };
@@ -67,20 +106,23 @@ struct ksiginfo {
 int newsig(struct proc *td, int signo, struct ksiginfo **ksig);
 int delsig(struct proc *td, int signo);
 int sendsig(struct proc *td, const sigset_t *set);
+int queuesig(struct proc *td, int signo, int code, union sigval value);
+int sigwait_td(struct proc *td, const sigset_t *set, siginfo_t *info);
 void dispatch_signals(struct proc *td);
 int signals_init(struct proc *td);
 
-/* Sigset functions */
-int sigemptyset(sigset_t *set);
-int sigfillset(sigset_t *set);
-int sigaddset(sigset_t *set, int signo);
-int sigdelset(sigset_t *set, int signo);
-int sigismember(const sigset_t *set, int signo);
-
 /* Default handlers */
 void sigfpe_default(int signo);
 void sigkill_default(int signo);
 void sigsegv_default(int signo);
 void sigterm_default(int signo);
+
+scret_t sys_kill(struct syscall_args *scargs);
+scret_t sys_sigqueue(struct syscall_args *scargs);
+scret_t sys_sigwaitinfo(struct syscall_args *scargs);
+#else
+int kill(pid_t pid, int signo);
+int sigqueue(pid_t pid, int signo, const union sigval value);
+int sigwaitinfo(const sigset_t *set, siginfo_t *info);
 #endif  /* _KERNEL */
 #endif  /* !_SYS_SIGNAL_H_ */
@@ -68,6 +68,12 @@
 #define SYS_connect 27
 #define SYS_setsockopt 28
 #define SYS_disk    29
+#define SYS_getrandom 30
+#define SYS_kill    31
+#define SYS_sigqueue 32
+#define SYS_sigwaitinfo 33
+#define SYS_getrlimit 34
+#define SYS_setrlimit 35
 
 #if defined(_KERNEL)
 /* Syscall return value and arg type */
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef _SYS_TRACE_H_
+#define _SYS_TRACE_H_
+
+/*
+ * Tracepoint event IDs
+ *
+ * Arguments recorded for each event:
+ *
+ * TRACE_SCHED_SWITCH:  next pid, next priority
+ * TRACE_SYSCALL_ENTER: syscall number, arg0, arg1
+ * TRACE_SYSCALL_EXIT:  syscall number, return value
+ * TRACE_PAGEFAULT:     fault address, faulting ip, error code
+ * TRACE_DISK_IO:       disk ID, block, (length << 1) | write
+ * TRACE_IRQ:           vector, times fired
+ */
+#define TRACE_SCHED_SWITCH  0   /* Context switch */
+#define TRACE_SYSCALL_ENTER 1   /* Syscall entry */
+#define TRACE_SYSCALL_EXIT  2   /* Syscall return */
+#define TRACE_PAGEFAULT     3   /* Page fault */
+#define TRACE_DISK_IO       4   /* Disk read/write */
+#define TRACE_IRQ           5   /* Hardware interrupt */
+#define TRACE_NEVENT        6   /* Number of event IDs */
+
+#if !defined(__ASSEMBLER__)
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/cdefs.h>
+
+#define TRACE_NARG 3
+
+/*
+ * Binary trace record, these are read back in
+ * bulk from '/ctl/trace/buf'
+ *
+ * @tsc: Timestamp counter value at time of event
+ * @pid: PID of the thread running at time of event
+ * @cpu: Logical ID of the processor the event fired on
+ * @event: Event ID (see TRACE_*)
+ * @arg: Event specific arguments
+ */
+struct trace_rec {
+    uint64_t tsc;
+    uint32_t pid;
+    uint16_t cpu;
+    uint16_t event;
+    uint64_t arg[TRACE_NARG];
+};
+
+#if defined(_KERNEL)
+extern volatile uint32_t g_trace_mask;
+
+void trace_emit(uint16_t event, uint64_t a0, uint64_t a1, uint64_t a2);
+void trace_init(void);
+
+/*
+ * Fire a static tracepoint. The enable mask is
+ * all that is touched while an event is disabled,
+ * keeping tracepoints cheap enough to leave in
+ * hot paths.
+ */
+#define TRACE(EVENT, A0, A1, A2)                           \
+    do {                                                   \
+        if (__unlikely(ISSET(g_trace_mask, BIT(EVENT)))) { \
+            trace_emit((EVENT), (A0), (A1), (A2));         \
+        }                                                  \
+    } while (0)
+
+#endif  /* _KERNEL */
+#endif  /* !__ASSEMBLER__ */
+#endif  /* !_SYS_TRACE_H_ */
@@ -45,4 +45,34 @@ struct vm_stat {
     size_t mem_total;
 };
 
+#define DYNALLOC_SYMLEN 48
+
+/*
+ * Kernel heap usage of a single call site, read
+ * back from '/ctl/vm/dynalloc' when the kernel is
+ * built with DYNALLOC_PROF.
+ *
+ * @site: Address dynalloc() was called from
+ * @cur: Bytes currently allocated
+ * @peak: Most bytes ever allocated at once
+ * @total: Bytes allocated over all time
+ * @nalloc: Number of allocations
+ * @nfree: Number of frees
+ * @off: Offset of `site' into `sym'
+ * @sym: Symbol `site' is in
+ *
+ * XXX: `peak' is kept per processor and summed, which
+ *      makes it an upper bound.
+ */
+struct dynalloc_site {
+    uint64_t site;
+    uint64_t cur;
+    uint64_t peak;
+    uint64_t total;
+    uint64_t nalloc;
+    uint64_t nfree;
+    uint32_t off;
+    char sym[DYNALLOC_SYMLEN];
+};
+
 #endif  /* !_VM_STAT_H_ */
@@ -36,5 +36,6 @@
 
 int vm_map(struct vas vas, vaddr_t va, paddr_t pa, vm_prot_t prot, size_t count);
 int vm_unmap(struct vas vas, vaddr_t va, size_t count);
+int vm_set_cache(struct vas vas, vaddr_t va, int type, size_t count);
 
 #endif  /* !_VM_MAP_H_ */
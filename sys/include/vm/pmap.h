@@ -42,6 +42,7 @@
 /* Caching types */
 #define VM_CACHE_UC 0x00000U /* Uncachable */
 #define VM_CACHE_WT 0x00001U /* Write-through */
+#define VM_CACHE_WC 0x00002U /* Write-combining */
 
 typedef uint32_t vm_prot_t;
 
@@ -81,6 +82,12 @@ int pmap_unmap(struct vas vas, vaddr_t va);
  */
 bool pmap_is_clean(struct vas vas, vaddr_t va);
 
+/*
+ * Returns true if the page is present (safe to read
+ * without faulting), otherwise returns false.
+ */
+bool pmap_is_mapped(struct vas vas, vaddr_t va);
+
 /*
  * Marks a page as clean (unmodified)
  */
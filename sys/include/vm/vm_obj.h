@@ -49,7 +49,7 @@ struct vm_object {
 };
 
 int vm_obj_init(struct vm_object *obp, const struct vm_pagerops *pgops, int refs);
-void vm_obj_release(struct vm_object *obp);
+int vm_obj_release(struct vm_object *obp);
 
 /* Object tree stuff */
 int vm_pagecmp(const struct vm_page *a, const struct vm_page *b);
@@ -60,6 +60,8 @@ struct vm_page {
 
 struct vm_page *vm_pagelookup(struct vm_object *obj, off_t off);
 struct vm_page *vm_pagealloc(struct vm_object *obj, int flags);
+struct vm_page *vm_pagealloc_contig(struct vm_object *obj, size_t count,
+    int flags);
 void vm_pagefree(struct vm_object *obj, struct vm_page *pg, int flags);
 
 #endif  /* !_VM_PAGE_H_ */
@@ -30,47 +30,305 @@
 #include <sys/driver.h>
 #include <sys/proc.h>
 #include <sys/cdefs.h>
+#include <sys/errno.h>
+#include <sys/param.h>
 #include <sys/syslog.h>
 #include <sys/panic.h>
+#include <sys/sched.h>
+#include <sys/spinlock.h>
+#include <fs/ctlfs.h>
 #include <dev/timer.h>
 #include <machine/sync.h>
+#include <machine/cpu.h>
+#include <string.h>
+
+#define pr_trace(fmt, ...) kprintf("driver: " fmt, ##__VA_ARGS__)
+#define pr_error(...) pr_trace(__VA_ARGS__)
+
+/* Max drivers recorded in the boot timeline */
+#define DRIVER_MAX 64
+
+#define FOREACH_DRIVER(DP, START, END)          \
+    for ((DP) = (const void *)(START);          \
+         (uintptr_t)(DP) < (uintptr_t)(END); ++(DP))
+
+static struct ctlops timeline_ctl;
+
+static struct driver_time timeline[DRIVER_MAX];
+static size_t ntimeline = 0;
+static size_t nrunning = 0;
+static struct spinlock driver_lock = {0};
 
 /*
- * Initialize early drivers
+ * Returns the time since boot in microseconds,
+ * or zero if there is no timer yet.
+ */
+static uint64_t
+driver_usec(void)
+{
+    struct timer tmr;
+
+    if (req_timer(TIMER_GP, &tmr) != TMRR_SUCCESS) {
+        return 0;
+    }
+    if (tmr.get_time_usec == NULL) {
+        return 0;
+    }
+
+    return tmr.get_time_usec();
+}
+
+/*
+ * Look up an early or deferred driver by name.
  *
- * XXX: This should *NOT* be called directly,
- *      use DRIVERS_SCHED() instead.
+ * Returns NULL if no such driver exists.
  */
-void
-__driver_init_td(void)
+static const struct driver *
+driver_lookup(const char *name)
 {
     const struct driver *dp;
-    struct driver_var *var;
-    struct proc *td;
-    uintptr_t start, end;
 
-    td = this_td();
-    start = (uintptr_t)__driversd_init_start;
-    end = (uintptr_t)__driversd_init_end;
+    FOREACH_DRIVER(dp, __drivers_init_start, __drivers_init_end) {
+        if (strcmp(dp->name, name) == 0)
+            return dp;
+    }
 
-    for (dp = (void *)start; (uintptr_t)dp < end; ++dp) {
-        var = dp->data;
+    FOREACH_DRIVER(dp, __driversd_init_start, __driversd_init_end) {
+        if (strcmp(dp->name, name) == 0)
+            return dp;
+    }
+
+    return NULL;
+}
 
-        /*
-         * Check the blacklist to see if this driver
-         * is marked to be ignored. If so, just continue
-         * to the next.
-         */
+/*
+ * Returns true if every dependency of a driver has
+ * finished starting. Dependencies that are unknown
+ * or blacklisted never start and are ignored.
+ *
+ * XXX: Must be called with `driver_lock' acquired.
+ */
+static bool
+driver_deps_done(const struct driver *dp)
+{
+    const struct driver *dep;
+
+    if (dp->deps == NULL) {
+        return true;
+    }
+
+    for (const char **namep = dp->deps; *namep != NULL; ++namep) {
+        dep = driver_lookup(*namep);
+        if (dep == NULL || driver_blacklist_check(dep->name)) {
+            continue;
+        }
+        if (dep->data->deferred) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Claim the next deferred driver that is ready
+ * to be started.
+ *
+ * @dpp: Claimed driver is written here
+ *
+ * Returns zero on success, -EAGAIN if drivers are
+ * left but none are ready yet, and -ENOENT once
+ * every driver has been started.
+ */
+static int
+driver_claim(const struct driver **dpp)
+{
+    const struct driver *dp, *pending = NULL;
+    struct driver_var *var;
+
+    spinlock_acquire(&driver_lock);
+    FOREACH_DRIVER(dp, __driversd_init_start, __driversd_init_end) {
+        var = dp->data;
+        if (var->started || !var->deferred) {
+            continue;
+        }
         if (driver_blacklist_check(dp->name)) {
             continue;
         }
 
-        if (var->deferred) {
-            dp->init();
-            var->deferred = 0;
+        if (pending == NULL) {
+            pending = dp;
+        }
+        if (!driver_deps_done(dp)) {
+            continue;
+        }
+
+        var->started = 1;
+        ++nrunning;
+        spinlock_release(&driver_lock);
+        *dpp = dp;
+        return 0;
+    }
+
+    if (pending == NULL) {
+        spinlock_release(&driver_lock);
+        return -ENOENT;
+    }
+
+    /*
+     * Nothing is ready and nothing is running that could
+     * make something ready, the dependencies must form a
+     * cycle. Break it rather than waiting forever.
+     */
+    if (nrunning == 0) {
+        pr_error("dependency cycle at %s\n", pending->name);
+        pending->data->started = 1;
+        ++nrunning;
+        spinlock_release(&driver_lock);
+        *dpp = pending;
+        return 0;
+    }
+
+    spinlock_release(&driver_lock);
+    return -EAGAIN;
+}
+
+/*
+ * Start deferred drivers until there are none
+ * left, then exit.
+ */
+static void
+driver_worker(void)
+{
+    const struct driver *dp;
+    struct proc *td;
+    int error;
+
+    td = this_td();
+    for (;;) {
+        error = driver_claim(&dp);
+        if (error == -ENOENT) {
+            break;
+        }
+        if (error == -EAGAIN) {
+            sched_yield();
+            continue;
         }
+
+        driver_run(dp);
+        spinlock_acquire(&driver_lock);
+        dp->data->deferred = 0;
+        --nrunning;
+        spinlock_release(&driver_lock);
     }
 
     exit1(td, 0);
     __builtin_unreachable();
 }
+
+/*
+ * Run the init routine of a driver and record
+ * it in the boot timeline.
+ *
+ * @dp: Driver to start
+ *
+ * Returns the value returned by init.
+ */
+int
+driver_run(const struct driver *dp)
+{
+    struct driver_time *dtp = NULL;
+    struct cpu_info *ci;
+    int status;
+
+    spinlock_acquire(&driver_lock);
+    if (ntimeline < DRIVER_MAX) {
+        dtp = &timeline[ntimeline++];
+    }
+    spinlock_release(&driver_lock);
+
+    if (dtp != NULL) {
+        ci = this_cpu();
+        memcpy(dtp->name, dp->name, MIN(strlen(dp->name), DRIVER_NAMELEN - 1));
+        dtp->cpu = (ci != NULL) ? ci->id : 0;
+        dtp->deferred = dp->data->deferred;
+        dtp->start_usec = driver_usec();
+    }
+
+    status = dp->init();
+    if (dtp != NULL) {
+        dtp->status = status;
+        dtp->end_usec = driver_usec();
+    }
+
+    return status;
+}
+
+/*
+ * Read the boot timeline, one entry per driver
+ * starting at the file offset. Drivers that are
+ * still starting have an `end_usec' of zero.
+ */
+static int
+timeline_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct driver_time *dest = sio->buf;
+    size_t idx, max, n = 0;
+
+    idx = sio->offset / sizeof(struct driver_time);
+    max = sio->len / sizeof(struct driver_time);
+
+    spinlock_acquire(&driver_lock);
+    while (idx < ntimeline && n < max) {
+        dest[n++] = timeline[idx++];
+    }
+
+    spinlock_release(&driver_lock);
+    return n * sizeof(struct driver_time);
+}
+
+void
+driver_timeline_init(void)
+{
+    char devname[] = "boot";
+    struct ctlfs_dev ctl;
+
+    /* Register '/ctl/boot/timeline' */
+    ctl.mode = 0444;
+    ctlfs_create_node(devname, &ctl);
+    ctl.devname = devname;
+    ctl.ops = &timeline_ctl;
+    ctlfs_create_entry("timeline", &ctl);
+}
+
+/*
+ * Start deferred drivers concurrently, one worker
+ * per processor.
+ *
+ * XXX: This should *NOT* be called directly,
+ *      use DRIVERS_SCHED() instead.
+ */
+void
+__driver_init_td(void)
+{
+    const struct driver *dp;
+    size_t ndeferred = 0, nworkers;
+
+    FOREACH_DRIVER(dp, __driversd_init_start, __driversd_init_end) {
+        ++ndeferred;
+    }
+
+    /* This thread is a worker too */
+    nworkers = MIN(cpu_count(), ndeferred);
+    for (size_t i = 1; i < nworkers; ++i) {
+        spawn(&g_proc0, driver_worker, NULL, 0, NULL);
+    }
+
+    driver_worker();
+    __builtin_unreachable();
+}
+
+static struct ctlops timeline_ctl = {
+    .read = timeline_read,
+    .write = NULL
+};
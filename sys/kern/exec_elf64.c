@@ -37,7 +37,6 @@
 #include <sys/errno.h>
 #include <vm/pmap.h>
 #include <vm/physmem.h>
-#include <vm/dynalloc.h>
 #include <vm/vm.h>
 #include <vm/map.h>
 #include <string.h>
@@ -46,100 +45,33 @@
 #define pr_trace(fmt, ...) kprintf("elf64: " fmt, ##__VA_ARGS__)
 #define pr_error(...) pr_trace(__VA_ARGS__)
 
-#define PHDR(HDRP, IDX) \
-    (void *)((uintptr_t)HDRP + (HDRP)->e_phoff + (HDRP->e_phentsize * IDX))
-
-#define SHDR(HDRP, IDX) \
-    (void *)((uintptr_t)HDRP + (HDRP)->e_shoff + (HDRP->e_shentsize * IDX))
-
-struct elf_file {
-    char *data;
-    size_t size;
-};
-
-static int
-elf_parse_shdrs(Elf64_Ehdr *eh)
-{
-    Elf64_Shdr *shp;
-    uint32_t nshdr;
-
-    if (eh == NULL) {
-        return -EINVAL;
-    }
-
-    nshdr = eh->e_shnum;
-    for (uint32_t i = 0; i < nshdr; ++i) {
-        shp = SHDR(eh, i);
-
-        /* Drop null entries */
-        if (shp->sh_type == SHT_NULL) {
-            continue;
-        }
-
-        switch (shp->sh_type) {
-        case SHT_NOBITS:
-            memset((void *)shp->sh_addr, 0x0, shp->sh_size);
-            break;
-        }
-    }
-
-    return 0;
-}
-
 /*
- * Load the file and give back an "elf_file"
- * structure.
+ * Read a range of an executable into a kernel buffer.
+ *
+ * @vp: Vnode of the executable.
+ * @buf: Destination buffer.
+ * @off: File offset to read from.
+ * @len: Number of bytes to read.
+ *
+ * Returns 0 on success, -ENOEXEC on a short read.
  */
 static int
-elf_get_file(const char *pathname, struct elf_file *res)
+elf_read(struct vnode *vp, void *buf, off_t off, size_t len)
 {
-    struct vnode *vp = NULL;
-    struct nameidata nd;
-    struct vattr vattr;
-    struct vop_getattr_args getattr_args;
-    struct sio_txn read_txn;
-    int status = 0;
-
-    nd.path = pathname;
-    nd.flags = 0;
+    struct sio_txn sio;
+    int ret;
 
-    if (res == NULL)
-        return -EINVAL;
-    if ((status = namei(&nd)) != 0)
-        return status;
-
-    vp = nd.vp;
-
-    getattr_args.res = &vattr;
-    getattr_args.vp = vp;
-    status = vfs_vop_getattr(&getattr_args);
-    if (status != 0)
-        goto done;
+    if (len == 0)
+        return 0;
 
-    /* Can we use the size field? */
-    if (vattr.size == VNOVAL) {
-        status = -EIO;
-        goto done;
-    }
+    sio.buf = buf;
+    sio.offset = off;
+    sio.len = len;
+    ret = vfs_vop_read(vp, &sio);
+    if (ret < 0)
+        return ret;
 
-    res->size = vattr.size;
-    res->data = dynalloc(sizeof(char) * res->size);
-    if (res->data == NULL) {
-        status = -ENOMEM;
-        goto done;
-    }
-
-    /* Read data into our buffer */
-    read_txn.buf = res->data;
-    read_txn.len = res->size;
-    read_txn.offset = 0;
-    vfs_vop_read(vp, &read_txn);
-
-done:
-    if (vp != NULL) {
-        vfs_release_vnode(nd.vp);
-    }
-    return status;
+    return ((size_t)ret != len) ? -ENOEXEC : 0;
 }
 
 /*
@@ -199,29 +131,49 @@ elf_unload(struct proc *td, struct exec_prog *prog)
     }
 }
 
+/*
+ * Load an ELF executable into the address space of `td'.
+ *
+ * Only the ELF and program headers are read up front; each
+ * PT_LOAD segment is then read straight from the file into
+ * its freshly allocated frames instead of staging the whole
+ * file in a kernel buffer first.
+ */
 int
 elf64_load(const char *pathname, struct proc *td, struct exec_prog *prog)
 {
     vm_prot_t prot = (PROT_READ | PROT_USER);
-    Elf64_Ehdr *hdr;
-    Elf64_Phdr *phdr;
+    Elf64_Ehdr hdr;
+    Elf64_Phdr phdrs[MAX_PHDRS], *phdr;
+    struct nameidata nd;
     paddr_t physmem;
     vaddr_t start, end;
     off_t misalign;
-    void *tmp;
+    char *dest;
     size_t page_count, map_len;
-    struct elf_file file;
     struct pcb *pcbp;
     struct exec_range loadmap[MAX_PHDRS];
     struct auxval *auxvalp;
     size_t loadmap_idx = 0;
     int status = 0;
 
-    if ((status = elf_get_file(pathname, &file)) != 0)
+    nd.path = pathname;
+    nd.flags = 0;
+    if ((status = namei(&nd)) != 0)
         return status;
 
-    hdr = (Elf64_Ehdr *)file.data;
-    if ((status = elf64_verify(hdr)) != 0)
+    if ((status = elf_read(nd.vp, &hdr, 0, sizeof(hdr))) != 0)
+        goto done;
+    if ((status = elf64_verify(&hdr)) != 0)
+        goto done;
+    if (hdr.e_phentsize != sizeof(Elf64_Phdr)) {
+        status = -ENOEXEC;
+        goto done;
+    }
+
+    status = elf_read(nd.vp, phdrs, hdr.e_phoff,
+        hdr.e_phnum * sizeof(Elf64_Phdr));
+    if (status != 0)
         goto done;
 
     memset(loadmap, 0, sizeof(loadmap));
@@ -230,14 +182,18 @@ elf64_load(const char *pathname, struct proc *td, struct exec_prog *prog)
     end = 0;
 
     /* Load program headers */
-    for (size_t i = 0; i < hdr->e_phnum; ++i) {
-        phdr = PHDR(hdr, i);
+    for (size_t i = 0; i < hdr.e_phnum; ++i) {
+        phdr = &phdrs[i];
         switch (phdr->p_type) {
         case PT_LOAD:
             if (ISSET(phdr->p_flags, PF_W))
                 prot |= PROT_WRITE;
             if (ISSET(phdr->p_flags, PF_X))
                 prot |= PROT_EXEC;
+            if (phdr->p_filesz > phdr->p_memsz) {
+                status = -ENOEXEC;
+                break;
+            }
 
             misalign = phdr->p_vaddr & (DEFAULT_PAGESIZE - 1);
             map_len = ALIGN_UP(phdr->p_memsz + misalign, DEFAULT_PAGESIZE);
@@ -255,35 +211,50 @@ elf64_load(const char *pathname, struct proc *td, struct exec_prog *prog)
                 prot, map_len);
 
             if (status != 0) {
+                vm_free_frame(physmem, page_count);
                 break;
             }
 
-            tmp = (void *)((uintptr_t)hdr + phdr->p_offset);
-            memcpy(PHYS_TO_VIRT(physmem), tmp, phdr->p_filesz);
-
             loadmap[loadmap_idx].start = physmem;
             loadmap[loadmap_idx].end = physmem + map_len;
             loadmap[loadmap_idx].vbase = phdr->p_vaddr;
+            ++loadmap_idx;
+
+            /*
+             * Read the file backed part of the segment right
+             * into place and zero the rest (including .bss).
+             */
+            dest = PHYS_TO_VIRT(physmem);
+            memset(dest, 0, misalign);
+            status = elf_read(nd.vp, dest + misalign, phdr->p_offset,
+                phdr->p_filesz);
+            if (status != 0) {
+                break;
+            }
+
+            memset(dest + misalign + phdr->p_filesz, 0,
+                map_len - misalign - phdr->p_filesz);
 
             /* Get start/end addresses */
             if (start == (vaddr_t)-1)
-                start = loadmap[loadmap_idx].vbase;
+                start = phdr->p_vaddr;
             if (phdr->p_vaddr > end)
-                end = loadmap[loadmap_idx].vbase + phdr->p_memsz;
+                end = phdr->p_vaddr + phdr->p_memsz;
+        }
 
-            ++loadmap_idx;
+        if (status != 0) {
+            break;
         }
     }
 
-    elf_parse_shdrs(hdr);
     memcpy(prog->loadmap, loadmap, sizeof(loadmap));
     prog->start = start;
     prog->end = end;
 
     auxvalp = &prog->auxval;
-    auxvalp->at_entry = hdr->e_entry;
-    auxvalp->at_phent = hdr->e_phentsize;
-    auxvalp->at_phnum = hdr->e_phnum;
+    auxvalp->at_entry = hdr.e_entry;
+    auxvalp->at_phent = hdr.e_phentsize;
+    auxvalp->at_phnum = hdr.e_phnum;
 
     /* Did program header loading fail? */
     if (status != 0) {
@@ -292,6 +263,6 @@ elf64_load(const char *pathname, struct proc *td, struct exec_prog *prog)
     }
 
 done:
-    dynfree(file.data);
+    vfs_release_vnode(nd.vp);
     return status;
 }
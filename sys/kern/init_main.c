@@ -32,15 +32,20 @@
 #include <sys/sched.h>
 #include <sys/mount.h>
 #include <sys/proc.h>
+#include <sys/resource.h>
 #include <sys/exec.h>
 #include <sys/driver.h>
 #include <sys/panic.h>
 #include <sys/sysctl.h>
 #include <sys/systm.h>
+#include <sys/trace.h>
+#include <sys/prof.h>
+#include <sys/ktrace.h>
 #include <dev/acpi/uacpi.h>
 #include <dev/cons/cons.h>
 #include <dev/acpi/acpi.h>
 #include <machine/cpu.h>
+#include <machine/intr.h>
 #include <machine/cdefs.h>
 #include <vm/vm.h>
 #include <vm/stat.h>
@@ -108,6 +113,21 @@ main(void)
     /* Init vmstats */
     vm_stat_init();
 
+    /* Register tracepoint buffers */
+    trace_init();
+
+    /* Register the sampling profiler */
+    prof_init();
+
+    /* Register syscall accounting and ktrace */
+    ktrace_init();
+
+    /* Expose interrupt statistics */
+    intr_stat_init();
+
+    /* Expose resource limit counters */
+    rlimit_stat_init();
+
     /* Expose the console to devfs */
     cons_expose();
 
@@ -116,15 +136,18 @@ main(void)
     sched_init();
 
     memset(&g_proc0, 0, sizeof(g_proc0));
+    rlim_init(&g_proc0, &g_proc0);
     sysctl_clearstr(KERN_HOSTNAME);
 
     /* Startup pid 1 */
     spawn(&g_proc0, start_init, NULL, 0, &g_init);
+    reaper_init();
     md_inton();
 
     uacpi_init();
 
     /* Load all early drivers */
+    driver_timeline_init();
     DRIVERS_INIT();
 
     /* Only log to kmsg from here */
@@ -30,6 +30,7 @@
 #include <sys/atomic.h>
 #include <sys/errno.h>
 #include <sys/proc.h>
+#include <sys/resource.h>
 #include <sys/limits.h>
 #include <sys/fcntl.h>
 #include <sys/namei.h>
@@ -53,28 +54,43 @@ int
 fd_alloc(struct proc *td, struct filedesc **fd_out)
 {
     struct filedesc *fd;
+    uint64_t free;
+    size_t i;
+    int error;
 
     if (td == NULL) {
         td = this_td();
     }
 
-    /* Find free fd table entry */
-    for (size_t i = 3; i < PROC_MAX_FILEDES; ++i) {
-        if (td->fds[i] != NULL) {
-            /* In use */
+    /*
+     * Find a free fd table entry, a word of the
+     * bitmap covers 64 slots. Descriptors below 3
+     * are never handed out.
+     */
+    for (size_t w = 0; w < NELEM(td->fdmap); ++w) {
+        free = ~td->fdmap[w];
+        if (w == 0) {
+            free &= ~0x7ULL;
+        }
+        if (free == 0) {
             continue;
         }
 
-        fd = dynalloc(sizeof(struct filedesc));
-        memset(fd, 0, sizeof(struct filedesc));
+        i = (w * 64) + __builtin_ctzll(free);
+        if ((error = rlim_check(td, RLIMIT_NOFILE, i + 1)) < 0) {
+            return error;
+        }
 
+        fd = dynalloc(sizeof(struct filedesc));
         if (fd == NULL) {
             return -ENOMEM;
         }
 
+        memset(fd, 0, sizeof(struct filedesc));
         fd->refcnt = 1;
         fd->fdno = i;
         td->fds[i] = fd;
+        setbit((uint8_t *)td->fdmap, i);
 
         if (fd_out != NULL)
             *fd_out = fd;
@@ -99,7 +115,7 @@ fd_get(struct proc *td, unsigned int fdno)
         td = this_td();
     }
 
-    if (fdno > PROC_MAX_FILEDES) {
+    if (fdno >= PROC_MAX_FILEDES) {
         return NULL;
     }
 
@@ -138,10 +154,49 @@ fd_close(unsigned int fd)
      */
     vfs_release_vnode(filedes->vp);
     td->fds[fd] = NULL;
+    clrbit((uint8_t *)td->fdmap, fd);
     dynfree(filedes);
     return 0;
 }
 
+/*
+ * Close every open file descriptor of a process,
+ * only the slots set in its fd bitmap are visited.
+ *
+ * @td: Process to close descriptors of.
+ */
+void
+fd_closeall(struct proc *td)
+{
+    struct filedesc *filedes;
+    uint64_t word;
+    size_t fd;
+
+    for (size_t w = 0; w < NELEM(td->fdmap); ++w) {
+        word = td->fdmap[w];
+        while (word != 0) {
+            fd = (w * 64) + __builtin_ctzll(word);
+            word &= word - 1;
+
+            filedes = td->fds[fd];
+            td->fds[fd] = NULL;
+            if (filedes == NULL) {
+                continue;
+            }
+
+            /* Other threads may still hold a ref */
+            if (atomic_dec_int(&filedes->refcnt) > 0) {
+                continue;
+            }
+
+            vfs_release_vnode(filedes->vp);
+            dynfree(filedes);
+        }
+
+        td->fdmap[w] = 0;
+    }
+}
+
 /*
  * Read/write bytes to/from a file using a file
  * descriptor number.
@@ -161,7 +216,7 @@ fd_rw(unsigned int fd, void *buf, size_t count, uint8_t write)
     struct sio_txn sio;
     scret_t retval = 0;
 
-    if (fd > PROC_MAX_FILEDES) {
+    if (fd >= PROC_MAX_FILEDES) {
         return -EBADF;
     }
 
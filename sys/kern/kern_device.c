@@ -30,6 +30,7 @@
 #include <sys/device.h>
 #include <sys/types.h>
 #include <sys/errno.h>
+#include <sys/spinlock.h>
 #include <vm/dynalloc.h>
 #include <string.h>
 
@@ -42,6 +43,7 @@ struct device_major {
 };
 
 static struct device_major devtab[MAX_MAJOR];
+static struct spinlock devtab_lock = {0};
 
 /*
  * Allocate a device major.
@@ -52,11 +54,14 @@ devmajor_t
 dev_alloc_major(void)
 {
     static devmajor_t next = 1;
+    devmajor_t major = 0;
 
-    if (next > MAX_MAJOR)
-        return 0;
+    spinlock_acquire(&devtab_lock);
+    if (next <= MAX_MAJOR)
+        major = next++;
 
-    return next++;
+    spinlock_release(&devtab_lock);
+    return major;
 }
 
 /*
@@ -71,13 +76,15 @@ dev_alloc(devmajor_t major)
 {
     struct device_major *devmajor;
     size_t allocsize;
+    dev_t dev = 0;
 
     if (major >= MAX_MAJOR)
         return 0;
 
     devmajor = &devtab[major];
+    spinlock_acquire(&devtab_lock);
     if (devmajor->devsw_count >= MAX_MINOR)
-        return 0;
+        goto done;
 
     /*
      * Try to allocate a devsw table if needed.
@@ -91,12 +98,15 @@ dev_alloc(devmajor_t major)
         devmajor->devsw_tab = dynalloc(allocsize);
 
         if (devmajor->devsw_tab == NULL)
-            return 0;
+            goto done;
 
         memset(devmajor->devsw_tab, 0, allocsize);
     }
 
-    return ++devmajor->devsw_count;
+    dev = ++devmajor->devsw_count;
+done:
+    spinlock_release(&devtab_lock);
+    return dev;
 }
 
 /*
@@ -37,6 +37,7 @@
 #include <sys/spinlock.h>
 #include <sys/device.h>
 #include <sys/disk.h>
+#include <sys/trace.h>
 #include <vm/dynalloc.h>
 #include <assert.h>
 #include <string.h>
@@ -202,6 +203,7 @@ disk_rw(diskid_t id, blkoff_t blk, void *buf, size_t len, bool write)
     sio.buf = buf;
     sio.offset = blk * dp->bsize;
     sio.len = len;
+    TRACE(TRACE_DISK_IO, id, blk, (len << 1) | write);
 
     /* Handle writes */
     if (write) {
@@ -242,16 +244,6 @@ disk_add(const char *name, dev_t dev, const struct bdevsw *bdev, int flags)
         return -EINVAL;
     }
 
-    /* Disk queue must be initialized */
-    check_diskq();
-
-    /* There is a limit to how many can be added */
-    if (disk_count >= DISK_MAX) {
-        pr_error("disk_add: disk limit %d/%d reached\n",
-            disk_count, DISK_MAX);
-        return -EAGAIN;
-    }
-
     /* Is the disk name of correct length? */
     name_len = strlen(name);
     if (name_len >= sizeof(dp->name) - 1) {
@@ -271,7 +263,6 @@ disk_add(const char *name, dev_t dev, const struct bdevsw *bdev, int flags)
     dp->cookie = DISKQ_COOKIE;
     dp->bdev = bdev;
     dp->dev = dev;
-    dp->id = disk_count++;
     dp->bsize = DEFAULT_BSIZE;
 
     /*
@@ -283,8 +274,23 @@ disk_add(const char *name, dev_t dev, const struct bdevsw *bdev, int flags)
         panic("virtual block size not hw bsize aligned\n");
     }
 
-    /* Now we can add it to the queue */
+    /*
+     * Now we can add it to the queue, drivers may
+     * be adding disks from several processors.
+     */
     spinlock_acquire(&diskq_lock);
+    check_diskq();
+
+    /* There is a limit to how many can be added */
+    if (disk_count >= DISK_MAX) {
+        spinlock_release(&diskq_lock);
+        pr_error("disk_add: disk limit %d/%d reached\n",
+            disk_count, DISK_MAX);
+        dynfree(dp);
+        return -EAGAIN;
+    }
+
+    dp->id = disk_count++;
     TAILQ_INSERT_TAIL(&diskq, dp, link);
     spinlock_release(&diskq_lock);
     return 0;
@@ -39,6 +39,7 @@
 #include <vm/dynalloc.h>
 #include <vm/vm.h>
 #include <vm/map.h>
+#include <vm/pmap.h>
 #include <machine/pcb.h>
 #include <machine/cpu.h>
 
@@ -46,7 +47,16 @@
 #define pr_error(...) pr_trace(__VA_ARGS__)
 
 extern volatile size_t g_nthreads;
-extern struct proc g_init;
+extern struct proc *g_init;
+extern struct proc g_proc0;
+
+/*
+ * Dead processes waiting for their address space,
+ * stack and program pages to be torn down by the
+ * reaper thread.
+ */
+static TAILQ_HEAD(, proc) reapq = TAILQ_HEAD_INITIALIZER(reapq);
+static struct spinlock reapq_lock = {0};
 
 static void
 unload_td(struct proc *td)
@@ -57,7 +67,6 @@ unload_td(struct proc *td)
     struct pcb *pcbp;
     size_t len;
 
-    sched_detach(td);
     if (ISSET(td->flags, PROC_KTD)) {
         return;
     }
@@ -86,28 +95,42 @@ unload_td(struct proc *td)
     }
 }
 
-void
-proc_reap(struct proc *td)
+/*
+ * Returns true if nothing can still be running on
+ * the resources of a dead process.
+ *
+ * A thread that exits itself keeps idling on its
+ * kernel or system call stack until its processor
+ * switches away, wait for two switches so that it
+ * has fully left.
+ */
+static bool
+reap_ready(struct proc *td)
+{
+    uint64_t nswitch;
+
+    if (td->exit_cpu == NULL) {
+        return true;
+    }
+
+    nswitch = __atomic_load_n(&td->exit_cpu->nswitch, __ATOMIC_ACQUIRE);
+    return nswitch >= td->exit_nswitch + 2;
+}
+
+/*
+ * Tear down what is left of a dead process and
+ * free it unless its parent has yet to collect
+ * the exit status.
+ *
+ * @td: Process to tear down
+ */
+static void
+reap_td(struct proc *td)
 {
     struct pcb *pcbp;
-    struct filedesc *fdp;
     vaddr_t stack_va;
     paddr_t stack_pa;
-
-    cons_detach();
-
-    /* Clear out all fds */
-    for (size_t i = 4; i < PROC_MAX_FILEDES; ++i) {
-        fdp = td->fds[i];
-        if (fdp == NULL) {
-            continue;
-        }
-        if (fdp->refcnt == 1) {
-            vfs_release_vnode(fdp->vp);
-            dynfree(fdp);
-            fdp = NULL;
-        }
-    }
+    uint32_t flags;
 
     pcbp = &td->pcb;
     unload_td(td);
@@ -126,19 +149,101 @@ proc_reap(struct proc *td)
     }
 
     vm_free_frame(stack_pa, PROC_STACK_PAGES);
+    mmap_release(td);
     pmap_destroy_vas(pcbp->addrsp);
+    md_td_release(td);
+
+    /* Whoever is last out of us and waitpid() frees it */
+    flags = __atomic_fetch_or(&td->flags, PROC_REAPED, __ATOMIC_ACQ_REL);
+    if (!ISSET(flags, PROC_WAITED)) {
+        proc_free(td);
+    }
+}
+
+/*
+ * Returns the first process on the reaper queue that
+ * is ready to be torn down, must be called with
+ * `reapq_lock' held.
+ */
+static struct proc *
+reapq_next(void)
+{
+    struct proc *td;
+
+    TAILQ_FOREACH(td, &reapq, reap_link) {
+        if (reap_ready(td)) {
+            return td;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * The reaper thread, tears down dead processes off
+ * of the exit path so exiting stays cheap.
+ *
+ * The reaper sleeps until proc_reap() queues more
+ * work. Processes that are still in use stay queued
+ * and are retried on a later wakeup.
+ */
+static void
+reaper(void)
+{
+    struct proc *td;
+
+    for (;;) {
+        md_intoff();
+        spinlock_acquire(&reapq_lock);
+        while ((td = reapq_next()) == NULL) {
+            sched_sleep(&reapq, &reapq_lock);
+        }
+
+        TAILQ_REMOVE(&reapq, td, reap_link);
+        spinlock_release(&reapq_lock);
+        md_inton();
+        reap_td(td);
+    }
+}
+
+/*
+ * Queue a dead process up for the reaper.
+ *
+ * @td: Process to reap, must not be running.
+ */
+void
+proc_reap(struct proc *td)
+{
+    spinlock_acquire(&reapq_lock);
+    TAILQ_INSERT_TAIL(&reapq, td, reap_link);
+    sched_wakeup(&reapq);
+    spinlock_release(&reapq_lock);
+}
+
+/*
+ * Start up the reaper thread.
+ */
+void
+reaper_init(void)
+{
+    if (spawn(&g_proc0, reaper, NULL, 0, NULL) < 0) {
+        panic("could not start reaper\n");
+    }
 }
 
 /*
  * Kill a thread and deallocate its resources.
  *
+ * Only cheap work is done here, the exit status is
+ * published as soon as the descriptors are closed
+ * and the rest is left to the reaper.
+ *
  * @td: Thread to exit
  */
 int
 exit1(struct proc *td, int flags)
 {
-    struct proc *curtd, *procp;
-    struct proc *parent;
+    struct proc *curtd;
     struct cpu_info *ci;
     pid_t target_pid, curpid;
 
@@ -153,41 +258,32 @@ exit1(struct proc *td, int flags)
     curpid = curtd->pid;
 
     td->flags |= PROC_EXITING;
-    parent = td->parent;
 
     /* We have one less process in the system! */
     atomic_dec_64(&g_nthreads);
 
     /* Reassign children to init */
-    if (td->nleaves > 0) {
-        TAILQ_FOREACH(procp, &td->leafq, leaf_link) {
-            procp->parent = &g_init;
-        }
+    if (g_init != NULL) {
+        proc_reparent(td, g_init);
     }
 
     if (target_pid != curpid) {
-        proc_reap(td);
+        sched_detach(td);
     }
+    sched_unsleep(td);
+
+    cons_detach();
+    fd_closeall(td);
 
     if (td->data != NULL) {
         dynfree(td->data);
+        td->data = NULL;
     }
 
     /*
-     * Only free the process structure if we aren't
-     * being waited on, otherwise let it be so the
-     * parent can examine what's left of it.
-     */
-    if (!ISSET(td->flags, PROC_WAITED)) {
-        dynfree(td);
-    } else {
-        td->flags |= PROC_ZOMB;
-        td->flags &= ~PROC_WAITED;
-    }
-
-    /*
-     * If we are the thread exiting, reenter the scheduler
-     * and do not return.
+     * We cannot keep running on an address space that
+     * is about to be destroyed. We also stay on our
+     * stack until we switch away.
      */
     if (target_pid == curpid) {
         /*
@@ -199,10 +295,22 @@ exit1(struct proc *td, int flags)
         }
 
         ci->curtd = NULL;
-        if (parent->pid == 0)
-            sched_enter();
+        pmap_switch_vas(g_kvas);
+        td->exit_cpu = &ci->stat;
+        td->exit_nswitch = atomic_load_64(&ci->stat.nswitch);
+    }
+
+    /* The exit status is final, wake up the parent */
+    proc_set_zombie(td);
+
+    /* `td' may be freed past this point */
+    proc_reap(td);
 
-        parent->flags &= ~PROC_SLEEP;
+    /*
+     * If we are the thread exiting, reenter the scheduler
+     * and do not return.
+     */
+    if (target_pid == curpid) {
         sched_enter();
     }
 
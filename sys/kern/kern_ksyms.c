@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/ksyms.h>
+
+/*
+ * Look up the kernel symbol an address is in
+ *
+ * @addr: Address to look up
+ * @off: Offset of `addr' into the symbol is returned here
+ *
+ * Returns the symbol name, or NULL if there is no
+ * symbol table or the address is out of range.
+ */
+const char *
+ksyms_lookup(uintptr_t addr, off_t *off)
+{
+    uintptr_t prev_addr = 0;
+    const char *name = NULL;
+
+    if (g_ksym_table == NULL) {
+        return NULL;
+    }
+
+    for (size_t i = 0;;) {
+        if (g_ksym_table[i].addr > addr) {
+            *off = addr - prev_addr;
+            return name;
+        }
+
+        prev_addr = g_ksym_table[i].addr;
+        name = g_ksym_table[i].name;
+        if (g_ksym_table[i++].addr == (uint64_t)-1)
+            break;
+    }
+
+    return NULL;
+}
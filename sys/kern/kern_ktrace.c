@@ -0,0 +1,606 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Syscall accounting and tracing
+ *
+ * Every syscall is counted and its latency binned
+ * into a log2 histogram in a table owned by the
+ * current processor. Processes may additionally
+ * opt in to having each syscall's arguments and
+ * return value recorded into per-CPU rings.
+ *
+ * Records belong to the effective user of the
+ * traced process, a reader only sees and consumes
+ * its own records unless it is root.
+ */
+
+#include <sys/types.h>
+#include <sys/errno.h>
+#include <sys/param.h>
+#include <sys/atomic.h>
+#include <sys/syslog.h>
+#include <sys/limits.h>
+#include <sys/ktrace.h>
+#include <sys/proc.h>
+#include <fs/ctlfs.h>
+#include <machine/cpu.h>
+#include <vm/physmem.h>
+#include <vm/vm.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <machine/tsc.h>
+#endif  /* __x86_64__ */
+
+#define pr_trace(fmt, ...) kprintf("ktrace: " fmt, ##__VA_ARGS__)
+#define pr_error(...) pr_trace(__VA_ARGS__)
+
+#define KTR_BUF_PAGES 8
+#define KTR_NREC \
+    ((KTR_BUF_PAGES * DEFAULT_PAGESIZE) / sizeof(struct ktr_slot))
+
+/* Set in a slot's `seq' once a reader took the record */
+#define KTR_SEQ_TAKEN (1UL << 63)
+
+#define SC_STAT_PAGES \
+    (ALIGN_UP(sizeof(struct sc_stat) * SYSCALL_NSTAT, DEFAULT_PAGESIZE) \
+        / DEFAULT_PAGESIZE)
+
+/*
+ * Per-CPU syscall statistics, the in-kernel
+ * counterpart of `struct syscall_stat'.
+ */
+struct sc_stat {
+    volatile unsigned long calls;
+    volatile unsigned long cycles;
+    unsigned long max;
+    volatile unsigned long hist[SYSCALL_NHIST];
+};
+
+/*
+ * A slot in a ktrace ring
+ *
+ * @seq: Index of the record plus one once it is
+ *       fully written, zero while being written,
+ *       KTR_SEQ_TAKEN is or'd in once it is read
+ * @uid: Effective user of the traced process
+ * @rec: The record itself
+ */
+struct ktr_slot {
+    volatile unsigned long seq;
+    uid_t uid;
+    struct ktr_rec rec;
+};
+
+/*
+ * Per-CPU ktrace ring
+ *
+ * @head: Total number of records ever written
+ * @tail: Records before this one are all consumed
+ * @rec: Ring of KTR_NREC slots
+ */
+struct ktr_buf {
+    volatile unsigned long head;
+    unsigned long tail;
+    struct ktr_slot *rec;
+};
+
+static struct ctlops syscall_stat_ctl;
+static struct ctlops ktrace_ctl_ctl;
+static struct ctlops ktrace_buf_ctl;
+
+static struct sc_stat *scstat[CPU_MAX];
+static struct ktr_buf kbuf[CPU_MAX];
+__cacheline_aligned static struct spinlock ktrace_lock = {0};
+
+static inline uint64_t
+ktrace_stamp(void)
+{
+#if defined(__x86_64__)
+    return rdtsc();
+#else
+    return 0;
+#endif  /* __x86_64__ */
+}
+
+/*
+ * Returns the histogram bucket for a syscall
+ * that took `cycles' cycles.
+ */
+static inline size_t
+syscall_hist_bucket(uint64_t cycles)
+{
+    size_t log2;
+
+    log2 = 63 - __builtin_clzll(cycles | 1);
+    if (log2 < SYSCALL_HSHIFT) {
+        return 0;
+    }
+
+    return MIN(log2 - SYSCALL_HSHIFT, SYSCALL_NHIST - 1);
+}
+
+/*
+ * Get the statistics table of a processor,
+ * allocating it on first use.
+ */
+static struct sc_stat *
+syscall_stat_get(struct cpu_info *ci)
+{
+    struct sc_stat *scp;
+    uintptr_t pa;
+
+    if ((scp = scstat[ci->id]) != NULL) {
+        return scp;
+    }
+
+    spinlock_acquire(&ktrace_lock);
+    if (scstat[ci->id] == NULL) {
+        pa = vm_alloc_frame(SC_STAT_PAGES);
+        if (pa != 0) {
+            scp = PHYS_TO_VIRT(pa);
+            memset(scp, 0, SC_STAT_PAGES * DEFAULT_PAGESIZE);
+            scstat[ci->id] = scp;
+        }
+    }
+
+    scp = scstat[ci->id];
+    spinlock_release(&ktrace_lock);
+    return scp;
+}
+
+/*
+ * Account for a completed syscall.
+ *
+ * @scnum: Syscall number
+ * @cycles: TSC cycles spent in the syscall
+ *
+ * XXX: The thread may have been preempted and
+ *      migrated while in the syscall, so updates
+ *      are atomic even though the table is per-CPU.
+ */
+void
+syscall_account(uint16_t scnum, uint64_t cycles)
+{
+    struct sc_stat *scp;
+    struct cpu_info *ci;
+
+    if (scnum >= SYSCALL_NSTAT || (ci = this_cpu()) == NULL) {
+        return;
+    }
+    if ((scp = syscall_stat_get(ci)) == NULL) {
+        return;
+    }
+
+    scp = &scp[scnum];
+    atomic_inc_long(&scp->calls);
+    atomic_add_long_nv(&scp->cycles, cycles);
+    atomic_inc_long(&scp->hist[syscall_hist_bucket(cycles)]);
+    if (cycles > scp->max) {
+        scp->max = cycles;
+    }
+}
+
+/*
+ * Allocate ktrace rings for every processor that
+ * is online, rings that already exist are kept.
+ *
+ * XXX: Must be called with `ktrace_lock' acquired.
+ */
+static int
+ktrace_alloc_bufs(void)
+{
+    struct ktr_buf *kbp;
+    uintptr_t pa;
+
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
+        kbp = &kbuf[i];
+        if (kbp->rec != NULL || cpu_get(i) == NULL) {
+            continue;
+        }
+
+        pa = vm_alloc_frame(KTR_BUF_PAGES);
+        if (pa == 0) {
+            pr_error("failed to alloc ring for cpu%d\n", i);
+            return -ENOMEM;
+        }
+
+        kbp->head = 0;
+        kbp->tail = 0;
+        kbp->rec = PHYS_TO_VIRT(pa);
+        memset(kbp->rec, 0, KTR_BUF_PAGES * DEFAULT_PAGESIZE);
+    }
+
+    return 0;
+}
+
+/*
+ * Reserve the next slot in the ring of the
+ * current processor, the record is invisible
+ * to readers until ktrace_commit() is called.
+ *
+ * @scnum: Syscall number
+ * @type: KTR_CALL or KTR_RET
+ * @slotp: Returns the index of the slot
+ *
+ * Returns NULL if the ring does not exist.
+ */
+static struct ktr_slot *
+ktrace_reserve(uint16_t scnum, uint8_t type, unsigned long *slotp)
+{
+    struct ktr_buf *kbp;
+    struct ktr_slot *sp;
+    struct ktr_rec *rp;
+    struct cpu_info *ci;
+    struct proc *td;
+    unsigned long slot;
+
+    if ((ci = this_cpu()) == NULL) {
+        return NULL;
+    }
+
+    kbp = &kbuf[ci->id];
+    if (kbp->rec == NULL) {
+        return NULL;
+    }
+
+    slot = atomic_inc_long(&kbp->head) - 1;
+    sp = &kbp->rec[slot % KTR_NREC];
+    rp = &sp->rec;
+    td = ci->curtd;
+
+    /* Readers skip the slot until it is committed */
+    __atomic_store_n(&sp->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    sp->uid = (td != NULL) ? td->cred.euid : 0;
+    rp->tsc = ktrace_stamp();
+    rp->pid = (td != NULL) ? td->pid : 0;
+    rp->cpu = ci->id;
+    rp->type = type;
+    rp->scnum = scnum;
+    *slotp = slot;
+    return sp;
+}
+
+/*
+ * Publish a slot filled in after ktrace_reserve()
+ */
+static inline void
+ktrace_commit(struct ktr_slot *sp, unsigned long slot)
+{
+    __atomic_store_n(&sp->seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Record a syscall made by a traced process
+ *
+ * @scnum: Syscall number
+ * @scargs: Syscall arguments
+ */
+void
+ktrace_call(uint16_t scnum, const struct syscall_args *scargs)
+{
+    struct ktr_slot *sp;
+    struct ktr_rec *rp;
+    unsigned long slot;
+
+    if ((sp = ktrace_reserve(scnum, KTR_CALL, &slot)) == NULL) {
+        return;
+    }
+
+    rp = &sp->rec;
+    rp->arg[0] = scargs->arg0;
+    rp->arg[1] = scargs->arg1;
+    rp->arg[2] = scargs->arg2;
+    rp->arg[3] = scargs->arg3;
+    rp->arg[4] = scargs->arg4;
+    rp->arg[5] = scargs->arg5;
+    ktrace_commit(sp, slot);
+}
+
+/*
+ * Record a syscall return in a traced process
+ *
+ * @scnum: Syscall number
+ * @ret: Value returned to the process
+ * @cycles: TSC cycles spent in the syscall
+ */
+void
+ktrace_ret(uint16_t scnum, scret_t ret, uint64_t cycles)
+{
+    struct ktr_slot *sp;
+    struct ktr_rec *rp;
+    unsigned long slot;
+
+    if ((sp = ktrace_reserve(scnum, KTR_RET, &slot)) == NULL) {
+        return;
+    }
+
+    rp = &sp->rec;
+    rp->ret = ret;
+    rp->cycles = cycles;
+    ktrace_commit(sp, slot);
+}
+
+/*
+ * Read syscall statistics summed across all
+ * processors, one entry per syscall number
+ * starting at the file offset.
+ */
+static int
+syscall_stat_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct syscall_stat *dest = sio->buf;
+    struct sc_stat *scp;
+    size_t idx, max, n = 0;
+
+    idx = sio->offset / sizeof(struct syscall_stat);
+    max = sio->len / sizeof(struct syscall_stat);
+
+    for (; idx < MIN(MAX_SYSCALLS, SYSCALL_NSTAT) && n < max; ++idx) {
+        memset(&dest[n], 0, sizeof(dest[n]));
+
+        for (uint32_t i = 0; i < CPU_MAX; ++i) {
+            if ((scp = scstat[i]) == NULL) {
+                continue;
+            }
+
+            scp = &scp[idx];
+            dest[n].calls += scp->calls;
+            dest[n].cycles += scp->cycles;
+            dest[n].max = MAX(dest[n].max, scp->max);
+            for (size_t j = 0; j < SYSCALL_NHIST; ++j) {
+                dest[n].hist[j] += scp->hist[j];
+            }
+        }
+        ++n;
+    }
+
+    return n * sizeof(struct syscall_stat);
+}
+
+/*
+ * Any write to the statistics resets them.
+ */
+static int
+syscall_stat_write(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct sc_stat *scp;
+
+    spinlock_acquire(&ktrace_lock);
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
+        if ((scp = scstat[i]) != NULL) {
+            memset(scp, 0, sizeof(*scp) * SYSCALL_NSTAT);
+        }
+    }
+
+    spinlock_release(&ktrace_lock);
+    return sio->len;
+}
+
+/*
+ * Take record `idx' out of a ring if it is there
+ * in one piece and the reader may see it.
+ *
+ * @kbp: Ring to take the record from
+ * @idx: Index of the record
+ * @cred: Credentials of the reader
+ * @dest: Returns the record
+ *
+ * Returns 0 on success, -EAGAIN if it is still being
+ * written, -EACCES if it belongs to another user and
+ * -ESTALE if it has been overwritten or already taken.
+ */
+static int
+ktrace_take_rec(struct ktr_buf *kbp, unsigned long idx,
+    const struct ucred *cred, struct ktr_rec *dest)
+{
+    struct ktr_slot *sp;
+    unsigned long seq;
+
+    sp = &kbp->rec[idx % KTR_NREC];
+    seq = __atomic_load_n(&sp->seq, __ATOMIC_ACQUIRE);
+    if ((seq & ~KTR_SEQ_TAKEN) < idx + 1) {
+        return -EAGAIN;
+    }
+    if (seq != idx + 1) {
+        return -ESTALE;
+    }
+    if (cred->euid != 0 && sp->uid != cred->euid) {
+        return -EACCES;
+    }
+
+    /*
+     * Mark the record as taken, if the writer got to
+     * the slot while it was being copied the copy is
+     * torn and dropped.
+     */
+    *dest = sp->rec;
+    if (!__atomic_compare_exchange_n(&sp->seq, &seq, seq | KTR_SEQ_TAKEN,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return -ESTALE;
+    }
+
+    return 0;
+}
+
+/*
+ * Drain as many of the caller's records as fit in
+ * its buffer. Records that were overwritten before
+ * being read are dropped, a processor's ring is left
+ * alone at the first record that is still being
+ * written. Records of other users are left in place
+ * for them to read.
+ */
+static int
+ktrace_buf_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct ktr_buf *kbp;
+    struct ktr_rec *dest = sio->buf;
+    struct proc *td = this_td();
+    unsigned long head, idx;
+    size_t max, n = 0;
+    bool skipped;
+    int error;
+
+    if (td == NULL) {
+        return -ESRCH;
+    }
+
+    max = sio->len / sizeof(struct ktr_rec);
+    spinlock_acquire(&ktrace_lock);
+
+    for (uint32_t i = 0; i < CPU_MAX && n < max; ++i) {
+        kbp = &kbuf[i];
+        if (kbp->rec == NULL) {
+            continue;
+        }
+
+        head = kbp->head;
+        if ((head - kbp->tail) > KTR_NREC) {
+            kbp->tail = head - KTR_NREC;
+        }
+
+        skipped = false;
+        for (idx = kbp->tail; idx < head && n < max; ++idx) {
+            error = ktrace_take_rec(kbp, idx, &td->cred, &dest[n]);
+            if (error == -EAGAIN) {
+                break;
+            }
+            if (error == -EACCES) {
+                skipped = true;
+                continue;
+            }
+            if (error == 0) {
+                ++n;
+            }
+
+            /* Only move past records nobody needs anymore */
+            if (!skipped) {
+                kbp->tail = idx + 1;
+            }
+        }
+    }
+
+    spinlock_release(&ktrace_lock);
+    return n * sizeof(struct ktr_rec);
+}
+
+/*
+ * Start or stop tracing the caller or one
+ * of its children.
+ */
+static int
+ktrace_ctl_write(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct ktrace_ctl ctl;
+    struct proc *td, *self;
+    int error;
+
+    if (sio->len < sizeof(ctl)) {
+        return -EINVAL;
+    }
+
+    memcpy(&ctl, sio->buf, sizeof(ctl));
+    self = this_td();
+    if (ctl.pid == 0 || ctl.pid == self->pid) {
+        td = self;
+    } else if ((td = get_child(self, ctl.pid)) == NULL) {
+        return -ESRCH;
+    }
+
+    switch (ctl.op) {
+    case KTROP_SET:
+        spinlock_acquire(&ktrace_lock);
+        error = ktrace_alloc_bufs();
+        spinlock_release(&ktrace_lock);
+        if (error < 0) {
+            return error;
+        }
+
+        __atomic_fetch_or(&td->flags, PROC_KTRACE, __ATOMIC_SEQ_CST);
+        break;
+    case KTROP_CLEAR:
+        __atomic_fetch_and(&td->flags, ~PROC_KTRACE, __ATOMIC_SEQ_CST);
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return sizeof(ctl);
+}
+
+void
+ktrace_init(void)
+{
+    char sc_devname[] = "syscall";
+    char kt_devname[] = "ktrace";
+    struct ctlfs_dev ctl;
+
+    /*
+     * Register '/ctl/syscall/stat' for per-syscall
+     * statistics, writing to it resets them.
+     */
+    ctl.mode = 0644;
+    ctlfs_create_node(sc_devname, &ctl);
+    ctl.devname = sc_devname;
+    ctl.ops = &syscall_stat_ctl;
+    ctlfs_create_entry("stat", &ctl);
+
+    /*
+     * Register '/ctl/ktrace/ctl' to select traced
+     * processes and '/ctl/ktrace/buf' to read back
+     * their records.
+     */
+    ctl.mode = 0644;
+    ctlfs_create_node(kt_devname, &ctl);
+    ctl.devname = kt_devname;
+    ctl.ops = &ktrace_ctl_ctl;
+    ctlfs_create_entry("ctl", &ctl);
+
+    ctl.ops = &ktrace_buf_ctl;
+    ctlfs_create_entry("buf", &ctl);
+}
+
+static struct ctlops syscall_stat_ctl = {
+    .read = syscall_stat_read,
+    .write = syscall_stat_write
+};
+
+static struct ctlops ktrace_ctl_ctl = {
+    .read = NULL,
+    .write = ktrace_ctl_write
+};
+
+static struct ctlops ktrace_buf_ctl = {
+    .read = ktrace_buf_read,
+    .write = NULL
+};
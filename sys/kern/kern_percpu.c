@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/percpu.h>
+#include <vm/physmem.h>
+#include <vm/vm.h>
+#include <string.h>
+
+/*
+ * Allocate a per-CPU data area for a processor
+ * from the .data.percpu template. The area is page
+ * aligned so it never shares a cache line with the
+ * area of another processor.
+ *
+ * Returns NULL on failure or if there are no
+ * per-CPU variables.
+ */
+void *
+percpu_alloc(void)
+{
+    size_t len, npages;
+    uintptr_t pa;
+    void *base;
+
+    len = (uintptr_t)__percpu_end - (uintptr_t)__percpu_start;
+    if (len == 0) {
+        return NULL;
+    }
+
+    npages = ALIGN_UP(len, DEFAULT_PAGESIZE) / DEFAULT_PAGESIZE;
+    if ((pa = vm_alloc_frame(npages)) == 0) {
+        return NULL;
+    }
+
+    base = PHYS_TO_VIRT(pa);
+    memcpy(base, __percpu_start, len);
+    return base;
+}
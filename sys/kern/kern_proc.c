@@ -36,11 +36,37 @@
 #include <sys/syscall.h>
 #include <sys/filedesc.h>
 #include <sys/fcntl.h>
+#include <sys/spinlock.h>
+#include <sys/sched.h>
+#include <vm/dynalloc.h>
 #include <string.h>
 #include <crc32.h>
 
+/* Number of PID hash buckets, must be a power of two */
+#define PIDHASH_SIZE 256
+#define PIDHASH(pid) (&pidhash[(pid) & (PIDHASH_SIZE - 1)])
+
+/* Most free proc structures kept for reuse */
+#define PROC_CACHE_MAX 64
+
 extern volatile size_t g_nthreads;
 
+/*
+ * PID to proc hash, chained through `pid_next'.
+ * The process tree (leafq and parent links) is
+ * also protected by `proc_lock'.
+ */
+static struct proc *pidhash[PIDHASH_SIZE];
+static struct spinlock proc_lock = {0};
+
+/*
+ * Free proc structures, already zeroed so they
+ * are ready for use. Chained through `pid_next'.
+ */
+static struct proc *proc_cache = NULL;
+static size_t proc_ncached = 0;
+static struct spinlock proc_cache_lock = {0};
+
 pid_t
 getpid(void)
 {
@@ -114,22 +140,293 @@ proc_init(struct proc *td, struct proc *parent)
     }
 
     /* Add to parent leafq */
+    spinlock_acquire(&proc_lock);
+    if (!ISSET(parent->flags, PROC_LEAFQ)) {
+        TAILQ_INIT(&parent->leafq);
+        parent->flags |= PROC_LEAFQ;
+    }
+
     TAILQ_INSERT_TAIL(&parent->leafq, td, leaf_link);
     atomic_inc_int(&parent->nleaves);
-    atomic_inc_64(&g_nthreads);
     td->parent = parent;
+    spinlock_release(&proc_lock);
+
+    atomic_inc_64(&g_nthreads);
     td->exit_status = -1;
     td->cred = parent->cred;
+    rlim_init(td, parent);
 
     /* Initialize the mmap ledger */
     mlgdr->nbytes = 0;
     RBT_INIT(lgdr_entries, &mlgdr->hd);
     td->mlgdr = mlgdr;
     td->flags |= PROC_WAITED;
+    TAILQ_INIT(&td->ksigq);
     signals_init(td);
     return 0;
 }
 
+/*
+ * Allocate a zeroed proc structure, reusing a
+ * free one if there is any.
+ *
+ * Returns NULL on failure.
+ */
+struct proc *
+proc_alloc(void)
+{
+    struct proc *td;
+
+    spinlock_acquire(&proc_cache_lock);
+    if ((td = proc_cache) != NULL) {
+        proc_cache = td->pid_next;
+        td->pid_next = NULL;
+        --proc_ncached;
+    }
+    spinlock_release(&proc_cache_lock);
+
+    if (td != NULL) {
+        return td;
+    }
+
+    if ((td = dynalloc(sizeof(*td))) == NULL) {
+        return NULL;
+    }
+
+    memset(td, 0, sizeof(*td));
+    return td;
+}
+
+/*
+ * Unlink a process from the PID hash and its parent,
+ * then give its proc structure back.
+ *
+ * @td: Process to free
+ */
+void
+proc_free(struct proc *td)
+{
+    struct proc **tdp, *parent;
+
+    spinlock_acquire(&proc_lock);
+    for (tdp = PIDHASH(td->pid); *tdp != NULL; tdp = &(*tdp)->pid_next) {
+        if (*tdp == td) {
+            *tdp = td->pid_next;
+            break;
+        }
+    }
+
+    if ((parent = td->parent) != NULL) {
+        TAILQ_REMOVE(&parent->leafq, td, leaf_link);
+        atomic_dec_int(&parent->nleaves);
+    }
+    spinlock_release(&proc_lock);
+
+    if (td->mlgdr != NULL) {
+        dynfree(td->mlgdr);
+    }
+
+    /* Zero it here so allocation does not have to */
+    memset(td, 0, sizeof(*td));
+
+    spinlock_acquire(&proc_cache_lock);
+    if (proc_ncached < PROC_CACHE_MAX) {
+        td->pid_next = proc_cache;
+        proc_cache = td;
+        ++proc_ncached;
+        td = NULL;
+    }
+    spinlock_release(&proc_cache_lock);
+
+    if (td != NULL) {
+        dynfree(td);
+    }
+}
+
+/*
+ * Make a process visible to proc_lookup(), its
+ * PID must be set.
+ */
+void
+proc_hash(struct proc *td)
+{
+    struct proc **bucket;
+
+    spinlock_acquire(&proc_lock);
+    bucket = PIDHASH(td->pid);
+    td->pid_next = *bucket;
+    *bucket = td;
+    spinlock_release(&proc_lock);
+}
+
+/*
+ * Look up a process by PID.
+ *
+ * Returns NULL if there is no such process.
+ *
+ * XXX: The process is not referenced, callers must
+ *      know it cannot be freed under them (e.g. it is
+ *      their own child).
+ */
+struct proc *
+proc_lookup(pid_t pid)
+{
+    struct proc *td;
+
+    spinlock_acquire(&proc_lock);
+    td = *PIDHASH(pid);
+    while (td != NULL && td->pid != pid) {
+        td = td->pid_next;
+    }
+    spinlock_release(&proc_lock);
+    return td;
+}
+
+/*
+ * Look up a process by PID and return with `proc_lock'
+ * held, so the process cannot be freed until the caller
+ * is done with it and calls proc_unlock().
+ *
+ * Returns NULL if there is no such process, the lock is
+ * held either way.
+ */
+struct proc *
+proc_lookup_lock(pid_t pid)
+{
+    struct proc *td;
+
+    spinlock_acquire(&proc_lock);
+    td = *PIDHASH(pid);
+    while (td != NULL && td->pid != pid) {
+        td = td->pid_next;
+    }
+    return td;
+}
+
+/*
+ * Release `proc_lock' taken by proc_lookup_lock()
+ */
+void
+proc_unlock(void)
+{
+    spinlock_release(&proc_lock);
+}
+
+/*
+ * Count the live processes owned by a real
+ * user ID.
+ */
+size_t
+proc_count_uid(uid_t uid)
+{
+    struct proc *td;
+    size_t count = 0;
+
+    spinlock_acquire(&proc_lock);
+    for (size_t i = 0; i < PIDHASH_SIZE; ++i) {
+        td = pidhash[i];
+        while (td != NULL) {
+            if (td->cred.ruid == uid && !ISSET(td->flags, PROC_ZOMB))
+                ++count;
+            td = td->pid_next;
+        }
+    }
+    spinlock_release(&proc_lock);
+    return count;
+}
+
+/*
+ * Hand every child of a process to a new parent.
+ *
+ * The new parent never waits on them, so children
+ * are freed by the reaper once they are dead. Any
+ * that it already tore down are freed here.
+ *
+ * @td: Process whose children are moved
+ * @newparent: Their new parent
+ */
+void
+proc_reparent(struct proc *td, struct proc *newparent)
+{
+    TAILQ_HEAD(, proc) freeq = TAILQ_HEAD_INITIALIZER(freeq);
+    struct proc *child;
+    uint32_t flags;
+
+    if (td->nleaves == 0) {
+        return;
+    }
+
+    spinlock_acquire(&proc_lock);
+    if (!ISSET(newparent->flags, PROC_LEAFQ)) {
+        TAILQ_INIT(&newparent->leafq);
+        newparent->flags |= PROC_LEAFQ;
+    }
+
+    while ((child = TAILQ_FIRST(&td->leafq)) != NULL) {
+        TAILQ_REMOVE(&td->leafq, child, leaf_link);
+        TAILQ_INSERT_TAIL(&newparent->leafq, child, leaf_link);
+        child->parent = newparent;
+        atomic_inc_int(&newparent->nleaves);
+
+        /* Off the reaper queue if reaped, reuse the link */
+        flags = __atomic_fetch_and(&child->flags, ~PROC_WAITED,
+            __ATOMIC_ACQ_REL);
+        if (ISSET(flags, PROC_WAITED) && ISSET(flags, PROC_REAPED)) {
+            TAILQ_INSERT_TAIL(&freeq, child, reap_link);
+        }
+    }
+
+    td->nleaves = 0;
+    spinlock_release(&proc_lock);
+
+    while ((child = TAILQ_FIRST(&freeq)) != NULL) {
+        TAILQ_REMOVE(&freeq, child, reap_link);
+        proc_free(child);
+    }
+}
+
+/*
+ * Publish the exit status of a process and wake
+ * up its parent if it is waiting on a child.
+ *
+ * @td: Process that is done
+ */
+void
+proc_set_zombie(struct proc *td)
+{
+    struct proc *parent;
+
+    spinlock_acquire(&proc_lock);
+    __atomic_fetch_or(&td->flags, PROC_ZOMB, __ATOMIC_RELEASE);
+    if ((parent = td->parent) != NULL) {
+        sched_wakeup(&parent->leafq);
+    }
+    spinlock_release(&proc_lock);
+}
+
+/*
+ * Sleep until a child has exited, children wake
+ * their parent up on its leaf queue.
+ *
+ * @td: Current process
+ * @child: Child of `td' to wait on
+ */
+void
+proc_wait_zombie(struct proc *td, struct proc *child)
+{
+    uint32_t flags;
+
+    spinlock_acquire(&proc_lock);
+    for (;;) {
+        flags = __atomic_load_n(&child->flags, __ATOMIC_ACQUIRE);
+        if (ISSET(flags, PROC_ZOMB)) {
+            break;
+        }
+        sched_sleep(&td->leafq, &proc_lock);
+    }
+    spinlock_release(&proc_lock);
+}
+
 scret_t
 sys_getpid(struct syscall_args *scargs)
 {
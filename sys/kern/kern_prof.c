@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Sampling profiler
+ *
+ * While enabled, the scheduler timer is armed at the
+ * sample period instead of the scheduler quantum. Every
+ * tick records the interrupted PC and call chain into a
+ * ring owned by the current processor, and only ticks
+ * that complete a full quantum go on to reschedule.
+ */
+
+#include <sys/types.h>
+#include <sys/errno.h>
+#include <sys/param.h>
+#include <sys/atomic.h>
+#include <sys/syslog.h>
+#include <sys/limits.h>
+#include <sys/schedvar.h>
+#include <sys/ksyms.h>
+#include <sys/prof.h>
+#include <fs/ctlfs.h>
+#include <machine/cpu.h>
+#include <vm/physmem.h>
+#include <vm/vm.h>
+#include <string.h>
+
+#define pr_trace(fmt, ...) kprintf("prof: " fmt, ##__VA_ARGS__)
+#define pr_error(...) pr_trace(__VA_ARGS__)
+
+#define PROF_BUF_PAGES 16
+#define PROF_NSAMPLE \
+    ((PROF_BUF_PAGES * DEFAULT_PAGESIZE) / sizeof(struct prof_sample))
+
+/*
+ * Per-CPU sample ring
+ *
+ * @head: Total number of samples ever written
+ * @tail: Total number of samples consumed
+ * @elapsed: Microseconds since the last reschedule
+ * @samples: Ring of PROF_NSAMPLE samples
+ */
+struct prof_buf {
+    volatile unsigned long head;
+    unsigned long tail;
+    size_t elapsed;
+    struct prof_sample *samples;
+};
+
+static struct ctlops prof_ctl_ctl;
+static struct ctlops prof_samples_ctl;
+static struct ctlops prof_ksyms_ctl;
+
+/* Sample period in usec, zero if disabled */
+volatile size_t g_prof_usec = 0;
+
+static struct prof_buf pbuf[CPU_MAX];
+static uint32_t prof_hz = PROF_DEFAULT_HZ;
+__cacheline_aligned static struct spinlock prof_lock = {0};
+
+/*
+ * Allocate sample rings for every processor
+ * that is online.
+ *
+ * XXX: Must be called with `prof_lock' acquired.
+ */
+static int
+prof_alloc_bufs(void)
+{
+    struct prof_buf *pbp;
+    uintptr_t pa;
+
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
+        pbp = &pbuf[i];
+        if (pbp->samples != NULL || cpu_get(i) == NULL) {
+            continue;
+        }
+
+        pa = vm_alloc_frame(PROF_BUF_PAGES);
+        if (pa == 0) {
+            pr_error("failed to alloc ring for cpu%d\n", i);
+            return -ENOMEM;
+        }
+
+        pbp->head = 0;
+        pbp->tail = 0;
+        pbp->elapsed = 0;
+        pbp->samples = PHYS_TO_VIRT(pa);
+    }
+
+    return 0;
+}
+
+/*
+ * Called from the scheduler timer interrupt,
+ * takes a sample if the profiler is running.
+ *
+ * @tf: Trapframe of the interrupted context
+ *
+ * Returns true if this tick was for sampling
+ * only and the caller should not reschedule.
+ */
+bool
+prof_intr(struct trapframe *tf)
+{
+    struct prof_buf *pbp;
+    struct prof_sample *sp;
+    struct cpu_info *ci;
+    unsigned long slot;
+    size_t usec;
+
+    if ((usec = g_prof_usec) == 0) {
+        return false;
+    }
+
+    ci = this_cpu();
+    pbp = &pbuf[ci->id];
+    if (pbp->samples == NULL) {
+        return false;
+    }
+
+    slot = atomic_inc_long(&pbp->head) - 1;
+    sp = &pbp->samples[slot % PROF_NSAMPLE];
+    md_prof_capture(tf, sp);
+    sp->cpu = ci->id;
+
+    /* Reschedule once a full quantum went by */
+    pbp->elapsed += usec;
+    if (pbp->elapsed >= DEFAULT_TIMESLICE_USEC) {
+        pbp->elapsed = 0;
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Drain as many samples as fit in the caller's
+ * buffer. Samples that were overwritten before
+ * being read are dropped.
+ */
+static int
+prof_samples_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct prof_buf *pbp;
+    struct prof_sample *dest = sio->buf;
+    unsigned long head;
+    size_t max, n = 0;
+
+    max = sio->len / sizeof(struct prof_sample);
+    spinlock_acquire(&prof_lock);
+
+    for (uint32_t i = 0; i < CPU_MAX && n < max; ++i) {
+        pbp = &pbuf[i];
+        if (pbp->samples == NULL) {
+            continue;
+        }
+
+        head = pbp->head;
+        if ((head - pbp->tail) > PROF_NSAMPLE) {
+            pbp->tail = head - PROF_NSAMPLE;
+        }
+
+        while (pbp->tail < head && n < max) {
+            dest[n++] = pbp->samples[pbp->tail % PROF_NSAMPLE];
+            ++pbp->tail;
+        }
+    }
+
+    spinlock_release(&prof_lock);
+    return n * sizeof(struct prof_sample);
+}
+
+/*
+ * Read the kernel symbol table, one prof_ksym
+ * entry per symbol starting at the file offset.
+ */
+static int
+prof_ksyms_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct prof_ksym *dest = sio->buf;
+    const struct kernel_symbol *ksym;
+    size_t idx, max, n = 0;
+
+    if (g_ksym_table == NULL) {
+        return 0;
+    }
+
+    idx = sio->offset / sizeof(struct prof_ksym);
+    max = sio->len / sizeof(struct prof_ksym);
+
+    /* Skip to the symbol we are starting at */
+    for (size_t i = 0; i < idx; ++i) {
+        if (g_ksym_table[i].addr == (uint64_t)-1) {
+            return 0;
+        }
+    }
+
+    while (n < max) {
+        ksym = &g_ksym_table[idx++];
+        if (ksym->addr == (uint64_t)-1) {
+            break;
+        }
+
+        dest[n].addr = ksym->addr;
+        memset(dest[n].name, 0, PROF_SYMLEN);
+        memcpy(dest[n].name, ksym->name,
+            MIN(strlen(ksym->name), PROF_SYMLEN - 1));
+        ++n;
+    }
+
+    return n * sizeof(struct prof_ksym);
+}
+
+static int
+prof_ctl_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct prof_ctl ctl;
+
+    ctl.enable = g_prof_usec != 0;
+    ctl.hz = prof_hz;
+    if (sio->len > sizeof(ctl)) {
+        sio->len = sizeof(ctl);
+    }
+
+    memcpy(sio->buf, &ctl, sio->len);
+    return sio->len;
+}
+
+/*
+ * Start or stop the profiler, the new rate takes
+ * effect when each processor next arms its timer.
+ */
+static int
+prof_ctl_write(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct prof_ctl ctl;
+    int error;
+
+    if (sio->len < sizeof(ctl)) {
+        return -EINVAL;
+    }
+
+    memcpy(&ctl, sio->buf, sizeof(ctl));
+    if (ctl.hz == 0) {
+        ctl.hz = PROF_DEFAULT_HZ;
+    }
+    if (!IN_RANGE(ctl.hz, PROF_MIN_HZ, PROF_MAX_HZ)) {
+        return -EINVAL;
+    }
+
+    spinlock_acquire(&prof_lock);
+    if (ctl.enable == 0) {
+        g_prof_usec = 0;
+        spinlock_release(&prof_lock);
+        return sizeof(ctl);
+    }
+
+    if ((error = prof_alloc_bufs()) < 0) {
+        spinlock_release(&prof_lock);
+        return error;
+    }
+
+    prof_hz = ctl.hz;
+    g_prof_usec = 1000000 / prof_hz;
+    spinlock_release(&prof_lock);
+    return sizeof(ctl);
+}
+
+void
+prof_init(void)
+{
+    char devname[] = "prof";
+    struct ctlfs_dev ctl;
+
+    /*
+     * Register '/ctl/prof/ctl' to start and stop
+     * sampling, '/ctl/prof/samples' to read back
+     * samples and '/ctl/prof/ksyms' for symbolizing
+     * kernel addresses.
+     */
+    ctl.mode = 0644;
+    ctlfs_create_node(devname, &ctl);
+    ctl.devname = devname;
+    ctl.ops = &prof_ctl_ctl;
+    ctlfs_create_entry("ctl", &ctl);
+
+    ctl.ops = &prof_samples_ctl;
+    ctlfs_create_entry("samples", &ctl);
+
+    ctl.ops = &prof_ksyms_ctl;
+    ctlfs_create_entry("ksyms", &ctl);
+}
+
+static struct ctlops prof_ctl_ctl = {
+    .read = prof_ctl_read,
+    .write = prof_ctl_write
+};
+
+static struct ctlops prof_samples_ctl = {
+    .read = prof_samples_read,
+    .write = NULL
+};
+
+static struct ctlops prof_ksyms_ctl = {
+    .read = prof_ksyms_read,
+    .write = NULL
+};
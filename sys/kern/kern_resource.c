@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Per-process resource limits
+ *
+ * Limits are inherited from the parent on spawn and
+ * each refused operation bumps a counter so that
+ * runaway processes can be spotted.
+ */
+
+#include <sys/types.h>
+#include <sys/errno.h>
+#include <sys/param.h>
+#include <sys/atomic.h>
+#include <sys/resource.h>
+#include <sys/signal.h>
+#include <sys/systm.h>
+#include <sys/proc.h>
+#include <fs/ctlfs.h>
+#include <string.h>
+
+#define USEC_PER_SEC 1000000
+
+static struct ctlops rlimit_stat_ctl;
+static volatile uint64_t rlim_hits[RLIM_NLIMITS];
+
+/*
+ * Set the limits of a new process, these are copied
+ * from the parent unless it is the kernel.
+ *
+ * @td: New process.
+ * @parent: Its parent.
+ */
+void
+rlim_init(struct proc *td, struct proc *parent)
+{
+    if (parent->pid != 0) {
+        memcpy(td->rlim, parent->rlim, sizeof(td->rlim));
+        return;
+    }
+
+    for (int i = 0; i < RLIM_NLIMITS; ++i) {
+        td->rlim[i].rlim_cur = RLIM_INFINITY;
+        td->rlim[i].rlim_max = RLIM_INFINITY;
+    }
+
+    td->rlim[RLIMIT_NOFILE].rlim_cur = PROC_MAX_FILEDES;
+    td->rlim[RLIMIT_NOFILE].rlim_max = PROC_MAX_FILEDES;
+}
+
+/*
+ * Account a limit as hit and return the error
+ * for running out of the resource.
+ */
+static int
+rlim_hit(int resource)
+{
+    atomic_inc_64(&rlim_hits[resource]);
+    switch (resource) {
+    case RLIMIT_NOFILE:
+        return -EMFILE;
+    case RLIMIT_NPROC:
+        return -EAGAIN;
+    default:
+        return -ENOMEM;
+    }
+}
+
+/*
+ * Check a value against the soft limit of a
+ * resource.
+ *
+ * @td: Process to check.
+ * @resource: Resource (RLIMIT_*)
+ * @value: Amount of the resource wanted in total.
+ *
+ * Returns zero if within the limit, otherwise the
+ * limit is accounted as hit and a less than zero
+ * value is returned.
+ */
+int
+rlim_check(struct proc *td, int resource, rlim_t value)
+{
+    if (value <= td->rlim[resource].rlim_cur) {
+        return 0;
+    }
+
+    return rlim_hit(resource);
+}
+
+/*
+ * Like rlim_check() but for taking `inc' more of a
+ * resource when `used' is already taken, without
+ * the sum being able to wrap around.
+ *
+ * @td: Process to check.
+ * @resource: Resource (RLIMIT_*)
+ * @used: Amount of the resource already in use.
+ * @inc: Amount of the resource wanted on top.
+ */
+int
+rlim_check_inc(struct proc *td, int resource, rlim_t used, rlim_t inc)
+{
+    rlim_t limit = td->rlim[resource].rlim_cur;
+
+    if (used <= limit && inc <= limit - used) {
+        return 0;
+    }
+
+    return rlim_hit(resource);
+}
+
+/*
+ * Check if `td' may create another process under
+ * its real user ID. Processes are only counted if
+ * a limit is actually set.
+ */
+int
+rlim_check_nproc(struct proc *td)
+{
+    if (td->rlim[RLIMIT_NPROC].rlim_cur == RLIM_INFINITY) {
+        return 0;
+    }
+
+    return rlim_check(td, RLIMIT_NPROC, proc_count_uid(td->cred.ruid) + 1);
+}
+
+/*
+ * Charge CPU time to a process on a scheduler
+ * tick. SIGXCPU is sent once the soft limit is
+ * crossed and SIGKILL at the hard limit.
+ *
+ * @td: Process that was running.
+ * @usec: Microseconds to charge.
+ */
+void
+rlim_cputick(struct proc *td, uint32_t usec)
+{
+    const struct rlimit *rlim = &td->rlim[RLIMIT_CPU];
+    sigset_t set;
+    uint64_t secs;
+
+    td->cpu_usec += usec;
+    if (rlim->rlim_cur == RLIM_INFINITY) {
+        return;
+    }
+
+    secs = td->cpu_usec / USEC_PER_SEC;
+    if (secs < rlim->rlim_cur) {
+        return;
+    }
+
+    sigemptyset(&set);
+    if (secs >= rlim->rlim_max) {
+        sigaddset(&set, SIGKILL);
+    } else if (!ISSET(td->flags, PROC_XCPU)) {
+        td->flags |= PROC_XCPU;
+        sigaddset(&set, SIGXCPU);
+    } else {
+        return;
+    }
+
+    atomic_inc_64(&rlim_hits[RLIMIT_CPU]);
+    sendsig(td, &set);
+}
+
+/*
+ * arg0: Resource
+ * arg1: Limit (output)
+ */
+scret_t
+sys_getrlimit(struct syscall_args *scargs)
+{
+    struct rlimit *u_rlim = (void *)scargs->arg1;
+    int resource = scargs->arg0;
+    struct proc *td;
+
+    if (resource < 0 || resource >= RLIM_NLIMITS) {
+        return -EINVAL;
+    }
+
+    td = this_td();
+    return copyout(&td->rlim[resource], u_rlim, sizeof(*u_rlim));
+}
+
+/*
+ * arg0: Resource
+ * arg1: New limit
+ *
+ * Only root may raise a hard limit.
+ */
+scret_t
+sys_setrlimit(struct syscall_args *scargs)
+{
+    const struct rlimit *u_rlim = (void *)scargs->arg1;
+    int resource = scargs->arg0;
+    struct rlimit rlim;
+    struct proc *td;
+    int error;
+
+    if (resource < 0 || resource >= RLIM_NLIMITS) {
+        return -EINVAL;
+    }
+    if ((error = copyin(u_rlim, &rlim, sizeof(rlim))) < 0) {
+        return error;
+    }
+    if (rlim.rlim_cur > rlim.rlim_max) {
+        return -EINVAL;
+    }
+
+    td = this_td();
+    if (rlim.rlim_max > td->rlim[resource].rlim_max) {
+        if (td->cred.euid != 0)
+            return -EPERM;
+    }
+
+    td->rlim[resource] = rlim;
+    return 0;
+}
+
+static int
+rlimit_stat_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct rlimit_stat stat;
+    size_t len;
+
+    if (sio->offset >= sizeof(stat)) {
+        return 0;
+    }
+
+    for (int i = 0; i < RLIM_NLIMITS; ++i) {
+        stat.hits[i] = atomic_load_64(&rlim_hits[i]);
+    }
+
+    len = MIN(sio->len, sizeof(stat) - sio->offset);
+    memcpy(sio->buf, (char *)&stat + sio->offset, len);
+    return len;
+}
+
+void
+rlimit_stat_init(void)
+{
+    char devname[] = "rlimit";
+    struct ctlfs_dev ctl;
+
+    /*
+     * Register '/ctl/rlimit/stat' for the limit
+     * enforcement counters.
+     */
+    ctl.mode = 0444;
+    ctlfs_create_node(devname, &ctl);
+    ctl.devname = devname;
+    ctl.ops = &rlimit_stat_ctl;
+    ctlfs_create_entry("stat", &ctl);
+}
+
+static struct ctlops rlimit_stat_ctl = {
+    .read = rlimit_stat_read,
+    .write = NULL
+};
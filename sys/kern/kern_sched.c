@@ -34,6 +34,8 @@
 #include <sys/param.h>
 #include <sys/syslog.h>
 #include <sys/atomic.h>
+#include <sys/prof.h>
+#include <sys/resource.h>
 #include <dev/cons/cons.h>
 #include <machine/frame.h>
 #include <machine/cpu.h>
@@ -62,19 +64,34 @@ static struct sched_queue qlist[SCHED_NQUEUE];
  */
 __cacheline_aligned static struct spinlock tdq_lock = {0};
 
+/*
+ * Threads sleeping on a wait channel, see sched_sleep()
+ * and sched_wakeup(). Protected by `sleepq_lock'.
+ */
+static TAILQ_HEAD(, proc) sleepq = TAILQ_HEAD_INITIALIZER(sleepq);
+static struct spinlock sleepq_lock = {0};
+
 /*
  * Perform timer oneshot
+ *
+ * XXX: While the profiler is running, the timer
+ *      fires at the sample period instead.
  */
 void
 sched_oneshot(bool now)
 {
     struct timer timer;
     size_t usec = now ? SHORT_TIMESLICE_USEC : DEFAULT_TIMESLICE_USEC;
+    size_t prof_usec = g_prof_usec;
     tmrr_status_t tmr_status;
 
     tmr_status = req_timer(TIMER_SCHED, &timer);
     __assert(tmr_status == TMRR_SUCCESS);
 
+    if (prof_usec != 0 && prof_usec < usec) {
+        usec = prof_usec;
+    }
+
     timer.oneshot_us(usec);
 }
 
@@ -228,6 +245,7 @@ mi_sched_switch(struct proc *from)
         if (from->pid == 0)
             return;
 
+        rlim_cputick(from, DEFAULT_TIMESLICE_USEC);
         dispatch_signals(from);
         td_pri_update(from);
     }
@@ -260,18 +278,120 @@ sched_yield(void)
 
     td->rested = true;
 
-    /* FIXME: Hang yielding when waited on */
-    if (ISSET(td->flags, PROC_WAITED)) {
-        return;
-    }
-
-    ci->curtd = NULL;
+    /*
+     * Every thread has a stack of its own for the
+     * kernel, so the timer may switch us out from
+     * here and we pick up where we left off.
+     */
     md_inton();
     sched_oneshot(false);
 
     md_hlt();
     md_intoff();
-    ci->curtd = td;
+}
+
+/*
+ * Take a thread off of the sleep queue, must be
+ * called with `sleepq_lock' held.
+ */
+static inline void
+sleepq_remove(struct proc *td)
+{
+    if (td->wchan == NULL) {
+        return;
+    }
+
+    TAILQ_REMOVE(&sleepq, td, sleep_link);
+    td->wchan = NULL;
+    __atomic_fetch_and(&td->flags, ~PROC_SLEEP, __ATOMIC_RELEASE);
+}
+
+/*
+ * Put the current thread to sleep on a wait channel
+ * until sched_wakeup() is called on it. The scheduler
+ * skips the thread while it is asleep.
+ *
+ * The thread is queued before `lock' is released, so
+ * a waker that holds `lock' while making the condition
+ * true cannot be missed. `lock' is held again on return
+ * and callers must recheck their condition.
+ *
+ * Interrupts are masked while juggling the locks and
+ * are left masked on return like sched_yield() does.
+ * While asleep the thread may be switched out, system
+ * calls run on a stack of their own per thread.
+ *
+ * @chan: Wait channel, any unique address.
+ * @lock: Lock protecting the condition (or NULL).
+ */
+void
+sched_sleep(void *chan, struct spinlock *lock)
+{
+    struct proc *td;
+
+    if ((td = this_td()) == NULL) {
+        return;
+    }
+
+    md_intoff();
+    spinlock_acquire(&sleepq_lock);
+    td->wchan = chan;
+    __atomic_fetch_or(&td->flags, PROC_SLEEP, __ATOMIC_ACQ_REL);
+    TAILQ_INSERT_TAIL(&sleepq, td, sleep_link);
+    spinlock_release(&sleepq_lock);
+
+    if (lock != NULL) {
+        spinlock_release(lock);
+    }
+
+    /* Idle until we are woken up */
+    while (ISSET(__atomic_load_n(&td->flags, __ATOMIC_ACQUIRE), PROC_SLEEP)) {
+        md_inton();
+        md_hlt();
+        md_intoff();
+    }
+
+    /* Someone else may have cleared PROC_SLEEP */
+    spinlock_acquire(&sleepq_lock);
+    sleepq_remove(td);
+    spinlock_release(&sleepq_lock);
+
+    if (lock != NULL) {
+        spinlock_acquire(lock);
+    }
+}
+
+/*
+ * Wake up every thread sleeping on a wait channel.
+ *
+ * @chan: Wait channel passed to sched_sleep()
+ */
+void
+sched_wakeup(void *chan)
+{
+    struct proc *td, *next;
+
+    spinlock_acquire(&sleepq_lock);
+    TAILQ_FOREACH_SAFE(td, &sleepq, sleep_link, next) {
+        if (td->wchan == chan) {
+            sleepq_remove(td);
+        }
+    }
+    spinlock_release(&sleepq_lock);
+}
+
+/*
+ * Take a thread off of its wait channel without
+ * waking anyone else up, used on exit.
+ *
+ * @td: Thread to take off
+ */
+void
+sched_unsleep(struct proc *td)
+{
+    spinlock_acquire(&sleepq_lock);
+    sleepq_remove(td);
+    spinlock_release(&sleepq_lock);
 }
 
 void
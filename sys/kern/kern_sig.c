@@ -32,11 +32,17 @@
 #include <sys/errno.h>
 #include <sys/syslog.h>
 #include <sys/param.h>
-#include <vm/dynalloc.h>
+#include <sys/proc.h>
+#include <sys/sched.h>
+#include <sys/systm.h>
 #include <string.h>
 
 #define sigmask(SIGNO) BIT(SIGNO)
 
+/* Standard and realtime signal masks */
+#define SIGSTD_MASK (sigmask(SIGRTMIN) - 2)
+#define SIGRT_MASK  (~(sigmask(SIGRTMIN) - 1))
+
 static struct sigaction sa_tab[] = {
     [SIGFPE] = {
         .sa_handler = sigfpe_default,
@@ -63,6 +69,12 @@ static struct sigaction sa_tab[] = {
         .sa_mask = 0,
         .sa_flags = 0,
         .sa_sigaction = NULL
+    },
+    [SIGXCPU] = {
+        .sa_handler = sigterm_default,
+        .sa_mask = 0,
+        .sa_flags = 0,
+        .sa_sigaction = NULL
     }
 };
 
@@ -70,6 +82,9 @@ static struct sigaction sa_tab[] = {
  * Register a new signal descriptor, set it in the process
  * structure and return it in `ksig`.
  *
+ * Only standard signals have descriptors, these live in
+ * the process structure so no memory is allocated here.
+ *
  * @td: Process to register signal to.
  * @signo: Signal number to register.
  * @ksig: Will contain a pointer to new signal descriptor.
@@ -80,25 +95,12 @@ newsig(struct proc *td, int signo, struct ksiginfo **ksig)
     struct ksiginfo *ksig_tmp;
 
     /* Ensure we have valid args */
-    if (td == NULL || signo >= PROC_SIGMAX)
+    if (td == NULL || signo <= 0 || signo >= SIGRTMIN)
         return -EINVAL;
 
-    /*
-     * If we already have a signal registered in a slot, free up
-     * memory used for that signal descriptor so we can override
-     * it with the new one.
-     */
-    if ((ksig_tmp = td->ksig_list[signo]) != NULL)
-        dynfree(ksig_tmp);
-
-    /* Allocate our new signal */
-    ksig_tmp = dynalloc(sizeof(*ksig_tmp));
-    if (ksig_tmp == NULL)
-        return -ENOMEM;
-
+    ksig_tmp = &td->ksig_list[signo];
     memset(ksig_tmp, 0, sizeof(*ksig_tmp));
     ksig_tmp->signo = signo;
-    td->ksig_list[signo] = ksig_tmp;
     *ksig = ksig_tmp;
     return 0;
 }
@@ -112,47 +114,197 @@ newsig(struct proc *td, int signo, struct ksiginfo **ksig)
 int
 delsig(struct proc *td, int signo)
 {
-    struct ksiginfo *ksig_tmp;
-
     /* Ensure we have valid args */
-    if (td == NULL || signo >= PROC_SIGMAX)
+    if (td == NULL || signo <= 0 || signo >= SIGRTMIN)
         return -EINVAL;
 
-    /* Don't do anything if it doesn't exist */
-    if ((ksig_tmp = td->ksig_list[signo]) == NULL)
-        return 0;
-
-    dynfree(ksig_tmp);
-    td->ksig_list[signo] = NULL;
+    __atomic_fetch_and(&td->sigpend, ~sigmask(signo), __ATOMIC_RELAXED);
+    memset(&td->ksig_list[signo], 0, sizeof(td->ksig_list[signo]));
     return 0;
 }
 
+/*
+ * Mark signals in `set' as pending on `td'. Standard
+ * signals are merged into the pending mask and are
+ * dropped if no action is registered for them, each
+ * realtime signal is queued.
+ */
 int
 sendsig(struct proc *td, const sigset_t *set)
 {
-    struct ksiginfo *ksig_tmp;
+    union sigval value = { 0 };
+    sigset_t pend = 0, tmp;
+    int signo;
 
     /* Ensure arguments are correct */
     if (td == NULL || set == NULL)
         return -EINVAL;
 
-    /* Enqueue required ksiginfo structures */
-    for (int i = 0; i < PROC_SIGMAX; ++i) {
-        if ((ksig_tmp = td->ksig_list[i]) == NULL) {
+    tmp = *set & SIGSTD_MASK;
+    while (tmp != 0) {
+        signo = __builtin_ctzll(tmp);
+        tmp &= tmp - 1;
+        if (td->ksig_list[signo].si != NULL) {
+            pend |= sigmask(signo);
+        }
+    }
+
+    if (pend != 0) {
+        spinlock_acquire(&td->ksigq_lock);
+        __atomic_fetch_or(&td->sigpend, pend, __ATOMIC_RELEASE);
+        sched_wakeup(&td->ksigq);
+        spinlock_release(&td->ksigq_lock);
+    }
+
+    tmp = *set & SIGRT_MASK;
+    while (tmp != 0) {
+        signo = __builtin_ctzll(tmp);
+        tmp &= tmp - 1;
+        queuesig(td, signo, SI_KERNEL, value);
+    }
+
+    return 0;
+}
+
+/*
+ * Queue a signal with a value on `td'.
+ *
+ * Realtime signals are queued in order, standard
+ * signals are merged like sendsig() would and lose
+ * the value.
+ *
+ * @td: Process to signal.
+ * @signo: Signal number.
+ * @code: Signal code (see SI_*).
+ * @value: Value to pass along.
+ *
+ * Returns -EAGAIN if the queue is full.
+ */
+int
+queuesig(struct proc *td, int signo, int code, union sigval value)
+{
+    struct ksiginfo *ksig;
+    struct proc *self;
+    sigset_t set;
+    uint32_t free;
+
+    if (td == NULL || signo <= 0 || signo > SIGRTMAX)
+        return -EINVAL;
+
+    if (signo < SIGRTMIN) {
+        set = sigmask(signo);
+        return sendsig(td, &set);
+    }
+
+    spinlock_acquire(&td->ksigq_lock);
+    free = ~td->ksigq_used;
+    if (free == 0) {
+        spinlock_release(&td->ksigq_lock);
+        return -EAGAIN;
+    }
+
+    ksig = &td->ksigq_pool[__builtin_ctz(free)];
+    td->ksigq_used |= (free & -free);
+
+    self = this_td();
+    ksig->signo = signo;
+    ksig->sigcode = code;
+    ksig->sender = (self != NULL) ? self->pid : 0;
+    ksig->value = value;
+    ksig->si = NULL;
+
+    TAILQ_INSERT_TAIL(&td->ksigq, ksig, link);
+    __atomic_fetch_or(&td->sigpend, sigmask(signo), __ATOMIC_RELEASE);
+    sched_wakeup(&td->ksigq);
+    spinlock_release(&td->ksigq_lock);
+    return 0;
+}
+
+/*
+ * Dequeue the oldest queued instance of a realtime
+ * signal, must be called with `ksigq_lock' held.
+ */
+static void
+sigdeq(struct proc *td, int signo, siginfo_t *info)
+{
+    struct ksiginfo *ksig, *found = NULL;
+    bool more = false;
+
+    TAILQ_FOREACH(ksig, &td->ksigq, link) {
+        if (ksig->signo != signo) {
             continue;
         }
+        if (found != NULL) {
+            more = true;
+            break;
+        }
+        found = ksig;
+    }
+
+    if (!more) {
+        __atomic_fetch_and(&td->sigpend, ~sigmask(signo), __ATOMIC_RELAXED);
+    }
+    if (found == NULL) {
+        return;
+    }
 
-        /* Enqueue if it is a member of the sigset */
-        if (sigismember(set, i)) {
-            spinlock_acquire(&td->ksigq_lock);
-            TAILQ_INSERT_TAIL(&td->ksigq, ksig_tmp, link);
-            spinlock_release(&td->ksigq_lock);
+    info->si_pid = found->sender;
+    info->si_code = found->sigcode;
+    info->si_value = found->value;
+
+    TAILQ_REMOVE(&td->ksigq, found, link);
+    td->ksigq_used &= ~BIT(found - &td->ksigq_pool[0]);
+}
+
+/*
+ * Wait for a signal in `set' to become pending on
+ * `td' and consume it.
+ *
+ * @td: Process waiting (must be current).
+ * @set: Signals to wait for.
+ * @info: Filled with information on the signal.
+ *
+ * Returns the signal number.
+ */
+int
+sigwait_td(struct proc *td, const sigset_t *set, siginfo_t *info)
+{
+    sigset_t pend;
+    int signo;
+
+    if (td == NULL || set == NULL || info == NULL)
+        return -EINVAL;
+
+    /* Senders wake up `ksigq' with `ksigq_lock' held */
+    spinlock_acquire(&td->ksigq_lock);
+    for (;;) {
+        pend = __atomic_load_n(&td->sigpend, __ATOMIC_ACQUIRE) & *set;
+        if (pend != 0) {
+            break;
         }
+        sched_sleep(&td->ksigq, &td->ksigq_lock);
     }
 
-    return 0;
+    signo = __builtin_ctzll(pend);
+    memset(info, 0, sizeof(*info));
+    info->si_signo = signo;
+
+    if (signo < SIGRTMIN) {
+        __atomic_fetch_and(&td->sigpend, ~sigmask(signo), __ATOMIC_RELAXED);
+        spinlock_release(&td->ksigq_lock);
+        info->si_code = SI_USER;
+        return signo;
+    }
+
+    sigdeq(td, signo, info);
+    spinlock_release(&td->ksigq_lock);
+    return signo;
 }
 
+/*
+ * Set up the default signal actions of a process,
+ * signals that are already pending are kept.
+ */
 int
 signals_init(struct proc *td)
 {
@@ -160,8 +312,6 @@ signals_init(struct proc *td)
     struct ksiginfo *ksig;
     int error, i;
 
-    TAILQ_INIT(&td->ksigq);
-
     /* Populate process signal table with defaults */
     for (i = 0; i < NELEM(sa_tab); ++i) {
         sa = &sa_tab[i];
@@ -173,47 +323,45 @@ signals_init(struct proc *td)
 
         /* Attempt to register the new signal */
         if ((error = newsig(td, i, &ksig)) != 0) {
-            goto fail;
+            return error;
         }
 
         ksig->si = sa;
     }
 
     return 0;
-
-fail:
-    /*
-     * We do not want the process signal table to be in
-     * an inconsistent state so we clean up on failure.
-     */
-    for (int j = 0; j < i; ++j) {
-        if ((error = delsig(td, j)) != 0) {
-            kprintf("delsig() failed on signal %d (returned %d)\n",
-                j, error);
-        }
-    }
-
-    return error;
 }
 
+/*
+ * Run the actions of pending standard signals, this
+ * is called on the way back to the thread and costs
+ * a single load when nothing is pending.
+ *
+ * Realtime signals have no kernel actions and stay
+ * pending until consumed by sigwait_td().
+ */
 void
 dispatch_signals(struct proc *td)
 {
-    struct ksiginfo *ksig_tmp;
     struct sigaction *action;
+    sigset_t pend;
+    int signo;
 
-    spinlock_acquire(&td->ksigq_lock);
-    while (!TAILQ_EMPTY(&td->ksigq)) {
-        /* Dequeue signal descriptor */
-        ksig_tmp = TAILQ_FIRST(&td->ksigq);
-        TAILQ_REMOVE(&td->ksigq, ksig_tmp, link);
+    for (;;) {
+        pend = __atomic_load_n(&td->sigpend, __ATOMIC_ACQUIRE);
+        if ((pend &= SIGSTD_MASK) == 0) {
+            return;
+        }
+
+        signo = __builtin_ctzll(pend);
+        __atomic_fetch_and(&td->sigpend, ~sigmask(signo), __ATOMIC_ACQ_REL);
 
         /* Invoke handler */
-        action = ksig_tmp->si;
-        action->sa_handler(ksig_tmp->signo);
+        action = td->ksig_list[signo].si;
+        if (action != NULL && action->sa_handler != NULL) {
+            action->sa_handler(signo);
+        }
     }
-
-    spinlock_release(&td->ksigq_lock);
 }
 
 int
@@ -233,7 +381,7 @@ sigfillset(sigset_t *set)
 int
 sigaddset(sigset_t *set, int signo)
 {
-    if (signo <= 0 || signo >= PROC_SIGMAX)
+    if (signo <= 0 || signo > SIGRTMAX)
         return -EINVAL;
 
     *set |= sigmask(signo);
@@ -243,7 +391,7 @@ sigaddset(sigset_t *set, int signo)
 int
 sigdelset(sigset_t *set, int signo)
 {
-    if (signo <= 0 || signo >= PROC_SIGMAX)
+    if (signo <= 0 || signo > SIGRTMAX)
         return -EINVAL;
 
     *set &= ~sigmask(signo);
@@ -253,8 +401,135 @@ sigdelset(sigset_t *set, int signo)
 int
 sigismember(const sigset_t *set, int signo)
 {
-    if (signo <= 0 || signo >= PROC_SIGMAX)
+    if (signo <= 0 || signo > SIGRTMAX)
         return -EINVAL;
 
     return (*set & sigmask(signo)) != 0;
 }
+
+/*
+ * Check that the current process may send signals
+ * to `td'.
+ */
+static int
+sig_perm(struct proc *td)
+{
+    struct proc *self;
+
+    self = this_td();
+    if (td == NULL || ISSET(td->flags, PROC_EXITING | PROC_ZOMB)) {
+        return -ESRCH;
+    }
+
+    /* Kernel threads cannot be signalled */
+    if (ISSET(td->flags, PROC_KTD)) {
+        return -EPERM;
+    }
+    if (self->cred.euid != 0 && self->cred.ruid != td->cred.ruid) {
+        return -EPERM;
+    }
+
+    return 0;
+}
+
+/*
+ * Queue a signal on a process by PID on behalf of
+ * the current process.
+ *
+ * `proc_lock' is held from the lookup through the
+ * queueing so that the target cannot be freed under
+ * us by the reaper or waitpid().
+ *
+ * @pid: PID of target process.
+ * @signo: Signal number (0 to only check the target).
+ * @code: Signal code (see SI_*).
+ * @value: Value to pass along.
+ */
+static int
+sig_send_pid(pid_t pid, int signo, int code, union sigval value)
+{
+    struct proc *td;
+    int error;
+
+    td = proc_lookup_lock(pid);
+    if ((error = sig_perm(td)) == 0 && signo != 0) {
+        error = queuesig(td, signo, code, value);
+    }
+
+    proc_unlock();
+    return error;
+}
+
+/*
+ * arg0: PID
+ * arg1: Signal number (0 to only check the target)
+ */
+scret_t
+sys_kill(struct syscall_args *scargs)
+{
+    union sigval value = { 0 };
+    int signo;
+
+    signo = scargs->arg1;
+    if (signo < 0 || signo > SIGRTMAX) {
+        return -EINVAL;
+    }
+
+    return sig_send_pid(scargs->arg0, signo, SI_USER, value);
+}
+
+/*
+ * arg0: PID
+ * arg1: Signal number
+ * arg2: Signal value
+ */
+scret_t
+sys_sigqueue(struct syscall_args *scargs)
+{
+    union sigval value;
+    int signo;
+
+    signo = scargs->arg1;
+    if (signo <= 0 || signo > SIGRTMAX) {
+        return -EINVAL;
+    }
+
+    value.sival_ptr = (void *)scargs->arg2;
+    return sig_send_pid(scargs->arg0, signo, SI_QUEUE, value);
+}
+
+/*
+ * arg0: Signal set to wait on
+ * arg1: Signal info (optional)
+ *
+ * Returns the signal number.
+ */
+scret_t
+sys_sigwaitinfo(struct syscall_args *scargs)
+{
+    const sigset_t *u_set = (void *)scargs->arg0;
+    siginfo_t *u_info = (void *)scargs->arg1;
+    siginfo_t info;
+    sigset_t set;
+    int error, signo;
+
+    if ((error = copyin(u_set, &set, sizeof(set))) < 0) {
+        return error;
+    }
+    if (set == 0) {
+        return -EINVAL;
+    }
+
+    signo = sigwait_td(this_td(), &set, &info);
+    if (signo < 0) {
+        return signo;
+    }
+
+    if (u_info != NULL) {
+        error = copyout(&info, u_info, sizeof(info));
+        if (error < 0)
+            return error;
+    }
+
+    return signo;
+}
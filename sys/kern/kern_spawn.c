@@ -37,6 +37,7 @@
 #include <sys/syslog.h>
 #include <sys/syscall.h>
 #include <sys/signal.h>
+#include <sys/resource.h>
 #include <sys/limits.h>
 #include <sys/sched.h>
 #include <vm/dynalloc.h>
@@ -47,15 +48,20 @@
 
 #define ARGVP_MAX (ARG_MAX / sizeof(void *))
 
-static size_t next_pid = 1;
+static volatile pid_t next_pid = 1;
 
 /*
- * TODO: envp
+ * Arguments handed to a new user process. Everything
+ * lives in a single allocation sized to what the caller
+ * actually passed; `vec' holds the NULL terminated argv
+ * and envp pointer arrays followed by the path and the
+ * packed strings they point to.
  */
 struct spawn_args {
-    char path[PATH_MAX];
-    char argv_blk[ARG_MAX];
-    char *argv[ARGVP_MAX];
+    char *path;
+    char **argv;
+    char **envp;
+    char *vec[];
 };
 
 static inline void
@@ -69,23 +75,16 @@ try_free_data(void *p)
 static void
 spawn_thunk(void)
 {
-    const char *path;
-    char pathbuf[PATH_MAX];
     struct proc *cur;
     struct execve_args execve_args;
     struct spawn_args *args;
-    char *envp[] = { NULL };
 
     cur = this_td();
     args = cur->data;
-    path = args->path;
-    memset(pathbuf, 0, sizeof(pathbuf));
-    memcpy(pathbuf, path, strlen(path));
 
-    execve_args.pathname = pathbuf;
-    execve_args.argv = (char **)&args->argv[0];
-    execve_args.envp = envp;
-    path = NULL;
+    execve_args.pathname = args->path;
+    execve_args.argv = args->argv;
+    execve_args.envp = args->envp;
 
     if (execve(cur, &execve_args) != 0) {
         pr_error("execve failed, aborting\n");
@@ -94,10 +93,108 @@ spawn_thunk(void)
     __builtin_unreachable();
 }
 
+/*
+ * Count the entries of a user string vector and
+ * the bytes needed to hold its strings.
+ *
+ * @u_vec: User vector (may be NULL).
+ * @countp: Number of entries is written here.
+ * @bytesp: Bytes used so far, updated with string sizes.
+ */
+static int
+spawn_vec_size(const char **u_vec, size_t *countp, size_t *bytesp)
+{
+    const char *u_p;
+    size_t i, len;
+    int error;
+
+    *countp = 0;
+    if (u_vec == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < ARGVP_MAX - 1; ++i) {
+        error = copyin(&u_vec[i], &u_p, sizeof(u_p));
+        if (error < 0) {
+            return error;
+        }
+        if (u_p == NULL) {
+            break;
+        }
+        if (*bytesp >= ARG_MAX) {
+            return -E2BIG;
+        }
+
+        error = ustrnlen(u_p, ARG_MAX - *bytesp - 1, &len);
+        if (error < 0) {
+            return (error == -ENAMETOOLONG) ? -E2BIG : error;
+        }
+        *bytesp += len + 1;
+    }
+
+    if (i == ARGVP_MAX - 1) {
+        return -E2BIG;
+    }
+
+    *countp = i;
+    return 0;
+}
+
+/*
+ * Copy a user string vector into a spawn block.
+ *
+ * @u_vec: User vector (may be NULL if `count' is zero).
+ * @count: Entries counted by spawn_vec_size().
+ * @vec: Destination pointer array.
+ * @strp: Where the strings go, advanced past them.
+ * @endp: End of the spawn block.
+ */
+static int
+spawn_vec_copy(const char **u_vec, size_t count, char **vec, char **strp,
+    const char *endp)
+{
+    const char *u_p;
+    char *str = *strp;
+    size_t len;
+    int error;
+
+    for (size_t i = 0; i < count; ++i) {
+        error = copyin(&u_vec[i], &u_p, sizeof(u_p));
+        if (error < 0) {
+            return error;
+        }
+
+        /* Lengths are re-checked in case the user raced us */
+        if (u_p == NULL) {
+            return -EFAULT;
+        }
+        if (str >= endp) {
+            return -E2BIG;
+        }
+
+        error = ustrnlen(u_p, endp - str - 1, &len);
+        if (error < 0) {
+            return (error == -ENAMETOOLONG) ? -E2BIG : error;
+        }
+        if ((error = copyin(u_p, str, len)) < 0) {
+            return error;
+        }
+
+        str[len] = '\0';
+        vec[i] = str;
+        str += len + 1;
+    }
+
+    vec[count] = NULL;
+    *strp = str;
+    return 0;
+}
+
 pid_t
 waitpid(pid_t pid, int *wstatus, int options)
 {
     struct proc *child, *td;
+    uint32_t flags;
     pid_t ret;
 
     td = this_td();
@@ -108,18 +205,23 @@ waitpid(pid_t pid, int *wstatus, int options)
     }
 
     /* Wait for it to be done */
-    while (!ISSET(child->flags, PROC_ZOMB)) {
-        sched_yield();
-    }
-
+    proc_wait_zombie(td, child);
 
     /* Give back the status */
     if (wstatus != NULL) {
         copyout(&child->exit_status, wstatus, sizeof(*wstatus));
     }
 
+    /*
+     * The reaper may still be tearing the child down,
+     * whoever is last out of us frees it.
+     */
     ret = child->pid;
-    proc_reap(child);
+    flags = __atomic_fetch_and(&child->flags, ~PROC_WAITED, __ATOMIC_ACQ_REL);
+    if (ISSET(flags, PROC_WAITED) && ISSET(flags, PROC_REAPED)) {
+        proc_free(child);
+    }
+
     return ret;
 }
 
@@ -145,17 +247,24 @@ spawn(struct proc *cur, void(*func)(void), void *p, int flags, struct proc **new
     int error;
     pid_t pid;
 
-    newproc = dynalloc(sizeof(*newproc));
+    /* Kernel spawned processes are never limited */
+    if (cur->pid != 0) {
+        if ((error = rlim_check_nproc(cur)) < 0) {
+            try_free_data(p);
+            return error;
+        }
+    }
+
+    newproc = proc_alloc();
     if (newproc == NULL) {
         pr_error("could not alloc proc (-ENOMEM)\n");
         try_free_data(p);
         return -ENOMEM;
     }
 
-    memset(newproc, 0, sizeof(*newproc));
     error = md_spawn(newproc, cur, (uintptr_t)func);
     if (error < 0) {
-        dynfree(newproc);
+        proc_free(newproc);
         try_free_data(p);
         pr_error("error initializing proc\n");
         return error;
@@ -166,21 +275,27 @@ spawn(struct proc *cur, void(*func)(void), void *p, int flags, struct proc **new
         *newprocp = newproc;
     }
 
-    if (!ISSET(cur->flags, PROC_LEAFQ)) {
-        TAILQ_INIT(&cur->leafq);
-        cur->flags |= PROC_LEAFQ;
-    }
-
     error = proc_init(newproc, cur);
     if (error < 0) {
-        dynfree(newproc);
+        proc_free(newproc);
         try_free_data(p);
         pr_error("error initializing proc\n");
         return error;
     }
 
+    /* Tracing is inherited */
+    if (ISSET(cur->flags, PROC_KTRACE)) {
+        newproc->flags |= PROC_KTRACE;
+    }
+
+    /* Nobody waits on threads the kernel spawns for itself */
+    if (cur->pid == 0) {
+        newproc->flags &= ~PROC_WAITED;
+    }
+
     newproc->data = p;
-    newproc->pid = next_pid++;
+    newproc->pid = __atomic_fetch_add(&next_pid, 1, __ATOMIC_RELAXED);
+    proc_hash(newproc);
     sched_enqueue_td(newproc);
     pid = newproc->pid;
     return pid;
@@ -199,16 +314,12 @@ get_child(struct proc *cur, pid_t pid)
 {
     struct proc *procp;
 
-    TAILQ_FOREACH(procp, &cur->leafq, leaf_link) {
-        if (procp == NULL) {
-            continue;
-        }
-        if (procp->pid == pid) {
-            return procp;
-        }
+    procp = proc_lookup(pid);
+    if (procp == NULL || procp->parent != cur) {
+        return NULL;
     }
 
-    return NULL;
+    return procp;
 }
 
 /*
@@ -235,60 +346,65 @@ sys_waitpid(struct syscall_args *scargs)
 /*
  * arg0: The file /path/to/executable
  * arg1: Argv
- * arg2: Envp (TODO)
+ * arg2: Envp
  * arg3: Optional flags (`flags')
  */
 scret_t
 sys_spawn(struct syscall_args *scargs)
 {
     struct spawn_args *args;
-    char *path;
-    const char *u_path, **u_argv;
-    const char *u_p = NULL;
+    const char *u_path, **u_argv, **u_envp;
+    char *str, *end;
     struct proc *td;
     int flags, error;
-    size_t len, bytes_copied = 0;
-    size_t argv_i = 0;
+    size_t path_len, argc, envc;
+    size_t size, bytes = 0;
 
     td = this_td();
     u_path = (const char *)scargs->arg0;
     u_argv = (const char **)scargs->arg1;
+    u_envp = (const char **)scargs->arg2;
     flags = scargs->arg3;
 
-    args = dynalloc(sizeof(*args));
+    /*
+     * Size everything up front so we only allocate
+     * and copy the bytes the caller actually uses.
+     */
+    if ((error = ustrnlen(u_path, PATH_MAX - 1, &path_len)) < 0)
+        return error;
+    if ((error = spawn_vec_size(u_argv, &argc, &bytes)) < 0)
+        return error;
+    if ((error = spawn_vec_size(u_envp, &envc, &bytes)) < 0)
+        return error;
+
+    size = sizeof(*args) + (argc + envc + 2) * sizeof(char *);
+    size += path_len + 1 + bytes;
+    args = dynalloc(size);
     if (args == NULL) {
         return -ENOMEM;
     }
 
-    error = copyinstr(u_path, args->path, sizeof(args->path));
+    args->argv = &args->vec[0];
+    args->envp = &args->vec[argc + 1];
+    args->path = (char *)&args->vec[argc + envc + 2];
+    end = (char *)args + size;
+
+    error = copyin(u_path, args->path, path_len);
     if (error < 0) {
         dynfree(args);
         return error;
     }
 
-    memset(args->argv, 0, ARG_MAX);
-    for (size_t i = 0; i < ARG_MAX - 1; ++i) {
-        error = copyin(&u_argv[argv_i], &u_p, sizeof(u_p));
-        if (error < 0) {
-            dynfree(args);
-            return error;
-        }
-        if (u_p == NULL) {
-            args->argv[argv_i++] = NULL;
-            break;
-        }
-
-        path = &args->argv_blk[i];
-        error = copyinstr(u_p, path, ARG_MAX - bytes_copied);
-        if (error < 0) {
-            dynfree(args);
-            return error;
-        }
+    args->path[path_len] = '\0';
+    str = args->path + path_len + 1;
 
-        args->argv[argv_i++] = &args->argv_blk[i];
-        len = strlen(path);
-        bytes_copied += (len + 1);
-        i += len;
+    error = spawn_vec_copy(u_argv, argc, args->argv, &str, end);
+    if (error == 0) {
+        error = spawn_vec_copy(u_envp, envc, args->envp, &str, end);
+    }
+    if (error < 0) {
+        dynfree(args);
+        return error;
     }
 
     return spawn(td, spawn_thunk, args, flags, NULL);
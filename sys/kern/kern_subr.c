@@ -50,18 +50,18 @@ check_uaddr(const void *uaddr)
     vaddr_t stack_start, stack_end;
     struct mmap_lgdr *lp;
     struct mmap_entry find, *res;
-    struct exec_prog exec;
+    const struct exec_prog *exec;
     struct proc *td;
     uintptr_t addr;
 
     td = this_td();
-    exec = td->exec;
+    exec = &td->exec;
     addr = (uintptr_t)uaddr;
 
     stack_start = td->stack_base;
     stack_end = td->stack_base + PROC_STACK_SIZE;
 
-    if (addr >= exec.start && addr <= exec.end)
+    if (addr >= exec->start && addr <= exec->end)
         return true;
     if (addr >= stack_start && addr <= stack_end)
         return true;
@@ -163,3 +163,36 @@ copyinstr(const void *uaddr, char *kaddr, size_t len)
 
     return 0;
 }
+
+/*
+ * Get the length of a string in userspace
+ *
+ * The address is validated once per page rather than
+ * per byte as user mappings are page granular.
+ *
+ * @uaddr: Userspace address.
+ * @maxlen: Max length of string (excluding NUL).
+ * @lenp: Length of string is written here.
+ *
+ * Returns -ENAMETOOLONG if no NUL was found within
+ * `maxlen' bytes.
+ */
+int
+ustrnlen(const void *uaddr, size_t maxlen, size_t *lenp)
+{
+    const char *src = (char *)uaddr;
+
+    for (size_t i = 0; i <= maxlen; ++i) {
+        if (i == 0 || ((uintptr_t)&src[i] & (DEFAULT_PAGESIZE - 1)) == 0) {
+            if (!check_uaddr(src + i))
+                return -EFAULT;
+        }
+
+        if (src[i] == '\0') {
+            *lenp = i;
+            return 0;
+        }
+    }
+
+    return -ENAMETOOLONG;
+}
@@ -65,12 +65,14 @@ spinlock_usleep(struct spinlock *lock, size_t usec_max)
         return -ENOTSUP;
     }
 
+    sched_preempt_set(false);
     usec_start = tmr.get_time_usec();
     while (__atomic_test_and_set(&lock->lock, __ATOMIC_ACQUIRE)) {
         usec_cur = tmr.get_time_usec();
         usec_elap = (usec_cur - usec_start);
 
         if (usec_elap > usec_max) {
+            sched_preempt_set(true);
             return -1;
         }
     }
@@ -97,6 +99,9 @@ spinlock_acquire(struct spinlock *lock)
  * This function returns 1 (a value that may be
  * spinned on) when the lock is acquired and a
  * thread is already spinning on it.
+ *
+ * Preemption is only disabled when 0 is returned,
+ * to be paired with spinlock_release().
  */
 int
 spinlock_try_acquire(struct spinlock *lock)
@@ -108,7 +113,13 @@ spinlock_try_acquire(struct spinlock *lock)
         return 1;
     }
 
-    return __atomic_test_and_set(&lock->lock, __ATOMIC_ACQUIRE);
+    sched_preempt_set(false);
+    if (__atomic_test_and_set(&lock->lock, __ATOMIC_ACQUIRE)) {
+        sched_preempt_set(true);
+        return 1;
+    }
+
+    return 0;
 }
 
 void
@@ -34,6 +34,9 @@
 #include <sys/types.h>
 #include <sys/ucred.h>
 #include <sys/disk.h>
+#include <sys/random.h>
+#include <sys/signal.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/mman.h>
 #include <sys/proc.h>
@@ -71,6 +74,12 @@ scret_t(*g_sctab[])(struct syscall_args *) = {
     sys_connect, /* SYS_connect */
     sys_setsockopt,  /* SYS_setsockopt */
     sys_disk,    /* SYS_disk */
+    sys_getrandom, /* SYS_getrandom */
+    sys_kill,      /* SYS_kill */
+    sys_sigqueue,  /* SYS_sigqueue */
+    sys_sigwaitinfo, /* SYS_sigwaitinfo */
+    sys_getrlimit, /* SYS_getrlimit */
+    sys_setrlimit, /* SYS_setrlimit */
 };
 
 const size_t MAX_SYSCALLS = NELEM(g_sctab);
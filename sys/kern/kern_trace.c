@@ -0,0 +1,360 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Static tracepoints
+ *
+ * Each processor owns a ring of binary trace records
+ * that tracepoints append to without taking any locks.
+ * Records are drained in bulk through '/ctl/trace/buf'
+ * and events are enabled by writing a mask of event IDs
+ * to '/ctl/trace/mask'.
+ */
+
+#include <sys/types.h>
+#include <sys/errno.h>
+#include <sys/param.h>
+#include <sys/atomic.h>
+#include <sys/syslog.h>
+#include <sys/limits.h>
+#include <sys/trace.h>
+#include <sys/proc.h>
+#include <sys/percpu.h>
+#include <fs/ctlfs.h>
+#include <machine/cpu.h>
+#include <vm/physmem.h>
+#include <vm/vm.h>
+#include <string.h>
+#if defined(__x86_64__)
+#include <machine/tsc.h>
+#endif  /* __x86_64__ */
+
+#define pr_trace(fmt, ...) kprintf("trace: " fmt, ##__VA_ARGS__)
+#define pr_error(...) pr_trace(__VA_ARGS__)
+
+#define TRACE_BUF_PAGES 8
+#define TRACE_NREC \
+    ((TRACE_BUF_PAGES * DEFAULT_PAGESIZE) / sizeof(struct trace_slot))
+
+/*
+ * A slot in a trace ring
+ *
+ * @seq: Index of the record plus one once it is
+ *       fully written, zero while being written
+ * @rec: The record itself
+ */
+struct trace_slot {
+    volatile unsigned long seq;
+    struct trace_rec rec;
+};
+
+/*
+ * Per-CPU trace ring
+ *
+ * @head: Total number of records ever written
+ * @tail: Total number of records consumed
+ * @rec: Ring of TRACE_NREC slots
+ */
+struct trace_buf {
+    volatile unsigned long head;
+    unsigned long tail;
+    struct trace_slot *rec;
+};
+
+static struct ctlops trace_buf_ctl;
+static struct ctlops trace_mask_ctl;
+
+volatile uint32_t g_trace_mask = 0;
+static DEFINE_PERCPU(struct trace_buf, tbuf);
+__cacheline_aligned static struct spinlock trace_lock = {0};
+
+static inline uint64_t
+trace_stamp(void)
+{
+#if defined(__x86_64__)
+    return rdtsc();
+#else
+    return 0;
+#endif  /* __x86_64__ */
+}
+
+/*
+ * Allocate trace rings for every processor that
+ * is online, rings that already exist are kept.
+ *
+ * XXX: Must be called with `trace_lock' acquired.
+ */
+static int
+trace_alloc_bufs(void)
+{
+    struct trace_buf *tbp;
+    struct cpu_info *ci;
+    uintptr_t pa;
+
+    for (uint32_t i = 0; i < CPU_MAX; ++i) {
+        if ((ci = cpu_get(i)) == NULL) {
+            continue;
+        }
+
+        tbp = PERCPU_PTR_CPU(tbuf, ci);
+        if (tbp->rec != NULL) {
+            continue;
+        }
+
+        pa = vm_alloc_frame(TRACE_BUF_PAGES);
+        if (pa == 0) {
+            pr_error("failed to alloc ring for cpu%d\n", i);
+            return -ENOMEM;
+        }
+
+        tbp->head = 0;
+        tbp->tail = 0;
+        tbp->rec = PHYS_TO_VIRT(pa);
+        memset(tbp->rec, 0, TRACE_BUF_PAGES * DEFAULT_PAGESIZE);
+    }
+
+    return 0;
+}
+
+/*
+ * Append a record to the ring of the current
+ * processor. Use the TRACE() macro rather than
+ * calling this directly.
+ *
+ * @event: Event ID (see TRACE_*)
+ * @a0: First event argument
+ * @a1: Second event argument
+ * @a2: Third event argument
+ */
+void
+trace_emit(uint16_t event, uint64_t a0, uint64_t a1, uint64_t a2)
+{
+    struct trace_buf *tbp;
+    struct trace_slot *sp;
+    struct trace_rec *rp;
+    struct cpu_info *ci;
+    struct proc *td;
+    unsigned long slot;
+
+    if ((ci = this_cpu()) == NULL) {
+        return;
+    }
+
+    tbp = PERCPU_PTR(tbuf);
+    if (tbp->rec == NULL) {
+        return;
+    }
+
+    /*
+     * Reserve a slot atomically so an interrupt that
+     * fires a tracepoint of its own in the middle of
+     * this one gets a slot of its own.
+     */
+    slot = atomic_inc_long(&tbp->head) - 1;
+    sp = &tbp->rec[slot % TRACE_NREC];
+    rp = &sp->rec;
+    td = ci->curtd;
+
+    /* Readers skip the slot until it is committed */
+    __atomic_store_n(&sp->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    rp->tsc = trace_stamp();
+    rp->pid = (td != NULL) ? td->pid : 0;
+    rp->cpu = ci->id;
+    rp->event = event;
+    rp->arg[0] = a0;
+    rp->arg[1] = a1;
+    rp->arg[2] = a2;
+    __atomic_store_n(&sp->seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Copy record `idx' out of a ring if it is there
+ * in one piece.
+ *
+ * Returns 0 on success, -EAGAIN if it is still being
+ * written and -ESTALE if it has been overwritten.
+ */
+static int
+trace_copy_rec(struct trace_buf *tbp, unsigned long idx,
+    struct trace_rec *dest)
+{
+    struct trace_slot *sp;
+    unsigned long seq;
+
+    sp = &tbp->rec[idx % TRACE_NREC];
+    seq = __atomic_load_n(&sp->seq, __ATOMIC_ACQUIRE);
+    if (seq == 0 || seq < idx + 1) {
+        return -EAGAIN;
+    }
+    if (seq != idx + 1) {
+        return -ESTALE;
+    }
+
+    *dest = sp->rec;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&sp->seq, __ATOMIC_RELAXED) != seq) {
+        return -ESTALE;
+    }
+
+    return 0;
+}
+
+/*
+ * Drain as many records as fit in the caller's
+ * buffer, oldest records of each processor first.
+ * Records that were overwritten before being read
+ * are dropped, a processor's ring is left alone at
+ * the first record that is still being written.
+ */
+static int
+trace_buf_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct trace_buf *tbp;
+    struct trace_rec *dest = sio->buf;
+    struct cpu_info *ci;
+    unsigned long head;
+    size_t max, n = 0;
+    int error;
+
+    max = sio->len / sizeof(struct trace_rec);
+    spinlock_acquire(&trace_lock);
+
+    for (uint32_t i = 0; i < CPU_MAX && n < max; ++i) {
+        if ((ci = cpu_get(i)) == NULL) {
+            continue;
+        }
+
+        tbp = PERCPU_PTR_CPU(tbuf, ci);
+        if (tbp->rec == NULL) {
+            continue;
+        }
+
+        head = tbp->head;
+        if ((head - tbp->tail) > TRACE_NREC) {
+            tbp->tail = head - TRACE_NREC;
+        }
+
+        while (tbp->tail < head && n < max) {
+            error = trace_copy_rec(tbp, tbp->tail, &dest[n]);
+            if (error == -EAGAIN) {
+                break;
+            }
+            if (error == 0) {
+                ++n;
+            }
+            ++tbp->tail;
+        }
+    }
+
+    spinlock_release(&trace_lock);
+    return n * sizeof(struct trace_rec);
+}
+
+static int
+trace_mask_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    uint32_t mask = g_trace_mask;
+
+    if (sio->len > sizeof(mask)) {
+        sio->len = sizeof(mask);
+    }
+
+    memcpy(sio->buf, &mask, sio->len);
+    return sio->len;
+}
+
+/*
+ * Set the mask of enabled events, rings are
+ * allocated the first time an event is enabled.
+ *
+ * Only root may do this, ctlfs does not check
+ * the mode of its entries.
+ */
+static int
+trace_mask_write(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    struct proc *td;
+    uint32_t mask;
+    int error;
+
+    td = this_td();
+    if (td != NULL && td->cred.euid != 0) {
+        return -EPERM;
+    }
+
+    if (sio->len < sizeof(mask)) {
+        return -EINVAL;
+    }
+
+    memcpy(&mask, sio->buf, sizeof(mask));
+    mask &= MASK(TRACE_NEVENT);
+
+    spinlock_acquire(&trace_lock);
+    if (mask != 0 && (error = trace_alloc_bufs()) < 0) {
+        spinlock_release(&trace_lock);
+        return error;
+    }
+
+    g_trace_mask = mask;
+    spinlock_release(&trace_lock);
+    return sizeof(mask);
+}
+
+void
+trace_init(void)
+{
+    char devname[] = "trace";
+    struct ctlfs_dev ctl;
+
+    /*
+     * Register '/ctl/trace/buf' for reading back
+     * records and '/ctl/trace/mask' for selecting
+     * which events are recorded.
+     */
+    ctl.mode = 0644;
+    ctlfs_create_node(devname, &ctl);
+    ctl.devname = devname;
+    ctl.ops = &trace_buf_ctl;
+    ctlfs_create_entry("buf", &ctl);
+
+    ctl.ops = &trace_mask_ctl;
+    ctlfs_create_entry("mask", &ctl);
+}
+
+static struct ctlops trace_buf_ctl = {
+    .read = trace_buf_read,
+    .write = NULL
+};
+
+static struct ctlops trace_mask_ctl = {
+    .read = trace_mask_read,
+    .write = trace_mask_write
+};
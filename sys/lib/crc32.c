@@ -27,7 +27,44 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+/*
+ * CRC-32 (IEEE 802.3) and CRC-32C (Castagnoli)
+ *
+ * The portable path is slice-by-8, which handles eight
+ * bytes per step with eight tables. On x86 the CRC-32
+ * path folds 64 bytes at a time with PCLMULQDQ and the
+ * CRC-32C path uses the SSE4.2 crc32 instruction. The
+ * fastest supported one is picked on first use.
+ *
+ * This file is shared with userland. In the kernel the
+ * caller's SIMD state is saved around the PCLMULQDQ path,
+ * which is why it is only used for larger buffers there.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/errno.h>
+#include <stdbool.h>
+#include <string.h>
 #include <crc32.h>
+#if defined(_KERNEL)
+#include <sys/sched.h>
+#if defined(__x86_64__)
+#include <machine/asm.h>
+#endif  /* __x86_64__ */
+#endif  /* _KERNEL */
+
+#define CRC32_POLY  0xEDB88320  /* Reflected IEEE polynomial */
+#define CRC32C_POLY 0x82F63B78  /* Reflected Castagnoli polynomial */
+
+/* Shortest buffer worth folding with PCLMULQDQ */
+#if defined(_KERNEL)
+#define CRC32_FOLD_MIN 1024
+#else
+#define CRC32_FOLD_MIN 64
+#endif  /* _KERNEL */
+
+typedef long long crc_v2di __attribute__((__vector_size__(16)));
+typedef int crc_v4si __attribute__((__vector_size__(16)));
 
 static const uint32_t crc32_tab[] = {
 	0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F,
@@ -75,14 +112,372 @@ static const uint32_t crc32_tab[] = {
 	0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
 };
 
+static uint32_t crc32_slice[8][256];
+static uint32_t crc32c_slice[8][256];
+static const char *impl_names[CRC32_NIMPL] = {
+    [CRC32_IMPL_BYTE] = "byte",
+    [CRC32_IMPL_SLICE8] = "slice8",
+    [CRC32_IMPL_HW] = "hw"
+};
+
+static int crc32_impl = -1;
+static uint32_t crc32_caps = 0;
+static bool have_pclmul = false;
+static bool have_sse42 = false;
+
+/*
+ * Build the slice-by-8 tables for a polynomial, the
+ * k'th table advances a byte through k more zero bytes.
+ */
+static void
+crc32_mktab(uint32_t tab[8][256], uint32_t poly)
+{
+    uint32_t val;
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        val = i;
+        for (int j = 0; j < 8; ++j) {
+            val = (val >> 1) ^ ((val & 1) ? poly : 0);
+        }
+        tab[0][i] = val;
+    }
+
+    for (int k = 1; k < 8; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            val = tab[k - 1][i];
+            tab[k][i] = (val >> 8) ^ tab[0][val & 0xFF];
+        }
+    }
+}
+
+static uint32_t
+crc32_bytewise(const uint32_t *tab, uint32_t val, const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; ++i) {
+        val = (val >> 8) ^ tab[(val ^ p[i]) & 0xFF];
+    }
+
+    return val;
+}
+
+static uint32_t
+crc32_slice8(uint32_t tab[8][256], uint32_t val, const uint8_t *p, size_t len)
+{
+    uint32_t lo, hi;
+
+    while (len >= 8) {
+        memcpy(&lo, p, sizeof(lo));
+        memcpy(&hi, p + 4, sizeof(hi));
+        lo ^= val;
+
+        val = tab[7][lo & 0xFF] ^ tab[6][(lo >> 8) & 0xFF] ^
+              tab[5][(lo >> 16) & 0xFF] ^ tab[4][lo >> 24] ^
+              tab[3][hi & 0xFF] ^ tab[2][(hi >> 8) & 0xFF] ^
+              tab[1][(hi >> 16) & 0xFF] ^ tab[0][hi >> 24];
+
+        p += 8;
+        len -= 8;
+    }
+
+    return crc32_bytewise(tab[0], val, p, len);
+}
+
+#if defined(__x86_64__)
+static inline crc_v2di __target("sse2")
+crc32_loadu(const uint8_t *p)
+{
+    crc_v2di v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+#define CLMUL(a, b, imm) __builtin_ia32_pclmulqdq128((a), (b), (imm))
+
+/*
+ * Fold a 16 byte aligned length (at least 64 bytes)
+ * down to a CRC-32 with carry-less multiplication,
+ * see "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction" by Intel.
+ *
+ * @val: Running (inverted) CRC
+ * @p: Data to fold
+ * @len: Length of `p', a multiple of 16
+ */
+static uint32_t __target("pclmul,sse2")
+crc32_fold(uint32_t val, const uint8_t *p, size_t len)
+{
+    const crc_v2di k1k2 = { 0x0154442BD4, 0x01C6E41596 };
+    const crc_v2di k3k4 = { 0x01751997D0, 0x00CCAA009E };
+    const crc_v2di k5k0 = { 0x0163CD6124, 0x0000000000 };
+    const crc_v2di poly = { 0x01DB710641, 0x01F7011641 };
+    const crc_v2di mask = (crc_v2di)(crc_v4si){ -1, 0, -1, 0 };
+    crc_v2di x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = crc32_loadu(p + 0x00);
+    x2 = crc32_loadu(p + 0x10);
+    x3 = crc32_loadu(p + 0x20);
+    x4 = crc32_loadu(p + 0x30);
+    x1 ^= (crc_v2di)(crc_v4si){ (int)val, 0, 0, 0 };
+    p += 64;
+    len -= 64;
+
+    /* Fold four lanes 64 bytes at a time */
+    x0 = k1k2;
+    while (len >= 64) {
+        x5 = CLMUL(x1, x0, 0x00);
+        x6 = CLMUL(x2, x0, 0x00);
+        x7 = CLMUL(x3, x0, 0x00);
+        x8 = CLMUL(x4, x0, 0x00);
+
+        x1 = CLMUL(x1, x0, 0x11) ^ x5 ^ crc32_loadu(p + 0x00);
+        x2 = CLMUL(x2, x0, 0x11) ^ x6 ^ crc32_loadu(p + 0x10);
+        x3 = CLMUL(x3, x0, 0x11) ^ x7 ^ crc32_loadu(p + 0x20);
+        x4 = CLMUL(x4, x0, 0x11) ^ x8 ^ crc32_loadu(p + 0x30);
+        p += 64;
+        len -= 64;
+    }
+
+    /* Fold the four lanes into one */
+    x0 = k3k4;
+    x5 = CLMUL(x1, x0, 0x00);
+    x1 = CLMUL(x1, x0, 0x11) ^ x2 ^ x5;
+    x5 = CLMUL(x1, x0, 0x00);
+    x1 = CLMUL(x1, x0, 0x11) ^ x3 ^ x5;
+    x5 = CLMUL(x1, x0, 0x00);
+    x1 = CLMUL(x1, x0, 0x11) ^ x4 ^ x5;
+
+    /* Fold what is left 16 bytes at a time */
+    while (len >= 16) {
+        x5 = CLMUL(x1, x0, 0x00);
+        x1 = CLMUL(x1, x0, 0x11) ^ crc32_loadu(p) ^ x5;
+        p += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits */
+    x2 = CLMUL(x1, x0, 0x10);
+    x1 = (crc_v2di){ x1[1], 0 } ^ x2;
+
+    x2 = (crc_v2di)(crc_v4si){
+        ((crc_v4si)x1)[1], ((crc_v4si)x1)[2], ((crc_v4si)x1)[3], 0
+    };
+    x1 = CLMUL(x1 & mask, k5k0, 0x00) ^ x2;
+
+    /* Barrett reduction to 32 bits */
+    x2 = CLMUL(x1 & mask, poly, 0x10);
+    x2 = CLMUL(x2 & mask, poly, 0x00);
+    x1 ^= x2;
+    return ((crc_v4si)x1)[1];
+}
+
+/*
+ * CRC-32C with the SSE4.2 crc32 instruction, which
+ * only works on general purpose registers.
+ */
+static uint32_t
+crc32c_sse42(uint32_t val, const uint8_t *p, size_t len)
+{
+    uint64_t crc = val, word;
+    uint32_t val32;
+
+    while (len >= 8) {
+        memcpy(&word, p, sizeof(word));
+        __asm__("crc32q %1, %0" : "+r" (crc) : "rm" (word));
+        p += 8;
+        len -= 8;
+    }
+
+    val32 = crc;
+    while (len > 0) {
+        __asm__("crc32b %1, %0" : "+r" (val32) : "rm" (*p));
+        ++p;
+        --len;
+    }
+
+    return val32;
+}
+
+static inline void
+crc32_cpuid(uint32_t leaf, uint32_t regs[4])
+{
+    __asm__ __volatile__(
+        "cpuid"
+        : "=a" (regs[0]), "=b" (regs[1]), "=c" (regs[2]), "=d" (regs[3])
+        : "0" (leaf), "2" (0)
+    );
+}
+#endif  /* __x86_64__ */
+
+/*
+ * Build the tables and find which implementations
+ * this machine can run.
+ */
+static void
+crc32_setup(void)
+{
+#if defined(__x86_64__)
+    uint32_t regs[4];
+#endif  /* __x86_64__ */
+    uint32_t caps;
+
+    crc32_mktab(crc32_slice, CRC32_POLY);
+    crc32_mktab(crc32c_slice, CRC32C_POLY);
+    caps = (1 << CRC32_IMPL_BYTE) | (1 << CRC32_IMPL_SLICE8);
+
+#if defined(__x86_64__)
+    /*
+     * PCLMULQDQ is CPUID.(EAX=1H):ECX[1] and SSE4.2
+     * is CPUID.(EAX=1H):ECX[20].
+     */
+    crc32_cpuid(1, regs);
+    have_pclmul = (regs[2] & (1U << 1)) != 0;
+    have_sse42 = (regs[2] & (1U << 20)) != 0;
+#if defined(_KERNEL)
+    /* SSE needs to be enabled by simd_init() first */
+    if ((amd64_read_cr4() & CR4_OSFXSR) == 0) {
+        have_pclmul = false;
+    }
+#endif  /* _KERNEL */
+    if (have_pclmul || have_sse42) {
+        caps |= 1 << CRC32_IMPL_HW;
+    }
+#endif  /* __x86_64__ */
+
+    crc32_caps = caps;
+}
+
+/*
+ * Force a specific implementation, mostly useful
+ * to compare them. CRC32_IMPL_HW falls back to
+ * slice-by-8 for whichever of crc32() and crc32c()
+ * has no hardware support.
+ *
+ * @impl: Implementation to use (CRC32_IMPL_*)
+ *
+ * Returns zero on success, otherwise a less than
+ * zero value is returned.
+ */
+int
+crc32_impl_set(int impl)
+{
+    if (impl < 0 || impl >= CRC32_NIMPL) {
+        return -EINVAL;
+    }
+
+    crc32_impl_get();
+    if ((crc32_caps & (1 << impl)) == 0) {
+        return -ENOTSUP;
+    }
+
+    __atomic_store_n(&crc32_impl, impl, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Returns the implementation in use, picking the
+ * fastest supported one on first use.
+ */
+int
+crc32_impl_get(void)
+{
+    int impl;
+
+    impl = __atomic_load_n(&crc32_impl, __ATOMIC_ACQUIRE);
+    if (impl >= 0) {
+        return impl;
+    }
+
+    /*
+     * Racing callers build identical tables, the
+     * release store publishes them.
+     */
+    crc32_setup();
+    impl = CRC32_IMPL_SLICE8;
+    if ((crc32_caps & (1 << CRC32_IMPL_HW)) != 0) {
+        impl = CRC32_IMPL_HW;
+    }
+
+    __atomic_store_n(&crc32_impl, impl, __ATOMIC_RELEASE);
+    return impl;
+}
+
+const char *
+crc32_impl_name(int impl)
+{
+    if (impl < 0 || impl >= CRC32_NIMPL) {
+        return NULL;
+    }
+
+    return impl_names[impl];
+}
+
 uint32_t
 crc32(const void *data, size_t len)
 {
     const uint8_t *p = data;
     uint32_t val = 0xFFFFFFFF;
+#if defined(__x86_64__)
+    size_t n;
+#if defined(_KERNEL)
+    uint8_t fxarea[512] __aligned(16);
+#endif  /* _KERNEL */
+#endif  /* __x86_64__ */
 
-    for (size_t i = 0; i < len; ++i) {
-        val = (val >> 8) ^ crc32_tab[(val ^ p[i]) & 0xFF];
+    switch (crc32_impl_get()) {
+    case CRC32_IMPL_BYTE:
+        val = crc32_bytewise(crc32_tab, val, p, len);
+        break;
+#if defined(__x86_64__)
+    case CRC32_IMPL_HW:
+        if (!have_pclmul || len < CRC32_FOLD_MIN) {
+            val = crc32_slice8(crc32_slice, val, p, len);
+            break;
+        }
+
+        n = len & ~(size_t)15;
+#if defined(_KERNEL)
+        /* Keep the SIMD state of whoever we interrupted */
+        sched_preempt_set(false);
+        amd64_fxsave(fxarea);
+#endif  /* _KERNEL */
+        val = crc32_fold(val, p, n);
+#if defined(_KERNEL)
+        amd64_fxrstor(fxarea);
+        sched_preempt_set(true);
+#endif  /* _KERNEL */
+        val = crc32_slice8(crc32_slice, val, p + n, len - n);
+        break;
+#endif  /* __x86_64__ */
+    default:
+        val = crc32_slice8(crc32_slice, val, p, len);
+        break;
+    }
+
+    return val ^ 0xFFFFFFFF;
+}
+
+uint32_t
+crc32c(const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uint32_t val = 0xFFFFFFFF;
+
+    switch (crc32_impl_get()) {
+    case CRC32_IMPL_BYTE:
+        val = crc32_bytewise(crc32c_slice[0], val, p, len);
+        break;
+#if defined(__x86_64__)
+    case CRC32_IMPL_HW:
+        if (have_sse42) {
+            val = crc32c_sse42(val, p, len);
+            break;
+        }
+        /* FALLTHROUGH */
+#endif  /* __x86_64__ */
+    default:
+        val = crc32_slice8(crc32c_slice, val, p, len);
+        break;
     }
 
     return val ^ 0xFFFFFFFF;
@@ -27,8 +27,301 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/atomic.h>
+#include <sys/cdefs.h>
+#include <sys/ksyms.h>
+#include <sys/vmstat.h>
+#include <machine/cpu.h>
 #include <vm/dynalloc.h>
+#include <vm/physmem.h>
 #include <vm/vm.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(__DYNALLOC_PROF)
+#define DYNALLOC_PROF __DYNALLOC_PROF
+#else
+#define DYNALLOC_PROF 0
+#endif  /* __DYNALLOC_PROF */
+
+#define DYNTAG_MAGIC    0xD7A6
+#define DYNPROF_NSITE   512     /* Must be a power of two */
+#define DYNPROF_NOSLOT  0xFFFF
+#define DYNPROF_PAGES \
+    (ALIGN_UP(sizeof(struct dynprof_site) * DYNPROF_NSITE, DEFAULT_PAGESIZE) \
+        / DEFAULT_PAGESIZE)
+
+/*
+ * Allocation tag, placed right before every block
+ * when the kernel is built with DYNALLOC_PROF.
+ *
+ * @size: Size that was requested
+ * @off: Offset of the block from the TLSF allocation
+ * @cpu: Processor whose table holds the call site
+ * @slot: Index of the call site in that table
+ * @magic: Always DYNTAG_MAGIC for a live block
+ */
+struct dyntag {
+    uint32_t size;
+    uint16_t off;
+    uint16_t cpu;
+    uint16_t slot;
+    uint16_t magic;
+    uint32_t reserved;
+};
+
+/*
+ * Per-CPU call site entry, an unused entry has
+ * a `site' of zero.
+ *
+ * Frees are accounted to the processor the block
+ * was allocated on so `cur' stays exact.
+ */
+struct dynprof_site {
+    volatile uintptr_t site;
+    volatile unsigned long cur;
+    unsigned long peak;
+    volatile unsigned long total;
+    volatile unsigned long nalloc;
+    volatile unsigned long nfree;
+};
+
+static struct dynprof_site *dynprof_tab[CPU_MAX];
+static struct spinlock dynprof_lock = {0};
+
+static inline size_t
+dynprof_hash(uintptr_t site)
+{
+    return (site ^ (site >> 12)) & (DYNPROF_NSITE - 1);
+}
+
+/*
+ * Get the call site table of a processor,
+ * allocating it on first use.
+ */
+static struct dynprof_site *
+dynprof_table(uint16_t cpu)
+{
+    struct dynprof_site *tab;
+    uintptr_t pa;
+
+    if ((tab = dynprof_tab[cpu]) != NULL) {
+        return tab;
+    }
+
+    spinlock_acquire(&dynprof_lock);
+    if (dynprof_tab[cpu] == NULL) {
+        pa = vm_alloc_frame(DYNPROF_PAGES);
+        if (pa != 0) {
+            tab = PHYS_TO_VIRT(pa);
+            memset(tab, 0, DYNPROF_PAGES * DEFAULT_PAGESIZE);
+            dynprof_tab[cpu] = tab;
+        }
+    }
+
+    tab = dynprof_tab[cpu];
+    spinlock_release(&dynprof_lock);
+    return tab;
+}
+
+/*
+ * Find the entry of a call site in a table.
+ *
+ * Returns NULL if the site is not present.
+ */
+static struct dynprof_site *
+dynprof_find(struct dynprof_site *tab, uintptr_t site)
+{
+    struct dynprof_site *sp;
+    size_t idx = dynprof_hash(site);
+
+    for (size_t i = 0; i < DYNPROF_NSITE; ++i) {
+        sp = &tab[(idx + i) & (DYNPROF_NSITE - 1)];
+        if (sp->site == site) {
+            return sp;
+        }
+        if (sp->site == 0) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Account for a new allocation and record where
+ * its call site lives in the tag.
+ */
+static void
+dynprof_alloc(uintptr_t site, struct dyntag *tag)
+{
+    struct dynprof_site *tab, *sp;
+    struct cpu_info *ci;
+    unsigned long cur;
+    size_t idx, slot;
+
+    ci = this_cpu();
+    tag->cpu = (ci != NULL) ? ci->id : 0;
+    tag->slot = DYNPROF_NOSLOT;
+    if ((tab = dynprof_table(tag->cpu)) == NULL) {
+        return;
+    }
+
+    idx = dynprof_hash(site);
+    for (size_t i = 0; i < DYNPROF_NSITE; ++i) {
+        slot = (idx + i) & (DYNPROF_NSITE - 1);
+        sp = &tab[slot];
+
+        /* Claim the entry if it is free */
+        if (sp->site == 0) {
+            __sync_bool_compare_and_swap(&sp->site, 0, site);
+        }
+        if (sp->site != site) {
+            continue;
+        }
+
+        atomic_inc_long(&sp->nalloc);
+        atomic_add_long_nv(&sp->total, tag->size);
+        cur = atomic_add_long_nv(&sp->cur, tag->size);
+        if (cur > sp->peak) {
+            sp->peak = cur;
+        }
+
+        tag->slot = slot;
+        return;
+    }
+}
+
+static void
+dynprof_free(const struct dyntag *tag)
+{
+    struct dynprof_site *sp;
+
+    if (tag->slot == DYNPROF_NOSLOT) {
+        return;
+    }
+
+    sp = &dynprof_tab[tag->cpu][tag->slot];
+    atomic_inc_long(&sp->nfree);
+    atomic_sub_long_nv(&sp->cur, tag->size);
+}
+
+/*
+ * Allocate a tagged block
+ *
+ * @sz: The amount of bytes to allocate
+ * @align: Alignment, zero for the default
+ * @site: Call site the allocation is charged to
+ */
+static void *
+dynalloc_tagged(size_t sz, size_t align, uintptr_t site)
+{
+    struct vm_ctx *vm_ctx = vm_get_ctx();
+    struct dyntag *tag;
+    size_t off;
+    void *base;
+
+    off = MAX(align, sizeof(*tag));
+    spinlock_acquire(&vm_ctx->dynalloc_lock);
+    if (align == 0) {
+        base = tlsf_malloc(vm_ctx->tlsf_ctx, sz + off);
+    } else {
+        base = tlsf_memalign(vm_ctx->tlsf_ctx, off, sz + off);
+    }
+    spinlock_release(&vm_ctx->dynalloc_lock);
+
+    if (base == NULL) {
+        return NULL;
+    }
+
+    tag = PTR_OFFSET(base, off - sizeof(*tag));
+    tag->size = sz;
+    tag->off = off;
+    tag->magic = DYNTAG_MAGIC;
+    dynprof_alloc(site, tag);
+    return PTR_OFFSET(base, off);
+}
+
+/*
+ * Free a block allocated by dynalloc_tagged()
+ */
+static void
+dynfree_tagged(void *ptr)
+{
+    struct vm_ctx *vm_ctx = vm_get_ctx();
+    struct dyntag *tag;
+    void *base;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    tag = PTR_NOFFSET(ptr, sizeof(*tag));
+    __assert(tag->magic == DYNTAG_MAGIC);
+    dynprof_free(tag);
+
+    tag->magic = 0;
+    base = PTR_NOFFSET(ptr, tag->off);
+    spinlock_acquire(&vm_ctx->dynalloc_lock);
+    tlsf_free(vm_ctx->tlsf_ctx, base);
+    spinlock_release(&vm_ctx->dynalloc_lock);
+}
+
+/*
+ * Fill in the usage of a call site summed across
+ * the tables of processors `cpu' and above.
+ */
+static void
+dynprof_sum(uintptr_t site, uint32_t cpu, struct dynalloc_site *dsp)
+{
+    struct dynprof_site *sp;
+    const char *name;
+    off_t off = 0;
+
+    memset(dsp, 0, sizeof(*dsp));
+    dsp->site = site;
+
+    for (uint32_t i = cpu; i < CPU_MAX; ++i) {
+        if (dynprof_tab[i] == NULL) {
+            continue;
+        }
+        if ((sp = dynprof_find(dynprof_tab[i], site)) == NULL) {
+            continue;
+        }
+
+        dsp->cur += sp->cur;
+        dsp->peak += sp->peak;
+        dsp->total += sp->total;
+        dsp->nalloc += sp->nalloc;
+        dsp->nfree += sp->nfree;
+    }
+
+    if ((name = ksyms_lookup(site, &off)) != NULL) {
+        memcpy(dsp->sym, name, MIN(strlen(name), DYNALLOC_SYMLEN - 1));
+        dsp->off = off;
+    }
+}
+
+/*
+ * Returns true if a call site is in the table of
+ * any processor below `cpu'.
+ */
+static bool
+dynprof_seen(uintptr_t site, uint32_t cpu)
+{
+    for (uint32_t i = 0; i < cpu; ++i) {
+        if (dynprof_tab[i] == NULL) {
+            continue;
+        }
+        if (dynprof_find(dynprof_tab[i], site) != NULL) {
+            return true;
+        }
+    }
+
+    return false;
+}
 
 /*
  * Dynamically allocates memory
@@ -41,6 +334,10 @@ dynalloc(size_t sz)
     struct vm_ctx *vm_ctx = vm_get_ctx();
     void *tmp;
 
+    if (DYNALLOC_PROF) {
+        return dynalloc_tagged(sz, 0, (uintptr_t)__builtin_return_address(0));
+    }
+
     spinlock_acquire(&vm_ctx->dynalloc_lock);
     tmp = tlsf_malloc(vm_ctx->tlsf_ctx, sz);
     spinlock_release(&vm_ctx->dynalloc_lock);
@@ -59,6 +356,11 @@ dynalloc_memalign(size_t sz, size_t align)
     struct vm_ctx *vm_ctx = vm_get_ctx();
     void *tmp;
 
+    if (DYNALLOC_PROF) {
+        return dynalloc_tagged(sz, align,
+            (uintptr_t)__builtin_return_address(0));
+    }
+
     spinlock_acquire(&vm_ctx->dynalloc_lock);
     tmp = tlsf_memalign(vm_ctx->tlsf_ctx, align, sz);
     spinlock_release(&vm_ctx->dynalloc_lock);
@@ -75,8 +377,27 @@ void *
 dynrealloc(void *old_ptr, size_t newsize)
 {
     struct vm_ctx *vm_ctx = vm_get_ctx();
+    struct dyntag *tag;
     void *tmp;
 
+    if (DYNALLOC_PROF) {
+        if (newsize == 0) {
+            dynfree_tagged(old_ptr);
+            return NULL;
+        }
+
+        tmp = dynalloc_tagged(newsize, 0,
+            (uintptr_t)__builtin_return_address(0));
+        if (tmp == NULL || old_ptr == NULL) {
+            return tmp;
+        }
+
+        tag = PTR_NOFFSET(old_ptr, sizeof(*tag));
+        memcpy(tmp, old_ptr, MIN(tag->size, newsize));
+        dynfree_tagged(old_ptr);
+        return tmp;
+    }
+
     spinlock_acquire(&vm_ctx->dynalloc_lock);
     tmp = tlsf_realloc(vm_ctx->tlsf_ctx, old_ptr, newsize);
     spinlock_release(&vm_ctx->dynalloc_lock);
@@ -93,7 +414,56 @@ dynfree(void *ptr)
 {
     struct vm_ctx *vm_ctx = vm_get_ctx();
 
+    if (DYNALLOC_PROF) {
+        dynfree_tagged(ptr);
+        return;
+    }
+
     spinlock_acquire(&vm_ctx->dynalloc_lock);
     tlsf_free(vm_ctx->tlsf_ctx, ptr);
     spinlock_release(&vm_ctx->dynalloc_lock);
 }
+
+/*
+ * Read back heap usage by call site
+ *
+ * @buf: Entries are written here
+ * @idx: Index of the first call site to return
+ * @max: Max number of entries to return
+ *
+ * Returns the number of entries written, always
+ * zero unless built with DYNALLOC_PROF.
+ */
+size_t
+dynalloc_prof_read(struct dynalloc_site *buf, size_t idx, size_t max)
+{
+    struct dynprof_site *tab, *sp;
+    size_t n = 0, nseen = 0;
+
+    if (!DYNALLOC_PROF) {
+        return 0;
+    }
+
+    for (uint32_t cpu = 0; cpu < CPU_MAX; ++cpu) {
+        if ((tab = dynprof_tab[cpu]) == NULL) {
+            continue;
+        }
+
+        for (size_t i = 0; i < DYNPROF_NSITE; ++i) {
+            sp = &tab[i];
+            if (sp->site == 0 || dynprof_seen(sp->site, cpu)) {
+                continue;
+            }
+            if (nseen++ < idx) {
+                continue;
+            }
+            if (n >= max) {
+                return n;
+            }
+
+            dynprof_sum(sp->site, cpu, &buf[n++]);
+        }
+    }
+
+    return n;
+}
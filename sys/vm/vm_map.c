@@ -31,6 +31,7 @@
 #include <sys/types.h>
 #include <sys/errno.h>
 #include <sys/proc.h>
+#include <sys/resource.h>
 #include <sys/systm.h>
 #include <sys/syscall.h>
 #include <sys/syslog.h>
@@ -80,7 +81,26 @@ mmap_add(struct proc *td, struct mmap_entry *ep)
 }
 
 /*
- * Remove memory mapping from mmap ledger
+ * Free an anonymous object along with its pages,
+ * device objects belong to their device.
+ *
+ * @obp: Object to free.
+ */
+static void
+mmap_obj_free(struct vm_object *obp)
+{
+    if (obp == NULL || obp->pgops != &vm_anonops) {
+        return;
+    }
+
+    if (vm_obj_release(obp) == 0) {
+        dynfree(obp);
+    }
+}
+
+/*
+ * Remove memory mapping from mmap ledger and
+ * free the memory behind it.
  *
  * @td: Process to remove mapping from.
  * @ep: Memory map entry to remove.
@@ -92,6 +112,7 @@ mmap_remove(struct proc *td, struct mmap_entry *ep)
 
     RBT_REMOVE(lgdr_entries, &lp->hd, ep);
     lp->nbytes -= ep->size;
+    mmap_obj_free(ep->obj);
     dynfree(ep);
 }
 
@@ -173,7 +194,6 @@ mmap(void *addr, size_t len, int prot, int flags, int fildes, off_t off)
     paddr_t pa;
     vaddr_t va;
     size_t misalign;
-    off_t page_off;
 
     misalign = len & (DEFAULT_PAGESIZE - 1);
     len = ALIGN_UP(len + misalign, DEFAULT_PAGESIZE);
@@ -187,6 +207,16 @@ mmap(void *addr, size_t len, int prot, int flags, int fildes, off_t off)
         return NULL;
     }
 
+    /*
+     * Keep within the address space limit, only
+     * mmap() mappings are counted against it, not
+     * program segments or the stack.
+     */
+    td = this_td();
+    if (rlim_check_inc(td, RLIMIT_AS, td->mlgdr->nbytes, len) < 0) {
+        return NULL;
+    }
+
     /*
      * Attempt to open the file if mapping
      * is shared.
@@ -242,6 +272,11 @@ mmap(void *addr, size_t len, int prot, int flags, int fildes, off_t off)
             return NULL;
         }
 
+        /* Video memory and such is best written combined */
+        if (ISSET(cdevp->flags, CDEV_MMAP_WC)) {
+            vm_set_cache(vas, va, VM_CACHE_WC, len);
+        }
+
         goto done;
     }
 
@@ -260,36 +295,37 @@ mmap(void *addr, size_t len, int prot, int flags, int fildes, off_t off)
         }
     }
 
-    /* XXX: Assuming private */
-    va = ALIGN_DOWN((vaddr_t)addr, DEFAULT_PAGESIZE);
-
-    for (int i = 0; i < npgs; ++i) {
-        pg = vm_pagealloc(map_obj, PALLOC_ZERO);
-        page_off = i * DEFAULT_PAGESIZE;
-
-        if (pg == NULL) {
-            /* TODO */
-            pr_error("mmap: failed to allocate page %d\n");
-            return NULL;
-        }
+    /*
+     * Back the mapping with one physically contiguous
+     * run. If `addr' is NULL the run is identity mapped,
+     * and as nobody else owns these frames the range
+     * cannot overlap any other identity mapping.
+     *
+     * XXX: Assuming private
+     * TODO: copy-on-write
+     */
+    pg = vm_pagealloc_contig(map_obj, npgs, PALLOC_ZERO);
+    if (pg == NULL) {
+        pr_error("mmap: failed to allocate %d pages\n", npgs);
+        mmap_obj_free(map_obj);
+        return NULL;
+    }
 
-        /* TODO: copy-on-write */
-        if (addr == NULL) {
-            va = pg->phys_addr;
-            addr = (void *)va;
-        }
+    pa = pg->phys_addr;
+    if (addr == NULL) {
+        addr = (void *)pa;
+    }
 
-        pa = pg->phys_addr;
-        error = vm_map(vas, va + page_off, pa, prot, len);
-        if (error < 0) {
-            pr_error("mmap: failed to map page (retval=%x)\n", error);
-            return NULL;
-        }
+    va = ALIGN_DOWN((vaddr_t)addr, DEFAULT_PAGESIZE);
+    error = vm_map(vas, va, pa, prot, len);
+    if (error < 0) {
+        pr_error("mmap: failed to map pages (retval=%x)\n", error);
+        mmap_obj_free(map_obj);
+        return NULL;
     }
 
 done:
     /* Add entry to ledger */
-    td = this_td();
     ep = dynalloc(sizeof(*ep));
     if (ep == NULL) {
         pr_error("mmap: failed to allocate mmap ledger entry\n");
@@ -305,7 +341,9 @@ done:
 
 /*
  * Remove mappings for entire pages that
- * belong to the current process.
+ * belong to the current process, the whole
+ * mapping starting at `addr' is removed and
+ * anonymous memory behind it is freed.
  *
  * XXX: POSIX munmap(3) requires `addr' to be page-aligned
  *      and will return -EINVAL if otherwise. However, with
@@ -326,9 +364,8 @@ munmap(void *addr, size_t len)
         return -EINVAL;
     }
 
-    /* Apply machine specific addr/len adjustments */
+    /* Apply machine specific addr adjustments */
     va = ALIGN_DOWN((vaddr_t)addr, DEFAULT_PAGESIZE);
-    len = ALIGN_UP(len, DEFAULT_PAGESIZE);
     pgno = va >> 12;
 
     td = this_td();
@@ -353,11 +390,33 @@ munmap(void *addr, size_t len)
         return -EINVAL;
     }
 
-    vm_unmap(vas, va, len);
+    vm_unmap(vas, res->va_start, res->size);
     mmap_remove(td, res);
     return 0;
 }
 
+/*
+ * Free what is left in the mmap ledger of a dead
+ * process, its address space is destroyed by the
+ * caller.
+ *
+ * @td: Process to release mappings of.
+ */
+void
+mmap_release(struct proc *td)
+{
+    struct mmap_entry *ep;
+    struct mmap_lgdr *lp;
+
+    if ((lp = td->mlgdr) == NULL) {
+        return;
+    }
+
+    while ((ep = RBT_MIN(lgdr_entries, &lp->hd)) != NULL) {
+        mmap_remove(td, ep);
+    }
+}
+
 /*
  * mmap() syscall
  *
@@ -449,6 +508,36 @@ vm_unmap(struct vas vas, vaddr_t va, size_t count)
     return vm_map_modify(vas, va, 0, 0, true, count);
 }
 
+/*
+ * Set the caching type of every page in a range
+ * that is already mapped.
+ *
+ * @vas: Address space.
+ * @va: Virtual address to start at.
+ * @type: Caching type (see VM_CACHE_*)
+ * @count: Bytes to cover (aligned to page granularity)
+ *
+ * Returns 0 on success, otherwise a non-zero value
+ * from pmap_set_cache() is passed back.
+ */
+int
+vm_set_cache(struct vas vas, vaddr_t va, int type, size_t count)
+{
+    size_t misalign = va & (DEFAULT_PAGESIZE - 1);
+    int error;
+
+    count = ALIGN_UP(count + misalign, DEFAULT_PAGESIZE);
+    va = ALIGN_DOWN(va, DEFAULT_PAGESIZE);
+
+    for (size_t i = 0; i < count; i += DEFAULT_PAGESIZE) {
+        if ((error = pmap_set_cache(vas, va + i, type)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Helper for tree(3) and the mmap ledger.
  */
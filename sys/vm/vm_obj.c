@@ -36,6 +36,7 @@ vm_obj_init(struct vm_object *obp, const struct vm_pagerops *pgops, int refs)
     if (obp == NULL || pgops == NULL)
         return -1;
 
+    obp->lock.lock = 0;
     obp->pgops = pgops;
     obp->refs = refs;
     obp->npages = 0;
@@ -43,9 +44,30 @@ vm_obj_init(struct vm_object *obp, const struct vm_pagerops *pgops, int refs)
     return 0;
 }
 
-void
+/*
+ * Drop a reference to an object, every page it
+ * holds is freed along with the last reference.
+ *
+ * Returns the number of references left, the object
+ * itself is up to whoever allocated it.
+ */
+int
 vm_obj_release(struct vm_object *obp)
 {
-    /* STUB */
-    (void)obp;
+    struct vm_page *pg;
+    int refs;
+
+    spinlock_acquire(&obp->lock);
+    if (obp->refs > 0) {
+        --obp->refs;
+    }
+
+    if ((refs = obp->refs) == 0) {
+        while ((pg = RBT_MIN(vm_objtree, &obp->objt)) != NULL) {
+            vm_pagefree(obp, pg, 0);
+        }
+    }
+
+    spinlock_release(&obp->lock);
+    return refs;
 }
@@ -67,8 +67,12 @@ vm_pagelookup(struct vm_object *obj, off_t off)
     return RBT_FIND(vm_objtree, &obj->objt, &tmp);
 }
 
-struct vm_page *
-vm_pagealloc(struct vm_object *obj, int flags)
+/*
+ * Create a page for the frame at `pa' and insert
+ * it into an object.
+ */
+static struct vm_page *
+vm_pagenew(struct vm_object *obj, paddr_t pa, int flags)
 {
     struct vm_page *tmp;
 
@@ -78,10 +82,9 @@ vm_pagealloc(struct vm_object *obj, int flags)
     }
 
     memset(tmp, 0, sizeof(*tmp));
-    tmp->phys_addr = vm_alloc_frame(1);
+    tmp->phys_addr = pa;
     tmp->flags |= (PG_VALID | PG_CLEAN);
     tmp->offset = tmp->phys_addr >> 12;
-    __assert(tmp->phys_addr != 0);
 
     if (ISSET(flags, PALLOC_ZERO)) {
         memset(PHYS_TO_VIRT(tmp->phys_addr), 0, DEFAULT_PAGESIZE);
@@ -91,6 +94,53 @@ vm_pagealloc(struct vm_object *obj, int flags)
     return tmp;
 }
 
+struct vm_page *
+vm_pagealloc(struct vm_object *obj, int flags)
+{
+    struct vm_page *tmp;
+    paddr_t pa;
+
+    pa = vm_alloc_frame(1);
+    __assert(pa != 0);
+
+    if ((tmp = vm_pagenew(obj, pa, flags)) == NULL) {
+        vm_free_frame(pa, 1);
+    }
+
+    return tmp;
+}
+
+/*
+ * Allocate `count' physically contiguous pages to
+ * an object.
+ *
+ * Returns the first page, the others follow it at
+ * increasing physical addresses.
+ */
+struct vm_page *
+vm_pagealloc_contig(struct vm_object *obj, size_t count, int flags)
+{
+    struct vm_page *first = NULL, *tmp;
+    paddr_t base, pa;
+
+    base = vm_alloc_frame(count);
+    __assert(base != 0);
+
+    for (size_t i = 0; i < count; ++i) {
+        pa = base + (i * DEFAULT_PAGESIZE);
+        if ((tmp = vm_pagenew(obj, pa, flags)) == NULL) {
+            vm_free_frame(pa, count - i);
+            return NULL;
+        }
+
+        if (first == NULL) {
+            first = tmp;
+        }
+    }
+
+    return first;
+}
+
 void
 vm_pagefree(struct vm_object *obj, struct vm_page *pg, int flags)
 {
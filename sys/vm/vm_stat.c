@@ -31,6 +31,7 @@
 #include <sys/errno.h>
 #include <fs/ctlfs.h>
 #include <vm/physmem.h>
+#include <vm/dynalloc.h>
 #include <vm/vm.h>
 #include <vm/stat.h>
 #include <string.h>
@@ -38,6 +39,7 @@
 #include <sys/syslog.h>
 
 static struct ctlops vm_stat_ctl;
+static struct ctlops vm_dynalloc_ctl;
 
 /*
  * ctlfs hook to read the virtual memory
@@ -62,6 +64,22 @@ vm_stat_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
     return sio->len;
 }
 
+/*
+ * ctlfs hook to read kernel heap usage by call
+ * site, one entry per site starting at the file
+ * offset.
+ */
+static int
+vm_dynalloc_read(struct ctlfs_dev *cdp, struct sio_txn *sio)
+{
+    size_t idx, max, n;
+
+    idx = sio->offset / sizeof(struct dynalloc_site);
+    max = sio->len / sizeof(struct dynalloc_site);
+    n = dynalloc_prof_read(sio->buf, idx, max);
+    return n * sizeof(struct dynalloc_site);
+}
+
 int
 vm_stat_get(struct vm_stat *vmstat)
 {
@@ -87,9 +105,18 @@ vm_stat_init(void)
     ctl.devname = devname;
     ctl.ops = &vm_stat_ctl;
     ctlfs_create_entry("stat", &ctl);
+
+    /* Register a heap profile control file */
+    ctl.ops = &vm_dynalloc_ctl;
+    ctlfs_create_entry("dynalloc", &ctl);
 }
 
 static struct ctlops vm_stat_ctl = {
     .read = vm_stat_read,
     .write = NULL
 };
+
+static struct ctlops vm_dynalloc_ctl = {
+    .read = vm_dynalloc_read,
+    .write = NULL
+};
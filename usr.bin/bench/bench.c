@@ -0,0 +1,945 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Microbenchmarks for hot library code, each one
+ * reports the cost of every implementation it has
+ * in TSC cycles per byte. Kernel paths such as spawn
+ * and signals are reported in cycles per operation
+ * instead, and graphics in megapixels per second.
+ */
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <sys/signal.h>
+#include <sys/spawn.h>
+#include <sys/wait.h>
+#include <crypto/chacha20.h>
+#include <crypto/sha256.h>
+#include <crc32.h>
+#include <libgfx/gfx.h>
+#include <libgfx/draw.h>
+#include <libgfx/text.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Bytes processed per run */
+#define BENCH_LEN   (64 * 1024)
+
+/* Runs per implementation, the fastest is kept */
+#define BENCH_RUNS  32
+
+/* Processes created by the spawn benchmark */
+#define SPAWN_RUNS  64
+#define SPAWN_PATH  "/usr/bin/bench"
+
+/* Signal round trips, and the ping and pong signals */
+#define SIGNAL_RUNS 1024
+#define SIG_PING    SIGRTMIN
+#define SIG_PONG    (SIGRTMIN + 1)
+
+/* Largest offset and length checked by the string self-test */
+#define STRING_ALIGN 16
+#define STRING_MAXLEN 320
+
+/* Live objects in the malloc benchmark, and its rounds */
+#define MALLOC_NOBJ 1024
+#define MALLOC_RUNS 16
+#define MALLOC_MAX  16384
+
+/* Offscreen surface size if there is no framebuffer */
+#define GFX_WIDTH   1024
+#define GFX_HEIGHT  768
+
+/* Widest line drawn by the text benchmark */
+#define TEXT_MAXCOLS 256
+
+/* Damaged squares per gfx_present() and their size */
+#define GFX_DAMAGE_N    8
+#define GFX_DAMAGE_SIZE 32
+
+struct bench {
+    const char *name;
+    void(*run)(void);
+};
+
+static uint8_t bench_buf[BENCH_LEN];
+static uint8_t bench_buf2[BENCH_LEN];
+
+static inline uint64_t
+bench_tsc(void)
+{
+    uint32_t lo, hi;
+
+    __asm__ volatile("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * Estimate the TSC frequency by sleeping for
+ * a tenth of a second.
+ */
+static uint64_t
+bench_tsc_hz(void)
+{
+    struct timespec ts = { 0, 100000000 };
+    uint64_t start;
+
+    start = bench_tsc();
+    sleep(&ts, NULL);
+    return (bench_tsc() - start) * 10;
+}
+
+/*
+ * Print a cycle count as cycles per byte with
+ * two decimal places.
+ */
+static void
+bench_report(const char *bench, const char *impl, uint64_t cycles, size_t len)
+{
+    uint64_t cpb100;
+
+    cpb100 = (cycles * 100) / len;
+    printf("%s/%s: %d.%02d cycles/byte\n", bench, impl,
+        cpb100 / 100, cpb100 % 100);
+}
+
+static void
+bench_chacha20(void)
+{
+    uint8_t key[32] = {0}, nonce[12] = {0};
+    uint32_t state[16];
+    uint64_t start, cycles, best;
+    int orig;
+
+    orig = chacha20_impl_get();
+    for (int impl = 0; impl < CHACHA20_NIMPL; ++impl) {
+        if (chacha20_impl_set(impl) < 0) {
+            printf("chacha20/%s: not supported\n", chacha20_impl_name(impl));
+            continue;
+        }
+
+        best = (uint64_t)-1;
+        for (int i = 0; i < BENCH_RUNS; ++i) {
+            chacha20_init(state, key, nonce, 0);
+            start = bench_tsc();
+            chacha20_encrypt(state, NULL, bench_buf, sizeof(bench_buf));
+            cycles = bench_tsc() - start;
+            if (cycles < best) {
+                best = cycles;
+            }
+        }
+
+        bench_report("chacha20", chacha20_impl_name(impl), best,
+            sizeof(bench_buf));
+    }
+
+    chacha20_impl_set(orig);
+}
+
+/*
+ * Time CRC-32 and CRC-32C over the bench buffer with
+ * each implementation.
+ */
+static void
+bench_crc32(void)
+{
+    uint32_t(*fn[2])(const void *, size_t) = { crc32, crc32c };
+    const char *name[2] = { "crc32", "crc32c" };
+    uint64_t start, cycles, best;
+    int orig;
+
+    orig = crc32_impl_get();
+    for (int i = 0; i < BENCH_LEN; ++i) {
+        bench_buf[i] = i * 31;
+    }
+
+    for (int f = 0; f < 2; ++f) {
+        for (int impl = 0; impl < CRC32_NIMPL; ++impl) {
+            if (crc32_impl_set(impl) < 0) {
+                printf("%s/%s: not supported\n", name[f],
+                    crc32_impl_name(impl));
+                continue;
+            }
+
+            best = (uint64_t)-1;
+            for (int i = 0; i < BENCH_RUNS; ++i) {
+                start = bench_tsc();
+                fn[f](bench_buf, sizeof(bench_buf));
+                cycles = bench_tsc() - start;
+                if (cycles < best) {
+                    best = cycles;
+                }
+            }
+
+            bench_report(name[f], crc32_impl_name(impl), best,
+                sizeof(bench_buf));
+        }
+    }
+
+    crc32_impl_set(orig);
+}
+
+/*
+ * FIPS 180-2 example messages and their digests,
+ * checked before an implementation is timed.
+ */
+static const char *sha256_msgs[] = {
+    "",
+    "abc",
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+    "abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+    "hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu"
+};
+
+static const char *sha256_digests[] = {
+    "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+    "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+    "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+    "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"
+};
+
+/*
+ * One million 'a' characters, hashed in chunks that
+ * span several blocks and end mid-block so both the
+ * multi-block and the partial block paths are run.
+ */
+#define SHA256_MILLION 1000000
+#define SHA256_MILLION_CHUNK 1000
+static const char *sha256_million_digest =
+    "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+
+static bool
+sha256_check(void)
+{
+    uint8_t chunk[SHA256_MILLION_CHUNK];
+    char hex[SHA256_HEX_SIZE];
+    struct sha256 sha;
+
+    for (size_t i = 0; i < NELEM(sha256_msgs); ++i) {
+        sha256_hex(sha256_msgs[i], strlen(sha256_msgs[i]), hex);
+        if (strcmp(hex, sha256_digests[i]) != 0) {
+            return false;
+        }
+    }
+
+    memset(chunk, 'a', sizeof(chunk));
+    sha256_init(&sha);
+    for (size_t i = 0; i < SHA256_MILLION; i += sizeof(chunk)) {
+        sha256_update(&sha, chunk, sizeof(chunk));
+    }
+
+    sha256_finalize_hex(&sha, hex);
+    return strcmp(hex, sha256_million_digest) == 0;
+}
+
+static void
+bench_sha256(void)
+{
+    uint8_t digest[SHA256_BYTES_SIZE];
+    uint64_t start, cycles, best;
+    struct sha256 sha;
+    int orig;
+
+    orig = sha256_impl_get();
+    for (int impl = 0; impl < SHA256_NIMPL; ++impl) {
+        if (sha256_impl_set(impl) < 0) {
+            printf("sha256/%s: not supported\n", sha256_impl_name(impl));
+            continue;
+        }
+
+        if (!sha256_check()) {
+            printf("sha256/%s: failed test vectors\n",
+                sha256_impl_name(impl));
+            continue;
+        }
+
+        best = (uint64_t)-1;
+        for (int i = 0; i < BENCH_RUNS; ++i) {
+            start = bench_tsc();
+            sha256_init(&sha);
+            sha256_update(&sha, bench_buf, sizeof(bench_buf));
+            sha256_final(&sha, digest);
+            cycles = bench_tsc() - start;
+            if (cycles < best) {
+                best = cycles;
+            }
+        }
+
+        bench_report("sha256", sha256_impl_name(impl), best,
+            sizeof(bench_buf));
+    }
+
+    sha256_impl_set(orig);
+}
+
+/*
+ * Spawn a copy of ourselves that exits right away and
+ * wait for it, measuring the full spawn + exit + reap
+ * round trip.
+ */
+static void
+bench_spawn(void)
+{
+    char *argv[] = { SPAWN_PATH, "-n", NULL };
+    char *envp[] = { NULL };
+    uint64_t start, cycles, best = (uint64_t)-1;
+    uint64_t total = 0;
+    pid_t child;
+    int status;
+
+    for (int i = 0; i < SPAWN_RUNS; ++i) {
+        start = bench_tsc();
+        child = spawn(SPAWN_PATH, argv, envp, 0);
+        if (child < 0) {
+            printf("spawn: could not spawn %s\n", SPAWN_PATH);
+            return;
+        }
+
+        waitpid(child, &status, 0);
+        cycles = bench_tsc() - start;
+        total += cycles;
+        best = MIN(best, cycles);
+    }
+
+    printf("spawn/wait: %d cycles best, %d cycles avg\n", best,
+        total / SPAWN_RUNS);
+}
+
+/*
+ * Wait for `signo' and return the value it carried.
+ */
+static int
+signal_wait(int signo)
+{
+    sigset_t set;
+    siginfo_t info;
+
+    sigemptyset(&set);
+    sigaddset(&set, signo);
+    if (sigwaitinfo(&set, &info) < 0) {
+        return -1;
+    }
+
+    return info.si_value.sival_int;
+}
+
+/*
+ * Child side of the signal benchmark, echo each ping
+ * back to the parent until told to stop.
+ */
+static int
+signal_child(void)
+{
+    union sigval value;
+    pid_t ppid;
+
+    ppid = getppid();
+    value.sival_int = 0;
+    sigqueue(ppid, SIG_PONG, value);
+
+    for (;;) {
+        value.sival_int = signal_wait(SIG_PING);
+        if (value.sival_int < 0) {
+            break;
+        }
+        sigqueue(ppid, SIG_PONG, value);
+    }
+
+    return 0;
+}
+
+/*
+ * Bounce a queued realtime signal between us and a
+ * child, measuring the send + wakeup round trip.
+ */
+static void
+bench_signal(void)
+{
+    char *argv[] = { SPAWN_PATH, "-s", NULL };
+    char *envp[] = { NULL };
+    union sigval value;
+    uint64_t start, cycles;
+    pid_t child;
+    int status;
+
+    child = spawn(SPAWN_PATH, argv, envp, 0);
+    if (child < 0) {
+        printf("signal: could not spawn %s\n", SPAWN_PATH);
+        return;
+    }
+
+    /* Wait for the child to come up */
+    signal_wait(SIG_PONG);
+
+    start = bench_tsc();
+    for (int i = 0; i < SIGNAL_RUNS; ++i) {
+        value.sival_int = i;
+        sigqueue(child, SIG_PING, value);
+        if (signal_wait(SIG_PONG) != i) {
+            printf("signal: bad value in round trip %d\n", i);
+            break;
+        }
+    }
+    cycles = bench_tsc() - start;
+
+    value.sival_int = -1;
+    sigqueue(child, SIG_PING, value);
+    waitpid(child, &status, 0);
+    printf("signal/rt: %d cycles/round trip\n", cycles / SIGNAL_RUNS);
+}
+
+static inline int
+sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+/*
+ * Check the string routines against byte at a time
+ * references for every alignment of source and dest
+ * and every length up to STRING_MAXLEN.
+ *
+ * Returns the number of failures.
+ */
+static int
+string_check(void)
+{
+    static uint8_t a[STRING_ALIGN + STRING_MAXLEN + 1];
+    static uint8_t b[STRING_ALIGN + STRING_MAXLEN + 1];
+    uint8_t *src, *dst, want;
+    size_t n, i;
+    int order, errors = 0;
+
+    for (int sa = 0; sa < STRING_ALIGN; ++sa)
+    for (int da = 0; da < STRING_ALIGN; ++da)
+    for (n = 0; n < STRING_MAXLEN && errors < 8; ++n) {
+        src = a + sa;
+        dst = b + da;
+
+        /* Nonzero pattern, zero bytes are placed by hand */
+        for (i = 0; i < sizeof(a); ++i) {
+            a[i] = (i % 255) + 1;
+        }
+
+        memset(b, 0xEE, sizeof(b));
+        memcpy(dst, src, n);
+        for (i = 0; i < sizeof(b); ++i) {
+            want = (i >= (size_t)da && i < da + n) ? src[i - da] : 0xEE;
+            if (b[i] != want) {
+                printf("string: memcpy(%d, %d, %d) failed\n", da, sa, n);
+                ++errors;
+                break;
+            }
+        }
+
+        memset(dst, sa, n);
+        for (i = 0; i < sizeof(b); ++i) {
+            want = (i >= (size_t)da && i < da + n) ? sa : 0xEE;
+            if (b[i] != want) {
+                printf("string: memset(%d, %d) failed\n", da, n);
+                ++errors;
+                break;
+            }
+        }
+
+        /* Flip one byte, memcmp() must see it and order it */
+        memcpy(dst, src, n);
+        if (n > 0) {
+            dst[n / 2] ^= 0x80;
+        }
+        order = (n > 0) ? sign(src[n / 2] - dst[n / 2]) : 0;
+        if (sign(memcmp(src, dst, n)) != order) {
+            printf("string: memcmp(%d, %d, %d) failed\n", sa, da, n);
+            ++errors;
+        }
+
+        /* Only the last byte matches */
+        if (n > 0) {
+            src[n - 1] = '\0';
+            if (memchr(src, 0, n) != &src[n - 1]) {
+                printf("string: memchr(%d, %d) failed\n", sa, n);
+                ++errors;
+            }
+            if (memchr(src, 0, n - 1) != NULL) {
+                printf("string: memchr(%d, %d) failed\n", sa, n - 1);
+                ++errors;
+            }
+            if (strlen((char *)src) != n - 1) {
+                printf("string: strlen(%d, %d) failed\n", sa, n - 1);
+                ++errors;
+            }
+
+            /* Same string, then one that sorts after */
+            memcpy(dst, src, n);
+            if (strcmp((char *)src, (char *)dst) != 0) {
+                printf("string: strcmp(%d, %d, %d) failed\n", sa, da, n);
+                ++errors;
+            }
+            if (n > 1) {
+                src[n - 2] = 0xFE;
+                dst[n - 2] = 0xFF;
+                if (strcmp((char *)src, (char *)dst) >= 0) {
+                    printf("string: strcmp(%d, %d, %d) failed\n", sa, da, n);
+                    ++errors;
+                }
+            }
+        }
+    }
+
+    return errors;
+}
+
+/*
+ * Check the string routines, then report how fast
+ * each one chews through the whole buffer.
+ */
+static void
+bench_string(void)
+{
+    const char *name[5] = { "memcpy", "memset", "memcmp", "memchr", "strlen" };
+    uint64_t start, cycles, best;
+    volatile uintptr_t sink = 0;
+
+    if (string_check() != 0) {
+        return;
+    }
+
+    memset(bench_buf, 'a', sizeof(bench_buf));
+    bench_buf[sizeof(bench_buf) - 1] = '\0';
+    for (int i = 0; i < 5; ++i) {
+        best = (uint64_t)-1;
+        for (int j = 0; j < BENCH_RUNS; ++j) {
+            start = bench_tsc();
+            switch (i) {
+            case 0:
+                memcpy(bench_buf2, bench_buf, sizeof(bench_buf));
+                break;
+            case 1:
+                memset(bench_buf2, 'a', sizeof(bench_buf2));
+                break;
+            case 2:
+                sink += memcmp(bench_buf, bench_buf2, sizeof(bench_buf));
+                break;
+            case 3:
+                sink += (uintptr_t)memchr(bench_buf, 'b', sizeof(bench_buf));
+                break;
+            case 4:
+                sink += strlen((char *)bench_buf);
+                break;
+            }
+
+            cycles = bench_tsc() - start;
+            best = MIN(best, cycles);
+        }
+
+        bench_report("string", name[i], best, sizeof(bench_buf));
+    }
+}
+
+/*
+ * Allocate and free MALLOC_NOBJ objects of `size' bytes
+ * (or random sizes up to MALLOC_MAX if zero), the mixed
+ * run frees in a scattered order to fragment the heap.
+ *
+ * Returns the cycles taken, zero if a check failed.
+ */
+static uint64_t
+malloc_round(size_t size)
+{
+    static uint8_t *objs[MALLOC_NOBJ];
+    static size_t lens[MALLOC_NOBJ];
+    uint64_t start;
+    uint32_t seed = 1;
+    size_t j;
+
+    start = bench_tsc();
+    for (size_t i = 0; i < MALLOC_NOBJ; ++i) {
+        seed = seed * 1103515245 + 12345;
+        lens[i] = (size != 0) ? size : (seed >> 8) % MALLOC_MAX + 1;
+        if ((objs[i] = malloc(lens[i])) == NULL) {
+            printf("malloc: out of memory at object %d\n", i);
+            return 0;
+        }
+
+        objs[i][0] = i;
+        objs[i][lens[i] - 1] = i;
+    }
+
+    for (size_t i = 0; i < MALLOC_NOBJ; ++i) {
+        /* Scatter the frees for mixed sizes */
+        j = (size != 0) ? i : (i * 7) % MALLOC_NOBJ;
+        if (objs[j][0] != (uint8_t)j || objs[j][lens[j] - 1] != (uint8_t)j) {
+            printf("malloc: object %d was overwritten\n", j);
+            return 0;
+        }
+        free(objs[j]);
+    }
+
+    return bench_tsc() - start;
+}
+
+/*
+ * Allocation storms of one small size and of mixed
+ * sizes, the latter mostly spanning slab classes with
+ * some large mappings.
+ */
+static void
+bench_malloc(void)
+{
+    const char *name[2] = { "storm", "mixed" };
+    const size_t size[2] = { 64, 0 };
+    uint64_t cycles, best;
+
+    for (int i = 0; i < 2; ++i) {
+        best = (uint64_t)-1;
+        for (int j = 0; j < MALLOC_RUNS; ++j) {
+            if ((cycles = malloc_round(size[i])) == 0) {
+                return;
+            }
+            best = MIN(best, cycles);
+        }
+
+        printf("malloc/%s: %d cycles/op\n", name[i],
+            best / (MALLOC_NOBJ * 2));
+    }
+}
+
+static void
+gfx_report(const char *impl, uint64_t cycles, uint64_t npix, uint64_t hz)
+{
+    printf("gfx/%s: %d Mpixels/s\n", impl, (npix * hz) / cycles / 1000000);
+}
+
+/*
+ * Get a context for the graphics benchmarks, falling
+ * back to an offscreen surface if there is no
+ * framebuffer.
+ *
+ * Returns 1 for the framebuffer, 0 for offscreen and
+ * a less than zero value if neither worked.
+ */
+static int
+gfx_open(struct gfx_ctx *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+    if (gfx_init(ctx) == 0) {
+        return 1;
+    }
+
+    ctx->fbdev.width = GFX_WIDTH;
+    ctx->fbdev.height = GFX_HEIGHT;
+    ctx->fbdev.pitch = GFX_WIDTH * sizeof(pixel_t);
+    ctx->fbdev.bpp = 32;
+    ctx->fb_size = GFX_HEIGHT * ctx->fbdev.pitch;
+    ctx->io = malloc(ctx->fb_size);
+    if (ctx->io == NULL) {
+        printf("gfx: out of memory\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+gfx_close(struct gfx_ctx *ctx, bool fb)
+{
+    if (fb) {
+        gfx_cleanup(ctx);
+    } else {
+        free(ctx->io);
+    }
+}
+
+/*
+ * Fill the whole screen and move half of it around,
+ * in both directions so both orders of the scanline
+ * walk are covered.
+ */
+static void
+bench_gfx(void)
+{
+    struct gfx_shape shape = GFX_SHAPE_DEFAULT;
+    struct gfx_region r;
+    struct gfx_ctx ctx, ram;
+    uint64_t start, hz, best[6];
+    dimm_t w, h;
+    int fb;
+
+    if ((fb = gfx_open(&ctx)) < 0) {
+        return;
+    }
+
+    w = ctx.fbdev.width;
+    h = ctx.fbdev.height;
+    shape.width = w;
+    shape.height = h;
+    r.width = w / 2;
+    r.height = h / 2;
+
+    best[0] = best[1] = best[2] = (uint64_t)-1;
+    for (int i = 0; i < BENCH_RUNS; ++i) {
+        shape.color = i * 0x010203;
+        start = bench_tsc();
+        gfx_draw_shape(&ctx, &shape);
+        best[0] = MIN(best[0], bench_tsc() - start);
+
+        r.x = r.y = 0;
+        start = bench_tsc();
+        gfx_copy_region(&ctx, &r, w / 4, h / 4);
+        best[1] = MIN(best[1], bench_tsc() - start);
+
+        r.x = w / 4;
+        r.y = h / 4;
+        start = bench_tsc();
+        gfx_copy_region(&ctx, &r, 0, 0);
+        best[2] = MIN(best[2], bench_tsc() - start);
+    }
+
+    /*
+     * Presenting from a back buffer, once for the whole
+     * screen and once for a handful of small damaged
+     * squares. Only possible with a real framebuffer.
+     */
+    best[3] = best[4] = (uint64_t)-1;
+    if (fb && gfx_backbuf(&ctx) == 0) {
+        shape.width = GFX_DAMAGE_SIZE;
+        shape.height = GFX_DAMAGE_SIZE;
+        for (int i = 0; i < BENCH_RUNS; ++i) {
+            gfx_mark_dirty(&ctx, 0, 0, w, h);
+            start = bench_tsc();
+            gfx_present(&ctx);
+            best[3] = MIN(best[3], bench_tsc() - start);
+
+            for (int j = 0; j < GFX_DAMAGE_N; ++j) {
+                shape.x = (j * 97 + i * 13) % (w - GFX_DAMAGE_SIZE);
+                shape.y = (j * 61 + i * 7) % (h - GFX_DAMAGE_SIZE);
+                gfx_draw_shape(&ctx, &shape);
+            }
+            start = bench_tsc();
+            gfx_present(&ctx);
+            best[4] = MIN(best[4], bench_tsc() - start);
+        }
+    }
+
+    /*
+     * The same fill into system memory. How close "fill"
+     * gets to this shows what the memory type of the
+     * framebuffer mapping costs.
+     */
+    best[5] = (uint64_t)-1;
+    ram = ctx;
+    ram.flags = 0;
+    if (fb && (ram.io = malloc(ctx.fb_size)) != NULL) {
+        shape.x = shape.y = 0;
+        shape.width = w;
+        shape.height = h;
+        for (int i = 0; i < BENCH_RUNS; ++i) {
+            shape.color = i * 0x030201;
+            start = bench_tsc();
+            gfx_draw_shape(&ram, &shape);
+            best[5] = MIN(best[5], bench_tsc() - start);
+        }
+        free(ram.io);
+    }
+
+    hz = bench_tsc_hz();
+    printf("gfx: %dx%d %s\n", w, h, fb ? "framebuffer" : "offscreen");
+    gfx_report("fill", best[0], w * h, hz);
+    if (best[5] != (uint64_t)-1) {
+        gfx_report("fill-ram", best[5], w * h, hz);
+    }
+    gfx_report("blit-down", best[1], r.width * r.height, hz);
+    gfx_report("blit-up", best[2], r.width * r.height, hz);
+    if (best[3] != (uint64_t)-1) {
+        gfx_report("present", best[3], w * h, hz);
+        gfx_report("present-damage", best[4],
+            GFX_DAMAGE_N * GFX_DAMAGE_SIZE * GFX_DAMAGE_SIZE, hz);
+    }
+
+    gfx_close(&ctx, fb);
+}
+
+/*
+ * A character drawn the way kfgwm used to, a pixel
+ * at a time straight from the font bitmap.
+ */
+static void
+text_putc_bits(struct gfx_ctx *ctx, scrpos_t x, scrpos_t y, char ch,
+    color_t fg, color_t bg)
+{
+    const uint8_t *glyph;
+    size_t idx;
+
+    glyph = &g_GFX_FONT[(uint8_t)ch * GFX_FONT_HEIGHT];
+    for (uint32_t cy = 0; cy < GFX_FONT_HEIGHT; ++cy) {
+        idx = gfx_io_index(ctx, x + (GFX_FONT_WIDTH - 1), y + cy);
+        for (uint32_t cx = 0; cx < GFX_FONT_WIDTH; ++cx) {
+            ctx->io[idx--] = ISSET(glyph[cy], BIT(cx)) ? fg : bg;
+        }
+    }
+}
+
+/*
+ * Fill the screen with text, once a pixel at a time
+ * and once through gfx_draw_text(), with the colors
+ * changing every run so the glyph cache has to warm
+ * up again.
+ */
+static void
+bench_text(void)
+{
+    struct gfx_ctx ctx;
+    struct gfx_text text;
+    char line[TEXT_MAXCOLS];
+    uint64_t start, hz, best[2];
+    size_t ncols, nrows, nchars;
+    color_t fg, bg;
+    int fb;
+
+    if ((fb = gfx_open(&ctx)) < 0) {
+        return;
+    }
+
+    ncols = MIN(ctx.fbdev.width / GFX_FONT_WIDTH, TEXT_MAXCOLS);
+    nrows = ctx.fbdev.height / GFX_FONT_HEIGHT;
+    nchars = ncols * nrows;
+    if (nchars == 0) {
+        gfx_close(&ctx, fb);
+        return;
+    }
+
+    for (size_t i = 0; i < ncols; ++i) {
+        line[i] = ' ' + (i % 95);
+    }
+
+    best[0] = best[1] = (uint64_t)-1;
+    for (int i = 0; i < BENCH_RUNS; ++i) {
+        fg = 0xF2E5BC ^ i;
+        bg = 0x1D2021 ^ i;
+
+        start = bench_tsc();
+        for (size_t row = 0; row < nrows; ++row) {
+            for (size_t col = 0; col < ncols; ++col) {
+                text_putc_bits(&ctx, col * GFX_FONT_WIDTH,
+                    row * GFX_FONT_HEIGHT, line[(col + row) % ncols],
+                    fg, bg);
+            }
+        }
+        best[0] = MIN(best[0], bench_tsc() - start);
+
+        text.text = line;
+        text.len = ncols;
+        text.x = 0;
+        text.fg = fg;
+        text.bg = bg;
+        start = bench_tsc();
+        for (size_t row = 0; row < nrows; ++row) {
+            text.y = row * GFX_FONT_HEIGHT;
+            gfx_draw_text(&ctx, &text);
+        }
+        best[1] = MIN(best[1], bench_tsc() - start);
+    }
+
+    hz = bench_tsc_hz();
+    printf("text: %dx%d characters, %s\n", ncols, nrows,
+        fb ? "framebuffer" : "offscreen");
+    printf("text/bits: %d Kchars/s\n", (nchars * hz) / best[0] / 1000);
+    printf("text/glyphs: %d Kchars/s\n", (nchars * hz) / best[1] / 1000);
+    gfx_close(&ctx, fb);
+}
+
+static struct bench benches[] = {
+    { "chacha20", bench_chacha20 },
+    { "crc32", bench_crc32 },
+    { "sha256", bench_sha256 },
+    { "spawn", bench_spawn },
+    { "signal", bench_signal },
+    { "malloc", bench_malloc },
+    { "string", bench_string },
+    { "gfx", bench_gfx },
+    { "text", bench_text }
+};
+
+static void
+help(void)
+{
+    printf(
+        "bench: usage: bench [name]...\n"
+        "with no names, every benchmark is run\n"
+        "benchmarks:\n"
+    );
+
+    for (size_t i = 0; i < NELEM(benches); ++i) {
+        printf("   %s\n", benches[i].name);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    bool found;
+
+    /* Used as the child by the spawn and signal benchmarks */
+    if (argc == 2 && strcmp(argv[1], "-n") == 0) {
+        return 0;
+    }
+    if (argc == 2 && strcmp(argv[1], "-s") == 0) {
+        return signal_child();
+    }
+
+    if (argc < 2) {
+        for (size_t i = 0; i < NELEM(benches); ++i) {
+            benches[i].run();
+        }
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        found = false;
+        for (size_t j = 0; j < NELEM(benches); ++j) {
+            if (strcmp(argv[i], benches[j].name) == 0) {
+                benches[j].run();
+                found = true;
+            }
+        }
+
+        if (!found) {
+            help();
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/ktrace.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define KTRACE_BUF   "/ctl/ktrace/buf"
+#define SYSCALL_STAT "/ctl/syscall/stat"
+
+#define KDUMP_FLAGS "p:shr"
+#define NREC 32
+
+static const char *scname[] = {
+    [SYS_none] = "none",
+    [SYS_exit] = "exit",
+    [SYS_open] = "open",
+    [SYS_read] = "read",
+    [SYS_close] = "close",
+    [SYS_stat] = "stat",
+    [SYS_sysctl] = "sysctl",
+    [SYS_write] = "write",
+    [SYS_spawn] = "spawn",
+    [SYS_reboot] = "reboot",
+    [SYS_mmap] = "mmap",
+    [SYS_munmap] = "munmap",
+    [SYS_access] = "access",
+    [SYS_lseek] = "lseek",
+    [SYS_sleep] = "sleep",
+    [SYS_inject] = "inject",
+    [SYS_getpid] = "getpid",
+    [SYS_getppid] = "getppid",
+    [SYS_setuid] = "setuid",
+    [SYS_getuid] = "getuid",
+    [SYS_waitpid] = "waitpid",
+    [SYS_socket] = "socket",
+    [SYS_bind] = "bind",
+    [SYS_recv] = "recv",
+    [SYS_send] = "send",
+    [SYS_sendmsg] = "sendmsg",
+    [SYS_recvmsg] = "recvmsg",
+    [SYS_connect] = "connect",
+    [SYS_setsockopt] = "setsockopt",
+    [SYS_disk] = "disk",
+    [SYS_getrandom] = "getrandom",
+    [SYS_kill] = "kill",
+    [SYS_sigqueue] = "sigqueue",
+    [SYS_sigwaitinfo] = "sigwaitinfo",
+    [SYS_getrlimit] = "getrlimit",
+    [SYS_setrlimit] = "setrlimit"
+};
+
+static void
+help(void)
+{
+    printf(
+        "kdump: usage: kdump [flags]\n"
+        "flags:\n"
+        "   [-p pid] Only dump records from a process\n"
+        "   [-s] Print per-syscall statistics\n"
+        "   [-h] Include latency histograms with -s\n"
+        "   [-r] Reset per-syscall statistics\n"
+        "with no flags, ktrace records are dumped\n"
+    );
+}
+
+static const char *
+syscall_name(uint16_t scnum)
+{
+    if (scnum >= NELEM(scname) || scname[scnum] == NULL) {
+        return "unknown";
+    }
+
+    return scname[scnum];
+}
+
+/*
+ * Print a 64-bit value in decimal, printf()
+ * only takes an int for '%d'.
+ */
+static void
+print_u64(const char *prefix, uint64_t v)
+{
+    char buf[24];
+
+    itoa(v, buf, 10);
+    printf("%s%s", prefix, buf);
+}
+
+static void
+print_rec(const struct ktr_rec *rp)
+{
+    printf("%d cpu%d %s", rp->pid, rp->cpu, syscall_name(rp->scnum));
+    if (rp->type == KTR_CALL) {
+        printf(" CALL(%p, %p, %p, %p)\n", rp->arg[0], rp->arg[1],
+            rp->arg[2], rp->arg[3]);
+        return;
+    }
+
+    printf(" RET %d", (int)rp->ret);
+    print_u64(" cycles=", rp->cycles);
+    printf("\n");
+}
+
+static int
+dump(int pid)
+{
+    struct ktr_rec buf[NREC];
+    ssize_t len;
+    size_t n;
+    int fd;
+
+    if ((fd = open(KTRACE_BUF, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", KTRACE_BUF);
+        return fd;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        n = len / sizeof(struct ktr_rec);
+        for (size_t i = 0; i < n; ++i) {
+            if (pid >= 0 && buf[i].pid != (uint32_t)pid)
+                continue;
+
+            print_rec(&buf[i]);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+static void
+print_hist(const struct syscall_stat *sp)
+{
+    for (size_t i = 0; i < SYSCALL_NHIST; ++i) {
+        if (sp->hist[i] == 0) {
+            continue;
+        }
+
+        if (i == 0) {
+            printf("    < 2^%d cycles", SYSCALL_HSHIFT + 1);
+        } else if (i == SYSCALL_NHIST - 1) {
+            printf("    >= 2^%d cycles", SYSCALL_HSHIFT + i);
+        } else {
+            printf("    2^%d cycles", SYSCALL_HSHIFT + i);
+        }
+        print_u64(": ", sp->hist[i]);
+        printf("\n");
+    }
+}
+
+/*
+ * Print statistics for every syscall that
+ * has been made at least once.
+ */
+static int
+print_stats(bool hist)
+{
+    struct syscall_stat st;
+    uint16_t scnum = 0;
+    int fd;
+
+    if ((fd = open(SYSCALL_STAT, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", SYSCALL_STAT);
+        return fd;
+    }
+
+    printf("syscall       calls / total cycles / avg / max\n");
+    while (read(fd, &st, sizeof(st)) == sizeof(st)) {
+        if (st.calls == 0) {
+            ++scnum;
+            continue;
+        }
+
+        printf("%s (%d):", syscall_name(scnum), scnum);
+        print_u64(" ", st.calls);
+        print_u64(" / ", st.cycles);
+        print_u64(" / ", st.cycles / st.calls);
+        print_u64(" / ", st.max);
+        printf("\n");
+        if (hist) {
+            print_hist(&st);
+        }
+        ++scnum;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int
+reset_stats(void)
+{
+    char dummy = 0;
+    int fd;
+
+    if ((fd = open(SYSCALL_STAT, O_RDWR)) < 0) {
+        printf("failed to open %s\n", SYSCALL_STAT);
+        return fd;
+    }
+
+    write(fd, &dummy, sizeof(dummy));
+    close(fd);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool do_stat = false, hist = false;
+    int c, pid = -1;
+
+    while ((c = getopt(argc, argv, KDUMP_FLAGS)) != -1) {
+        switch (c) {
+        case 'p':
+            pid = atoi(optarg);
+            break;
+        case 's':
+            do_stat = true;
+            break;
+        case 'h':
+            hist = true;
+            break;
+        case 'r':
+            return reset_stats();
+        default:
+            help();
+            return -1;
+        }
+    }
+
+    if (do_stat) {
+        return print_stats(hist);
+    }
+
+    return dump(pid);
+}
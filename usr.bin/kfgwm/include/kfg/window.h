@@ -31,6 +31,7 @@
 #define KFG_WINDOW_H_
 
 #include <kfg/types.h>
+#include <libgfx/gfx.h>
 
 #define KFG_RED 0x6E0C24
 #define KFG_YELLOW 0xF0A401
@@ -44,15 +45,43 @@
 #define KFG_BORDER_HEIGHT 1
 #define KFG_TITLE_HEIGHT 10
 
+/*
+ * A rectangle, an empty one has zero width
+ * or height.
+ */
+struct kfg_rect {
+    kfgpos_t x;
+    kfgpos_t y;
+    kfgdim_t width;
+    kfgdim_t height;
+};
+
+/*
+ * A window draws into its own surface and records
+ * what changed in `damage'. Only damaged parts that
+ * no window above covers reach the screen when the
+ * root is composited.
+ *
+ * @gfx: Screen, shared by every window
+ * @surf: Window contents (unused for the root)
+ * @damage: Changed area in window coordinates
+ * @parent: Window this one sits in
+ * @children: Child windows, bottom of the stack first
+ * @next: Next sibling, higher in the stack
+ */
 struct kfg_window {
     kfgpos_t x;
     kfgpos_t y;
     kfgdim_t width;
     kfgdim_t height;
-    kfgdim_t fb_pitch;
     kfgpixel_t bg;
     kfgpixel_t border_bg;
-    kfgpixel_t *framebuf;
+    struct gfx_ctx *gfx;
+    struct gfx_ctx surf;
+    struct kfg_rect damage;
+    struct kfg_window *parent;
+    struct kfg_window *children;
+    struct kfg_window *next;
 };
 
 struct kfg_text {
@@ -65,4 +94,7 @@ struct kfg_window *kfg_win_new(struct kfg_window *parent, kfgpos_t x, kfgpos_t y
 int kfg_win_draw(struct kfg_window *parent, struct kfg_window *wp);
 int kfg_win_putstr(struct kfg_window *wp, struct kfg_text *tp);
 
+void kfg_win_damage(struct kfg_window *wp, const struct kfg_rect *r);
+int kfg_win_composite(struct kfg_window *root);
+
 #endif  /* !KFG_WINDOW_H_ */
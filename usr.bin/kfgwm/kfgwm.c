@@ -27,17 +27,15 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <sys/mman.h>
 #include <sys/types.h>
-#include <sys/fbdev.h>
+#include <sys/errno.h>
 #include <kfg/window.h>
-#include <fcntl.h>
+#include <libgfx/gfx.h>
 #include <stddef.h>
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
 
-static struct fbattr fbattr;
-static uint32_t *framep;
+static struct gfx_ctx gfx;
 
 static void
 test_win(struct kfg_window *root, kfgpos_t x, kfgpos_t y, const char *str)
@@ -45,7 +43,10 @@ test_win(struct kfg_window *root, kfgpos_t x, kfgpos_t y, const char *str)
     struct kfg_text text;
     struct kfg_window *test_win;
 
-    test_win = kfg_win_new(root, x, y);
+    if ((test_win = kfg_win_new(root, x, y)) == NULL) {
+        return;
+    }
+
     text.text = str;
     text.x = 0;
     text.y = 0;
@@ -57,39 +58,29 @@ test_win(struct kfg_window *root, kfgpos_t x, kfgpos_t y, const char *str)
 int
 main(void)
 {
-    int fb_fd, fbattr_fd, prot;
-    size_t fb_size;
     struct kfg_window *root_win;
+    int error;
 
-    fb_fd = open("/dev/fb0", O_RDWR);
-    if (fb_fd < 0) {
-        return fb_fd;
+    if ((error = gfx_init(&gfx)) < 0) {
+        return error;
     }
 
-    fbattr_fd = open("/ctl/fb0/attr", O_RDONLY);
-    if (fbattr_fd < 0) {
-        close(fb_fd);
-        return fbattr_fd;
+    if ((root_win = malloc(sizeof(*root_win))) == NULL) {
+        gfx_cleanup(&gfx);
+        return -ENOMEM;
     }
 
-    read(fbattr_fd, &fbattr, sizeof(fbattr));
-    close(fbattr_fd);
-
-    fb_size = fbattr.height * fbattr.pitch;
-    prot = PROT_READ | PROT_WRITE;
-    framep = mmap(NULL, fb_size, prot, MAP_SHARED, fb_fd, 0);
-
-    root_win = malloc(sizeof(*root_win));
+    memset(root_win, 0, sizeof(*root_win));
     root_win->x = 0;
     root_win->y = 0;
-    root_win->width = fbattr.width;
-    root_win->height = fbattr.height;
-    root_win->fb_pitch = fbattr.pitch;
-    root_win->framebuf = framep;
+    root_win->width = gfx.fbdev.width;
+    root_win->height = gfx.fbdev.height;
+    root_win->gfx = &gfx;
     root_win->bg = KFG_RED;
     root_win->border_bg = KFG_RED;
     test_win(root_win, 40, 85, "Hello, World!");
     test_win(root_win, 150, 20, "Mrow!");
+    kfg_win_composite(root_win);
 
     for (;;);
 }
@@ -31,93 +31,75 @@
 #include <sys/cdefs.h>
 #include <sys/param.h>
 #include <kfg/window.h>
-#include <kfg/font.h>
+#include <libgfx/draw.h>
+#include <libgfx/text.h>
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
 
-__always_inline static inline size_t
-pixel_index(struct kfg_window *wp, kfgpos_t x, kfgpos_t y)
+/*
+ * Intersect two rectangles, the result is empty if
+ * they do not overlap.
+ */
+static struct kfg_rect
+rect_clip(const struct kfg_rect *a, const struct kfg_rect *b)
 {
-    return x + y * (wp->fb_pitch / 4);
+    struct kfg_rect r = {0};
+    kfgpos_t x_f, y_f;
+
+    r.x = MAX(a->x, b->x);
+    r.y = MAX(a->y, b->y);
+    x_f = MIN(a->x + a->width, b->x + b->width);
+    y_f = MIN(a->y + a->height, b->y + b->height);
+
+    if (x_f > r.x && y_f > r.y) {
+        r.width = x_f - r.x;
+        r.height = y_f - r.y;
+    }
+
+    return r;
 }
 
-static int
-kfg_win_putc(struct kfg_window *wp, uint32_t x, uint32_t y, char ch)
+/*
+ * Fill part of a window surface with one color.
+ */
+static void
+surf_fill(struct kfg_window *wp, kfgpos_t x, kfgpos_t y, kfgdim_t w,
+    kfgdim_t h, kfgpixel_t color)
 {
-    size_t idx;
-    const uint8_t *glyph;
-    uint32_t fg, bg;
-
-    glyph = &g_KFG_FONT[(int)ch*16];
-    fg = KFG_WHITE;
-    bg = wp->bg;
-
-    for (uint32_t cy = 0; cy < FONT_HEIGHT; ++cy) {
-        idx = pixel_index(wp, x + (FONT_WIDTH - 1), y + cy);
-        for (uint32_t cx = 0; cx < FONT_WIDTH; ++cx) {
-            wp->framebuf[idx--] = ISSET(glyph[cy], BIT(cx)) ? fg : bg;
-        }
-    }
+    struct gfx_shape shape = GFX_SHAPE_DEFAULT;
+
+    shape.x = x;
+    shape.y = y;
+    shape.width = w;
+    shape.height = h;
+    shape.color = color;
+    gfx_draw_shape(&wp->surf, &shape);
 }
 
+/*
+ * Draw the title bar, border and background of a
+ * window into its surface.
+ */
 static void
-draw_win(struct kfg_window *parent, struct kfg_window *wp)
+draw_win(struct kfg_window *wp)
 {
-    kfgpixel_t *framep;
-    kfgpos_t x_i, y_i;    /* Start */
-    kfgpos_t x_end, y_end;    /* End */
-    kfgpixel_t brush = wp->bg;
-    kfgpos_t rx, ry;  /* Starts at 0 */
-    kfgpos_t rx_end, ry_end;  /* Starts at 0 */
-    size_t i;
-
-    framep = parent->framebuf;
-    x_i = wp->x;
-    y_i = wp->y;
-    x_end = x_i + wp->width;
-    y_end = y_i + wp->height;
-
-    if (x_end > parent->width)
-        x_end = parent->width;
-    if (y_end > parent->height)
-        y_end = parent->height;
-
-    for (kfgpos_t x = x_i; x < x_end; ++x) {
-        for (kfgpos_t y = y_i; y < y_i+KFG_TITLE_HEIGHT; ++y) {
-            rx = (x - x_i);
-            ry = (y - y_i);
-
-            if (rx <= KFG_BORDER_WIDTH && (rx % 2) == 0)
-                brush = KFG_WHITE;
-            else
-                brush = KFG_AQUA;
-
-            i = pixel_index(parent, x, y);
-            framep[i] = brush;
-        }
-    }
+    kfgdim_t w, h, bw, bh;
 
-    y_i = wp->y + KFG_TITLE_HEIGHT;
-    for (kfgpos_t x = x_i; x < x_end; ++x) {
-        for (kfgpos_t y = y_i; y < y_end; ++y) {
-            rx = (x - x_i);
-            ry = (y - y_i);
-
-            if (rx <= KFG_BORDER_WIDTH)
-                brush = wp->border_bg;
-            else if (ry <= KFG_BORDER_HEIGHT)
-                brush = wp->border_bg;
-            else if (rx >= (wp->width - KFG_BORDER_WIDTH))
-                brush = wp->border_bg;
-            else if (ry >= (wp->height - KFG_BORDER_HEIGHT))
-                brush = wp->border_bg;
-            else
-                brush = wp->bg;
-
-            i = pixel_index(parent, x, y);
-            framep[i] = brush;
-        }
+    w = wp->width;
+    h = wp->height - KFG_TITLE_HEIGHT;
+    bw = KFG_BORDER_WIDTH + 1;
+    bh = KFG_BORDER_HEIGHT + 1;
+
+    /* Title bar */
+    surf_fill(wp, 0, 0, w, KFG_TITLE_HEIGHT, KFG_AQUA);
+    surf_fill(wp, 0, 0, 1, KFG_TITLE_HEIGHT, KFG_WHITE);
+
+    /* Body, framed by the border */
+    surf_fill(wp, 0, KFG_TITLE_HEIGHT, w, h, wp->border_bg);
+    if (w > bw * 2 && h > bh * 2) {
+        surf_fill(wp, bw, KFG_TITLE_HEIGHT + bh, w - bw * 2, h - bh * 2,
+            wp->bg);
     }
 }
 
@@ -127,95 +109,322 @@ draw_win(struct kfg_window *parent, struct kfg_window *wp)
  * @parent: Parent window
  * @wp: New window to draw
  *
- * TODO: Double buffering and multiple windows.
+ * The window is drawn into its own surface, it
+ * reaches the screen on the next composite.
  */
 int
 kfg_win_draw(struct kfg_window *parent, struct kfg_window *wp)
 {
-    kfgpos_t start_x, start_y;
-    kfgpos_t end_x, end_y;
-    kfgpos_t max_x, max_y;
-    kfgdim_t width, height;
+    struct kfg_rect all;
 
-    if (parent == NULL) {
+    if (parent == NULL || wp == NULL) {
         return -EINVAL;
     }
-    if (parent->framebuf == NULL) {
+    if (wp->surf.io == NULL) {
         return -EINVAL;
     }
 
-    max_x = wp->x + parent->width;
-    max_y = wp->y + parent->height;
-
-    /* Don't overflow the framebuffer! */
-    if ((wp->x + wp->width) > max_x) {
-        wp->x = max_x;
-    }
-    if ((wp->y + wp->height) > max_y) {
-        wp->y = max_y;
-    }
-
-    draw_win(parent, wp);
+    draw_win(wp);
+    all.x = 0;
+    all.y = 0;
+    all.width = wp->width;
+    all.height = wp->height;
+    kfg_win_damage(wp, &all);
     return 0;
 }
 
 /*
- * Create a new default window
+ * Create a new default window, on top of the other
+ * children of `parent'.
  *
+ * @parent: Window to create it in
  * @x: X position for this window
  * @y: Y position for this window
- * @w: Window width
- * @h: Window height
  */
 struct kfg_window *
 kfg_win_new(struct kfg_window *parent, kfgpos_t x, kfgpos_t y)
 {
-    struct kfg_window *wp;
+    struct kfg_window *wp, **wpp;
+    struct gfx_ctx *sp;
 
     if ((wp = malloc(sizeof(*wp))) == NULL) {
         return NULL;
     }
 
+    memset(wp, 0, sizeof(*wp));
     wp->x = x;
     wp->y = y;
     wp->width = 250;
     wp->height = 150;
-    wp->fb_pitch = parent->fb_pitch;
-    wp->framebuf = parent->framebuf;
+    wp->gfx = parent->gfx;
     wp->bg = KFG_DARK;
     wp->border_bg = KFG_RED;
+    wp->parent = parent;
+
+    /* The surface is an offscreen libgfx context */
+    sp = &wp->surf;
+    sp->fbdev.width = wp->width;
+    sp->fbdev.height = wp->height;
+    sp->fbdev.pitch = wp->width * sizeof(kfgpixel_t);
+    sp->fbdev.bpp = 32;
+    sp->fb_size = sp->fbdev.pitch * wp->height;
+    if ((sp->io = malloc(sp->fb_size)) == NULL) {
+        free(wp);
+        return NULL;
+    }
+
+    /* Newest goes on top */
+    wpp = &parent->children;
+    while (*wpp != NULL) {
+        wpp = &(*wpp)->next;
+    }
+
+    *wpp = wp;
     return wp;
 }
 
+/*
+ * Put a string in a window, wrapping at the right
+ * border. Each line is handed to libgfx as one run.
+ *
+ * @wp: Window to draw in
+ * @tp: Text and its position within the window
+ */
 int
 kfg_win_putstr(struct kfg_window *wp, struct kfg_text *tp)
 {
-    size_t slen;
-    const char *p;
+    struct gfx_text text;
+    struct kfg_rect r;
+    kfgdim_t area_w, area_h;
     kfgpos_t x, y;
+    size_t slen, n;
 
     if (tp == NULL)
         return -EINVAL;
     if (tp->text == NULL)
         return -EINVAL;
+    if (wp->surf.io == NULL)
+        return -EINVAL;
+
+    /* Text goes inside the borders, below the title */
+    if (wp->width <= (KFG_BORDER_WIDTH + 1) * 2)
+        return 0;
+    if (wp->height <= KFG_TITLE_HEIGHT + (KFG_BORDER_HEIGHT + 1) * 2)
+        return 0;
+
+    area_w = wp->width - (KFG_BORDER_WIDTH + 1) * 2;
+    area_h = wp->height - KFG_TITLE_HEIGHT - (KFG_BORDER_HEIGHT + 1) * 2;
 
     slen = strlen(tp->text);
-    x = (wp->x + tp->x) + (KFG_BORDER_WIDTH + 1);
-    y = (KFG_TITLE_HEIGHT + wp->y) + tp->y;
-    p = tp->text;
+    text.text = tp->text;
+    text.fg = KFG_WHITE;
+    text.bg = wp->bg;
+    x = tp->x;
+    y = tp->y;
 
-    while (slen--) {
-        if (y >= wp->height) {
-            break;
+    while (slen > 0 && y + GFX_FONT_HEIGHT <= area_h) {
+        if (x + GFX_FONT_WIDTH > area_w) {
+            /* Not even one character fits */
+            if (x == 0)
+                break;
+
+            x = 0;
+            y += GFX_FONT_HEIGHT;
+            continue;
         }
 
-        kfg_win_putc(wp, x, y, *(p++));
-        x += FONT_WIDTH;
-        if (x >= wp->width) {
-            y += FONT_HEIGHT;
-            x = wp->x + (KFG_BORDER_WIDTH + 1);
+        n = MIN(slen, (area_w - x) / GFX_FONT_WIDTH);
+        text.len = n;
+        text.x = (KFG_BORDER_WIDTH + 1) + x;
+        text.y = KFG_TITLE_HEIGHT + (KFG_BORDER_HEIGHT + 1) + y;
+        gfx_draw_text(&wp->surf, &text);
+
+        r.x = text.x;
+        r.y = text.y;
+        r.width = n * GFX_FONT_WIDTH;
+        r.height = GFX_FONT_HEIGHT;
+        kfg_win_damage(wp, &r);
+
+        text.text += n;
+        slen -= n;
+        x = 0;
+        y += GFX_FONT_HEIGHT;
+    }
+
+    return 0;
+}
+
+/*
+ * Mark part of a window as changed, it is grown to
+ * cover everything damaged since the last composite.
+ *
+ * @wp: Window that changed
+ * @r: Changed area in window coordinates
+ */
+void
+kfg_win_damage(struct kfg_window *wp, const struct kfg_rect *r)
+{
+    struct kfg_rect *dp = &wp->damage;
+    kfgpos_t x_f, y_f;
+
+    if (r->width == 0 || r->height == 0) {
+        return;
+    }
+    if (dp->width == 0 || dp->height == 0) {
+        *dp = *r;
+        return;
+    }
+
+    x_f = MAX(dp->x + dp->width, r->x + r->width);
+    y_f = MAX(dp->y + dp->height, r->y + r->height);
+    dp->x = MIN(dp->x, r->x);
+    dp->y = MIN(dp->y, r->y);
+    dp->width = x_f - dp->x;
+    dp->height = y_f - dp->y;
+}
+
+/*
+ * Copy part of a window to the screen a scanline at
+ * a time, or fill it with the background if the
+ * window has no surface (i.e., the root).
+ *
+ * @r: Area to copy in screen coordinates
+ */
+static void
+comp_blit(struct kfg_window *wp, const struct kfg_rect *r)
+{
+    struct gfx_ctx *gfx = wp->gfx;
+    struct gfx_shape shape = GFX_SHAPE_DEFAULT;
+    kfgpixel_t *src, *dst;
+    size_t src_stride, dst_stride;
+
+    if (wp->surf.io == NULL) {
+        shape.x = r->x;
+        shape.y = r->y;
+        shape.width = r->width;
+        shape.height = r->height;
+        shape.color = wp->bg;
+        gfx_draw_shape(gfx, &shape);
+        return;
+    }
+
+    src_stride = wp->surf.fbdev.pitch / 4;
+    dst_stride = gfx->fbdev.pitch / 4;
+    src = &wp->surf.io[(r->x - wp->x) + (r->y - wp->y) * src_stride];
+    dst = &gfx->io[gfx_io_index(gfx, r->x, r->y)];
+
+    for (kfgdim_t i = 0; i < r->height; ++i) {
+        memcpy(dst, src, r->width * sizeof(kfgpixel_t));
+        src += src_stride;
+        dst += dst_stride;
+    }
+
+    gfx_mark_dirty(gfx, r->x, r->y, r->width, r->height);
+}
+
+/*
+ * Bring what is visible of `r' to the screen. Every
+ * sibling from `above' up covers the window, pieces
+ * of `r' outside each one are passed on to the next
+ * so only uncovered pixels are ever copied.
+ */
+static void
+comp_visible(struct kfg_window *wp, struct kfg_window *above,
+    struct kfg_rect r)
+{
+    struct kfg_rect cover, piece;
+    kfgpos_t r_xf, r_yf, c_xf, c_yf;
+
+    if (r.width == 0 || r.height == 0) {
+        return;
+    }
+
+    /* Skip siblings that do not cover any of it */
+    for (; above != NULL; above = above->next) {
+        cover.x = above->x;
+        cover.y = above->y;
+        cover.width = above->width;
+        cover.height = above->height;
+        cover = rect_clip(&r, &cover);
+        if (cover.width != 0 && cover.height != 0) {
+            break;
         }
     }
 
+    if (above == NULL) {
+        comp_blit(wp, &r);
+        return;
+    }
+
+    /*
+     * Split what is left into bands above and below
+     * the covered part, then to its left and right.
+     */
+    r_xf = r.x + r.width;
+    r_yf = r.y + r.height;
+    c_xf = cover.x + cover.width;
+    c_yf = cover.y + cover.height;
+    above = above->next;
+
+    piece = r;
+    piece.height = cover.y - r.y;
+    comp_visible(wp, above, piece);
+
+    piece.y = c_yf;
+    piece.height = r_yf - c_yf;
+    comp_visible(wp, above, piece);
+
+    piece.y = cover.y;
+    piece.height = cover.height;
+    piece.width = cover.x - r.x;
+    comp_visible(wp, above, piece);
+
+    piece.x = c_xf;
+    piece.width = r_xf - c_xf;
+    comp_visible(wp, above, piece);
+}
+
+/*
+ * Composite the damaged parts of the root and its
+ * children onto the screen, bottom of the stack
+ * first. Nothing that is covered by another window
+ * or was not damaged is copied.
+ *
+ * @root: Root window
+ */
+int
+kfg_win_composite(struct kfg_window *root)
+{
+    struct kfg_window *wp;
+    struct kfg_rect r, all, screen;
+
+    if (root == NULL || root->gfx == NULL) {
+        return -EINVAL;
+    }
+
+    screen.x = 0;
+    screen.y = 0;
+    screen.width = root->gfx->fbdev.width;
+    screen.height = root->gfx->fbdev.height;
+
+    /* The root has no surface, its damage is filled in */
+    r = rect_clip(&root->damage, &screen);
+    comp_visible(root, root->children, r);
+    memset(&root->damage, 0, sizeof(root->damage));
+
+    for (wp = root->children; wp != NULL; wp = wp->next) {
+        all.x = 0;
+        all.y = 0;
+        all.width = wp->width;
+        all.height = wp->height;
+        r = rect_clip(&wp->damage, &all);
+        r.x += wp->x;
+        r.y += wp->y;
+        r = rect_clip(&r, &screen);
+        comp_visible(wp, wp->next, r);
+        memset(&wp->damage, 0, sizeof(wp->damage));
+    }
+
+    gfx_present(root->gfx);
     return 0;
 }
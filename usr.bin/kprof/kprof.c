@@ -0,0 +1,595 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/elf.h>
+#include <sys/prof.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#define PROF_CTL     "/ctl/prof/ctl"
+#define PROF_SAMPLES "/ctl/prof/samples"
+#define PROF_KSYMS   "/ctl/prof/ksyms"
+
+#define KPROF_FLAGS "edfr:t:u:p:"
+
+#define NSAMPLE     32      /* Samples per read */
+#define NSYMREAD    64      /* Symbols per read */
+#define MAX_KSYMS   4096
+#define MAX_USYMS   4096
+#define MAX_SHDRS   64
+#define MAX_STACKS  2048    /* Must be a power of two */
+#define SYM_NONE    -1
+
+/* Poll period while profiling for a set time */
+#define POLL_NSEC   100000000
+#define POLL_PER_SEC 10
+
+/*
+ * A function symbol from a user ELF
+ *
+ * @addr: Start address of the function
+ * @size: Size of the function in bytes
+ * @name: Name of the function
+ */
+struct usym {
+    uint64_t addr;
+    uint64_t size;
+    char name[PROF_SYMLEN];
+};
+
+/*
+ * A unique call chain and the number of times
+ * it was sampled, leaf first.
+ */
+struct stack {
+    uint32_t count;
+    uint8_t depth;
+    int16_t sym[PROF_MAXDEPTH];
+};
+
+static struct prof_ksym ksyms[MAX_KSYMS];
+static struct usym usyms[MAX_USYMS];
+static struct stack stacks[MAX_STACKS];
+static uint32_t self_count[MAX_KSYMS + MAX_USYMS];
+static uint32_t unknown_count = 0;
+static size_t nksyms = 0;
+static size_t nusyms = 0;
+static size_t nsamples = 0;
+static size_t ndropped = 0;
+static int pid_filter = -1;
+
+static void
+help(void)
+{
+    printf(
+        "kprof: usage: kprof [flags]\n"
+        "flags:\n"
+        "   [-e] Start the profiler\n"
+        "   [-d] Stop the profiler\n"
+        "   [-r hz] Sample rate to use with -e or -t\n"
+        "   [-t secs] Profile for a number of seconds\n"
+        "   [-f] Print folded stacks instead of a flat profile\n"
+        "   [-u elf] Symbolize user samples against an ELF\n"
+        "   [-p pid] Only report samples from a process\n"
+        "with no flags, buffered samples are reported\n"
+    );
+}
+
+static int
+set_ctl(uint32_t enable, uint32_t hz)
+{
+    struct prof_ctl ctl;
+    int fd;
+
+    if ((fd = open(PROF_CTL, O_RDWR)) < 0) {
+        printf("failed to open %s\n", PROF_CTL);
+        return fd;
+    }
+
+    ctl.enable = enable;
+    ctl.hz = hz;
+    if (write(fd, &ctl, sizeof(ctl)) < 0) {
+        printf("failed to %s profiler\n", enable ? "start" : "stop");
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+/*
+ * Load the kernel symbol table, which is
+ * handed back in address order.
+ */
+static int
+load_ksyms(void)
+{
+    ssize_t len;
+    size_t n;
+    int fd;
+
+    if ((fd = open(PROF_KSYMS, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", PROF_KSYMS);
+        return fd;
+    }
+
+    while (nksyms < MAX_KSYMS) {
+        n = MIN(NSYMREAD, MAX_KSYMS - nksyms);
+        len = read(fd, &ksyms[nksyms], n * sizeof(struct prof_ksym));
+        if (len <= 0) {
+            break;
+        }
+        nksyms += len / sizeof(struct prof_ksym);
+    }
+
+    close(fd);
+    return 0;
+}
+
+/*
+ * Sort user symbols by address so they
+ * can be binary searched.
+ */
+static void
+sort_usyms(void)
+{
+    struct usym tmp;
+    size_t gap, i, j;
+
+    for (gap = nusyms / 2; gap > 0; gap /= 2) {
+        for (i = gap; i < nusyms; ++i) {
+            tmp = usyms[i];
+            for (j = i; j >= gap && usyms[j - gap].addr > tmp.addr; j -= gap) {
+                usyms[j] = usyms[j - gap];
+            }
+            usyms[j] = tmp;
+        }
+    }
+}
+
+/*
+ * Load function symbols from the .symtab of
+ * a user ELF.
+ */
+static int
+load_usyms(const char *path)
+{
+    static Elf64_Shdr shdrs[MAX_SHDRS];
+    Elf64_Sym syms[NSYMREAD];
+    Elf64_Ehdr eh;
+    Elf64_Shdr *symtab = NULL, *strtab;
+    struct usym *up;
+    size_t nsym, n;
+    ssize_t len;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", path);
+        return fd;
+    }
+
+    if (read(fd, &eh, sizeof(eh)) != sizeof(eh)) {
+        printf("failed to read ELF header\n");
+        close(fd);
+        return -1;
+    }
+    if (memcmp(&eh.e_ident[EI_MAG0], ELFMAG, SELFMAG) != 0) {
+        printf("%s: bad ELF magic\n", path);
+        close(fd);
+        return -1;
+    }
+    if (eh.e_shnum > MAX_SHDRS || eh.e_shentsize != sizeof(Elf64_Shdr)) {
+        printf("%s: bad section headers\n", path);
+        close(fd);
+        return -1;
+    }
+
+    lseek(fd, eh.e_shoff, SEEK_SET);
+    len = eh.e_shnum * sizeof(Elf64_Shdr);
+    if (read(fd, shdrs, len) != len) {
+        printf("failed to read section headers\n");
+        close(fd);
+        return -1;
+    }
+
+    for (size_t i = 0; i < eh.e_shnum; ++i) {
+        if (shdrs[i].sh_type == SHT_SYMTAB) {
+            symtab = &shdrs[i];
+            break;
+        }
+    }
+    if (symtab == NULL || symtab->sh_link >= eh.e_shnum) {
+        printf("%s: no symbol table\n", path);
+        close(fd);
+        return -1;
+    }
+
+    strtab = &shdrs[symtab->sh_link];
+    nsym = symtab->sh_size / sizeof(Elf64_Sym);
+
+    for (size_t i = 0; i < nsym && nusyms < MAX_USYMS; i += n) {
+        n = MIN(NSYMREAD, nsym - i);
+        lseek(fd, symtab->sh_offset + (i * sizeof(Elf64_Sym)), SEEK_SET);
+        if (read(fd, syms, n * sizeof(Elf64_Sym)) <= 0) {
+            break;
+        }
+
+        for (size_t j = 0; j < n && nusyms < MAX_USYMS; ++j) {
+            if (ELF64_ST_TYPE(syms[j].st_info) != STT_FUNC)
+                continue;
+            if (syms[j].st_value == 0)
+                continue;
+
+            up = &usyms[nusyms++];
+            up->addr = syms[j].st_value;
+            up->size = syms[j].st_size;
+            memset(up->name, 0, PROF_SYMLEN);
+            lseek(fd, strtab->sh_offset + syms[j].st_name, SEEK_SET);
+            read(fd, up->name, PROF_SYMLEN - 1);
+        }
+    }
+
+    close(fd);
+    sort_usyms();
+    return 0;
+}
+
+/*
+ * Look up the kernel symbol containing `pc'.
+ *
+ * Returns the symbol index, or SYM_NONE.
+ */
+static int
+ksym_lookup(uint64_t pc)
+{
+    size_t lo = 0, hi = nksyms, mid;
+
+    if (nksyms == 0 || pc < ksyms[0].addr) {
+        return SYM_NONE;
+    }
+
+    /* Find the last symbol at or below `pc' */
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (ksyms[mid].addr <= pc) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ * Look up the user symbol containing `pc'.
+ *
+ * Returns the symbol index offset by MAX_KSYMS,
+ * or SYM_NONE.
+ */
+static int
+usym_lookup(uint64_t pc)
+{
+    size_t lo = 0, hi = nusyms, mid;
+    struct usym *up;
+
+    if (nusyms == 0 || pc < usyms[0].addr) {
+        return SYM_NONE;
+    }
+
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        if (usyms[mid].addr <= pc) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    up = &usyms[lo];
+    if (up->size != 0 && pc >= up->addr + up->size) {
+        return SYM_NONE;
+    }
+
+    return MAX_KSYMS + lo;
+}
+
+static const char *
+sym_name(int sym)
+{
+    if (sym == SYM_NONE) {
+        return "[unknown]";
+    }
+    if (sym >= MAX_KSYMS) {
+        return usyms[sym - MAX_KSYMS].name;
+    }
+
+    return ksyms[sym].name;
+}
+
+/*
+ * Find or insert the slot for a call chain
+ * in the stack table.
+ */
+static struct stack *
+stack_slot(const int16_t *sym, uint8_t depth)
+{
+    struct stack *stp;
+    uint32_t hash = 2166136261U;
+    size_t idx;
+
+    /* FNV-1a over the symbol IDs */
+    for (uint8_t i = 0; i < depth; ++i) {
+        hash = (hash ^ (uint16_t)sym[i]) * 16777619U;
+    }
+
+    for (size_t i = 0; i < MAX_STACKS; ++i) {
+        idx = (hash + i) & (MAX_STACKS - 1);
+        stp = &stacks[idx];
+
+        if (stp->count == 0) {
+            stp->depth = depth;
+            memcpy(stp->sym, sym, depth * sizeof(*sym));
+            return stp;
+        }
+        if (stp->depth != depth) {
+            continue;
+        }
+        if (memcmp(stp->sym, sym, depth * sizeof(*sym)) == 0) {
+            return stp;
+        }
+    }
+
+    return NULL;
+}
+
+static void
+account(const struct prof_sample *sp)
+{
+    int16_t sym[PROF_MAXDEPTH];
+    struct stack *stp;
+    uint8_t depth;
+
+    if (pid_filter >= 0 && sp->pid != (uint32_t)pid_filter) {
+        return;
+    }
+
+    depth = MIN(sp->depth, PROF_MAXDEPTH);
+    if (depth == 0) {
+        return;
+    }
+
+    for (uint8_t i = 0; i < depth; ++i) {
+        if (ISSET(sp->flags, PROF_USER)) {
+            sym[i] = usym_lookup(sp->pc[i]);
+        } else {
+            sym[i] = ksym_lookup(sp->pc[i]);
+        }
+    }
+
+    ++nsamples;
+    if (sym[0] == SYM_NONE) {
+        ++unknown_count;
+    } else {
+        ++self_count[sym[0]];
+    }
+
+    if ((stp = stack_slot(sym, depth)) == NULL) {
+        ++ndropped;
+        return;
+    }
+    ++stp->count;
+}
+
+/*
+ * Drain whatever samples are buffered in
+ * the kernel.
+ */
+static int
+collect(void)
+{
+    struct prof_sample buf[NSAMPLE];
+    ssize_t len;
+    size_t n;
+    int fd;
+
+    if ((fd = open(PROF_SAMPLES, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", PROF_SAMPLES);
+        return fd;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        n = len / sizeof(struct prof_sample);
+        for (size_t i = 0; i < n; ++i) {
+            account(&buf[i]);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+/*
+ * Print per-symbol self counts, highest first.
+ */
+static void
+print_flat(void)
+{
+    static uint16_t order[MAX_KSYMS + MAX_USYMS];
+    size_t n = 0, i, j;
+    uint16_t tmp;
+    uint32_t count;
+
+    for (i = 0; i < NELEM(self_count); ++i) {
+        if (self_count[i] != 0) {
+            order[n++] = i;
+        }
+    }
+
+    for (i = 1; i < n; ++i) {
+        tmp = order[i];
+        for (j = i; j > 0 && self_count[order[j - 1]] < self_count[tmp]; --j) {
+            order[j] = order[j - 1];
+        }
+        order[j] = tmp;
+    }
+
+    printf("%d samples\n", nsamples);
+    if (nsamples == 0) {
+        return;
+    }
+
+    printf("  count    pct  symbol\n");
+    for (i = 0; i < n; ++i) {
+        count = self_count[order[i]];
+        printf("%08d  %03d%%  %s\n", count, (count * 100) / nsamples,
+            sym_name(order[i]));
+    }
+    if (unknown_count != 0) {
+        printf("%08d  %03d%%  %s\n", unknown_count,
+            (unknown_count * 100) / nsamples, sym_name(SYM_NONE));
+    }
+}
+
+/*
+ * Print call chains root first, one per line
+ * followed by their count.
+ */
+static void
+print_folded(void)
+{
+    struct stack *stp;
+
+    for (size_t i = 0; i < MAX_STACKS; ++i) {
+        stp = &stacks[i];
+        if (stp->count == 0) {
+            continue;
+        }
+
+        for (int j = stp->depth - 1; j >= 0; --j) {
+            printf("%s%s", sym_name(stp->sym[j]), (j > 0) ? ";" : "");
+        }
+        printf(" %d\n", stp->count);
+    }
+}
+
+/*
+ * Run the profiler for `secs' seconds, draining
+ * samples as they come in so the per-CPU rings
+ * do not wrap.
+ */
+static int
+profile_for(uint32_t secs, uint32_t hz)
+{
+    struct timespec ts, rem;
+    int error;
+
+    if ((error = set_ctl(1, hz)) < 0) {
+        return error;
+    }
+
+    for (uint32_t i = 0; i < secs * POLL_PER_SEC; ++i) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = POLL_NSEC;
+        sleep(&ts, &rem);
+        collect();
+    }
+
+    set_ctl(0, hz);
+    return collect();
+}
+
+int
+main(int argc, char **argv)
+{
+    const char *elf = NULL;
+    uint32_t hz = PROF_DEFAULT_HZ, secs = 0;
+    bool folded = false;
+    int c, error;
+
+    while ((c = getopt(argc, argv, KPROF_FLAGS)) != -1) {
+        switch (c) {
+        case 'e':
+            return set_ctl(1, hz);
+        case 'd':
+            return set_ctl(0, hz);
+        case 'f':
+            folded = true;
+            break;
+        case 'r':
+            hz = atoi(optarg);
+            break;
+        case 't':
+            secs = atoi(optarg);
+            break;
+        case 'u':
+            elf = optarg;
+            break;
+        case 'p':
+            pid_filter = atoi(optarg);
+            break;
+        default:
+            help();
+            return -1;
+        }
+    }
+
+    if ((error = load_ksyms()) < 0) {
+        return error;
+    }
+    if (elf != NULL && (error = load_usyms(elf)) < 0) {
+        return error;
+    }
+
+    if (secs != 0) {
+        error = profile_for(secs, hz);
+    } else {
+        error = collect();
+    }
+    if (error < 0) {
+        return error;
+    }
+
+    if (folded) {
+        print_folded();
+    } else {
+        print_flat();
+    }
+
+    if (ndropped != 0) {
+        printf("kprof: %d samples not folded, stack table full\n", ndropped);
+    }
+    return 0;
+}
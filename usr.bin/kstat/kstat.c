@@ -29,11 +29,17 @@
 
 #include <sys/sched.h>
 #include <sys/vmstat.h>
+#include <sys/driver.h>
+#include <sys/intrstat.h>
 #include <stdio.h>
+#include <stdbool.h>
 #include <unistd.h>
 #include <fcntl.h>
 
 #define MIB_PER_GIB 1024
+#define NSITE 16
+#define NTIMELINE 16
+#define NINTR 16
 
 static void
 print_size_mib(const char *name, size_t mib)
@@ -111,6 +117,106 @@ get_sched_stat(void)
     }
 }
 
+/*
+ * Log heap usage by call site, only available
+ * if the kernel is built with DYNALLOC_PROF.
+ */
+static void
+get_dynalloc_stat(void)
+{
+    struct dynalloc_site sites[NSITE];
+    struct dynalloc_site *dsp;
+    bool header = false;
+    ssize_t len;
+    int fd;
+
+    fd = open("/ctl/vm/dynalloc", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    while ((len = read(fd, sites, sizeof(sites))) > 0) {
+        if (!header) {
+            printf("-- heap usage by call site --\n");
+            header = true;
+        }
+        for (size_t i = 0; i < len / sizeof(*dsp); ++i) {
+            dsp = &sites[i];
+            printf("%s+0x%x: %d bytes (peak %d, total %d), %d allocs, %d frees\n",
+                (dsp->sym[0] != '\0') ? dsp->sym : "??", (uint64_t)dsp->off,
+                dsp->cur, dsp->peak, dsp->total, dsp->nalloc, dsp->nfree);
+        }
+    }
+
+    close(fd);
+}
+
+/*
+ * Log how many times each interrupt fired
+ * on each processor.
+ */
+static void
+get_intr_stat(void)
+{
+    struct intr_stat stats[NINTR];
+    struct intr_stat *isp;
+    ssize_t len;
+    int fd;
+
+    fd = open("/ctl/intr/stat", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    printf("-- interrupt statistics --\n");
+    while ((len = read(fd, stats, sizeof(stats))) > 0) {
+        for (size_t i = 0; i < len / sizeof(*isp); ++i) {
+            isp = &stats[i];
+            printf("[cpu %d] vec %d (%s): %d%s\n", isp->cpu, isp->vector,
+                isp->name, isp->count,
+                (isp->cpu == isp->affinity) ? " (routed here)" : "");
+        }
+    }
+
+    close(fd);
+}
+
+/*
+ * Log how long each driver took to start
+ * and which processor started it.
+ */
+static void
+get_boot_timeline(void)
+{
+    struct driver_time times[NTIMELINE];
+    struct driver_time *dtp;
+    ssize_t len;
+    int fd;
+
+    fd = open("/ctl/boot/timeline", O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    printf("-- boot timeline --\n");
+    while ((len = read(fd, times, sizeof(times))) > 0) {
+        for (size_t i = 0; i < len / sizeof(*dtp); ++i) {
+            dtp = &times[i];
+            if (dtp->end_usec == 0) {
+                printf("[cpu %d] %s: starting\n", dtp->cpu, dtp->name);
+                continue;
+            }
+
+            printf("[cpu %d] %s%s: +%d us, took %d us (status %d)\n",
+                dtp->cpu, dtp->name, dtp->deferred ? " (deferred)" : "",
+                (int)dtp->start_usec, (int)(dtp->end_usec - dtp->start_usec),
+                dtp->status);
+        }
+    }
+
+    close(fd);
+}
+
 int
 main(void)
 {
@@ -118,5 +224,8 @@ main(void)
     get_sched_stat();
     printf("-- memory statistics --\n");
     get_vm_stat();
+    get_dynalloc_stat();
+    get_intr_stat();
+    get_boot_timeline();
     return 0;
 }
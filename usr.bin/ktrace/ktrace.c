@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/ktrace.h>
+#include <sys/spawn.h>
+#include <sys/wait.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define KTRACE_CTL "/ctl/ktrace/ctl"
+#define KTRACE_FLAGS "cp:"
+
+static void
+help(void)
+{
+    printf(
+        "ktrace: usage: ktrace [flags] [command [args...]]\n"
+        "flags:\n"
+        "   [-c] Stop tracing instead of starting\n"
+        "   [-p pid] Act on a child process\n"
+        "with a command, it is run with tracing enabled\n"
+        "records are read back with kdump\n"
+    );
+}
+
+static int
+ktrace_op(pid_t pid, uint32_t op)
+{
+    struct ktrace_ctl ctl;
+    int fd;
+
+    if ((fd = open(KTRACE_CTL, O_RDWR)) < 0) {
+        printf("failed to open %s\n", KTRACE_CTL);
+        return fd;
+    }
+
+    ctl.pid = pid;
+    ctl.op = op;
+    if (write(fd, &ctl, sizeof(ctl)) < 0) {
+        printf("ktrace: failed to %s tracing\n",
+            (op == KTROP_SET) ? "start" : "stop");
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+/*
+ * Run a command with tracing enabled, it is
+ * inherited by the child when it is spawned.
+ */
+static int
+ktrace_run(char **argv)
+{
+    char bin_path[256];
+    char *envp[] = { NULL };
+    const char *path = argv[0];
+    pid_t child;
+    int error;
+
+    if (access(path, F_OK) != 0) {
+        snprintf(bin_path, sizeof(bin_path), "/usr/bin/%s", argv[0]);
+        path = bin_path;
+    }
+
+    if ((error = ktrace_op(0, KTROP_SET)) < 0) {
+        return error;
+    }
+
+    child = spawn(path, argv, envp, 0);
+    ktrace_op(0, KTROP_CLEAR);
+    if (child < 0) {
+        printf("ktrace: failed to run %s\n", path);
+        return child;
+    }
+
+    waitpid(child, NULL, 0);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    uint32_t op = KTROP_SET;
+    pid_t pid = -1;
+    int c;
+
+    if (argc < 2) {
+        help();
+        return -1;
+    }
+
+    while ((c = getopt(argc, argv, KTRACE_FLAGS)) != -1) {
+        switch (c) {
+        case 'c':
+            op = KTROP_CLEAR;
+            break;
+        case 'p':
+            pid = atoi(optarg);
+            break;
+        default:
+            help();
+            return -1;
+        }
+    }
+
+    if (pid >= 0) {
+        return ktrace_op(pid, op);
+    }
+    if (optind >= argc) {
+        return ktrace_op(0, op);
+    }
+
+    return ktrace_run(&argv[optind]);
+}
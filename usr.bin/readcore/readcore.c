@@ -31,7 +31,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdint.h>
-#include "crc32.h"
+#include <crc32.h>
 #include "frame.h"
 #include "core.h"
 
@@ -91,6 +91,9 @@ screensave(void)
             ctx.io[i + 1] = nextpix;
         }
 
+        /* Pixels were changed directly, all over the screen */
+        gfx_mark_dirty(&ctx, 0, 0, ctx.fbdev.width, ctx.fbdev.height);
+        gfx_present(&ctx);
         sleep(&ts, &ts);
         if ((++step) > 50) {
             step = 0;
@@ -110,6 +113,14 @@ main(void)
         return error;
     }
 
+    /*
+     * Every frame reads back what it draws, keep that
+     * out of video memory if we can.
+     */
+    if (gfx_backbuf(&ctx) < 0) {
+        printf("no back buffer, drawing to the framebuffer\n");
+    }
+
     screensave();
     gfx_cleanup(&ctx);
     return 0;
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2023-2025 Ian Marco Moffett and the Osmora Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of Hyra nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/types.h>
+#include <sys/trace.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define TRACE_BUF  "/ctl/trace/buf"
+#define TRACE_MASK "/ctl/trace/mask"
+
+#define TRACEDUMP_FLAGS "edm:"
+#define NREC 64
+
+static const char *evname[] = {
+    [TRACE_SCHED_SWITCH] = "sched_switch",
+    [TRACE_SYSCALL_ENTER] = "syscall_enter",
+    [TRACE_SYSCALL_EXIT] = "syscall_exit",
+    [TRACE_PAGEFAULT] = "pagefault",
+    [TRACE_DISK_IO] = "disk_io",
+    [TRACE_IRQ] = "irq"
+};
+
+static void
+help(void)
+{
+    printf(
+        "tracedump: usage: tracedump [flags]\n"
+        "flags:\n"
+        "   [-e] Enable all tracepoints\n"
+        "   [-d] Disable all tracepoints\n"
+        "   [-m mask] Enable tracepoints by event mask\n"
+        "with no flags, recorded events are dumped\n"
+    );
+}
+
+static int
+set_mask(uint32_t mask)
+{
+    int fd;
+
+    if ((fd = open(TRACE_MASK, O_RDWR)) < 0) {
+        printf("failed to open %s\n", TRACE_MASK);
+        return fd;
+    }
+
+    if (write(fd, &mask, sizeof(mask)) < 0) {
+        printf("failed to set trace mask\n");
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+static void
+print_rec(const struct trace_rec *rp)
+{
+    const uint64_t *arg = rp->arg;
+
+    if (rp->event >= TRACE_NEVENT) {
+        printf("bad event %d\n", rp->event);
+        return;
+    }
+
+    printf("%x cpu%d pid=%d %s: ", rp->tsc, rp->cpu, rp->pid,
+        evname[rp->event]);
+
+    switch (rp->event) {
+    case TRACE_SCHED_SWITCH:
+        printf("next=%d pri=%d\n", arg[0], arg[1]);
+        break;
+    case TRACE_SYSCALL_ENTER:
+        printf("nr=%d arg0=%p arg1=%p\n", arg[0], arg[1], arg[2]);
+        break;
+    case TRACE_SYSCALL_EXIT:
+        printf("nr=%d ret=%d\n", arg[0], arg[1]);
+        break;
+    case TRACE_PAGEFAULT:
+        printf("addr=%p ip=%p code=%x\n", arg[0], arg[1], arg[2]);
+        break;
+    case TRACE_DISK_IO:
+        printf("%s disk=%d blk=%d len=%d\n",
+            (arg[2] & 1) ? "write" : "read",
+            arg[0], arg[1], arg[2] >> 1);
+        break;
+    case TRACE_IRQ:
+        printf("vector=%d count=%d\n", arg[0], arg[1]);
+        break;
+    }
+}
+
+static int
+dump(void)
+{
+    struct trace_rec buf[NREC];
+    ssize_t len;
+    size_t n;
+    int fd;
+
+    if ((fd = open(TRACE_BUF, O_RDONLY)) < 0) {
+        printf("failed to open %s\n", TRACE_BUF);
+        return fd;
+    }
+
+    while ((len = read(fd, buf, sizeof(buf))) > 0) {
+        n = len / sizeof(struct trace_rec);
+        for (size_t i = 0; i < n; ++i) {
+            print_rec(&buf[i]);
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    int c;
+
+    if (argc < 2) {
+        return dump();
+    }
+
+    while ((c = getopt(argc, argv, TRACEDUMP_FLAGS)) != -1) {
+        switch (c) {
+        case 'e':
+            return set_mask((1 << TRACE_NEVENT) - 1);
+        case 'd':
+            return set_mask(0);
+        case 'm':
+            return set_mask(atoi(optarg));
+        default:
+            help();
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -155,6 +155,9 @@ progress_update(struct progress_bar *bp, size_t n, size_t max)
     } else {
         --bp->progress;
     }
+
+    /* stdout is line buffered, show the bar now */
+    fflush(stdout);
 }
 
 /*